@@ -0,0 +1,55 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+int arena_init(arena_t *a, size_t size){
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    a->base = aligned_alloc(ARENA_ALIGN, size);
+    if (!a->base){
+        perror("arena_init");
+        return -1;
+    }
+    // fault the pages in now, not in the audio thread
+    memset(a->base, 0, size);
+    a->size = size;
+    a->used = 0;
+    a->full = 0;
+    return 0;
+}
+
+/* zeroed, ARENA_ALIGN aligned. NULL when full */
+void *arena_alloc(arena_t *a, size_t size){
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if (size > a->size - a->used){
+        a->full = 1;
+        return NULL;
+    }
+
+    void *p = a->base + a->used;
+    a->used += size;
+    memset(p, 0, size);
+    return p;
+}
+
+void arena_reset(arena_t *a){
+    a->used = 0;
+    a->full = 0;
+}
+
+size_t arena_mark(const arena_t *a){
+    return a->used;
+}
+
+void arena_rewind(arena_t *a, size_t mark){
+    if (mark < a->used)
+        a->used = mark;
+}
+
+void arena_free(arena_t *a){
+    free(a->base);
+    a->base = NULL;
+    a->size = a->used = 0;
+    a->full = 0;
+}
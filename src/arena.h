@@ -0,0 +1,25 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_ALIGN (64)
+
+/* bump allocator for effect state: one malloc up front, no frees, reset
+ * releases everything at once */
+typedef struct arena_t{
+    unsigned char *base;
+    size_t size;
+    size_t used;
+    int full;       // an alloc did not fit since the last reset
+} arena_t;
+
+int arena_init(arena_t *a, size_t size);
+void *arena_alloc(arena_t *a, size_t size);
+void arena_reset(arena_t *a);
+// undo every alloc made since arena_mark, none of them may be in use
+size_t arena_mark(const arena_t *a);
+void arena_rewind(arena_t *a, size_t mark);
+void arena_free(arena_t *a);
+
+#endif
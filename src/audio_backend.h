@@ -0,0 +1,34 @@
+#ifndef AUDIO_BACKEND_H
+#define AUDIO_BACKEND_H
+
+#include <portaudio.h>
+
+#include "audio_types.h"
+
+typedef PaStreamCallback audio_io_cb_t;
+
+typedef struct audio_stream_cfg_t{
+    int channels;
+    double sample_rate;
+    unsigned long frames_per_buffer;
+    int realtime;   // simulated backends: pace callbacks like a device
+} audio_stream_cfg_t;
+
+/* where audio_cb gets driven from. portaudio talks to a sound card, null
+ * and file run the same callback from a thread without any hardware */
+typedef struct audio_backend_t{
+    const char *name;
+    int has_devices;
+    int (*init)(const char *arg, int channels);
+    int (*start)(const audio_stream_cfg_t *cfg, audio_io_cb_t *cb, void *user);
+    int (*stop)(void);
+    int (*terminate)(void);
+    int (*finished)(void);      // NULL: runs until stopped
+    int (*active)(void);        // a callback may still come
+} audio_backend_t;
+
+extern const audio_backend_t backend_portaudio;
+extern const audio_backend_t backend_null;
+extern const audio_backend_t backend_file;
+
+#endif
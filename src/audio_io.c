@@ -3,6 +3,7 @@
 #include <string.h>
 #include <stdatomic.h>
 #include <math.h>
+#include <time.h>
 
 #include "utils.h"
 #include "audio_io.h"
@@ -10,60 +11,14 @@
 #include "portaudio.h"
 #include "audio_types.h"
 #include "wav.h"
-
-#ifdef VISUALIZE_EFFECTS
-
-#define MAXFILES (25)
-
-#define MAX_VIS_FILENAME (50)
-
-typedef struct effect_visual_t{
-    FILE *file;
-    effect_t effect;
-} effect_visual_t;
-
-effect_visual_t *effect_visuals[MAXFILES];
-static int effect_visuals_count = 0;
-
-static void open_vis_effects_files(){
-    if (effects_count >= MAXFILES){
-        fprintf(stderr, "too many files to visualize it");
-        exit(1);
-    }
-
-    for (int i = 0; i < effects_count; i++){
-        effect_visual_t *visual = malloc(sizeof(effect_visual_t));
-        if (!visual){
-            perror("malloc");
-            exit(1);
-        }
-
-        visual->effect = effects[i];
-
-        char filename[MAX_VIS_FILENAME];
-        sprintf(filename, "%s.raw", visual->effect.name);
-
-        visual->file = fopen(filename, "wb");
-        if (!visual->file){
-            fprintf(stderr, "error: can`t open visualization file");
-            exit(1);
-        }
-
-        effect_visuals[effect_visuals_count++] = visual;
-    }
-}
-
-static void free_visuals(){
-    for (int i = 0; i < effect_visuals_count; i++){
-        fclose(effect_visuals[i]->file);
-        free(effect_visuals[i]);
-    }
-    effect_visuals_count = 0;
-}
-
-#endif
+#include "recorder.h"
+#include "audio_backend.h"
+#include "tap.h"
 
 typedef struct {
+    const audio_backend_t *backend;
+    const char *backend_arg;
+    int realtime;
     PaStream *stream;
     PaStreamParameters in_params;
     PaStreamParameters out_params;
@@ -71,7 +26,10 @@ typedef struct {
     unsigned long frames_per_buffer;
 } audio_engine_t;
 
-audio_engine_t audio_engine;
+audio_engine_t audio_engine = {
+    .backend = &backend_portaudio,
+    .realtime = 1,
+};
 audio_cb_ctx_t *audio_cb_ctx;
 
 int file_exists(const char* filepath){
@@ -96,30 +54,155 @@ char *find_new_filename(){
     return NULL;   
 }
 
-int audio_io_open_record_file(const char* filepath){
-    printf("filepath: %s\n", filepath);
+int audio_io_open_record_file(const char* filepath, const recorder_opts_t *o){
     if (!filepath)
         filepath = find_new_filename(); 
-    
-    printf("filepath: %s\n", filepath);
-    audio_cb_ctx->ww = wav_open(filepath, WAVE_FORMAT_IEEE_FLOAT, SAMPLE_RATE, 
-        audio_cb_ctx->audio_params.channels, sizeof(SAMPLE) * 8);
+    if (!filepath){
+        fprintf(stderr, "error: no free output filename\n");
+        return -1;
+    }
+
+    DEBUG_PRINTF("filepath: %s\n", filepath);
+    recorder_t *rec = recorder_open(filepath, audio_cb_ctx->audio_params.sample_rate,
+        audio_cb_ctx->audio_params.channels, audio_cb_ctx->rec_buffer_sec, o);
+    if (!rec)
+        return -1;
+
+    atomic_store(&audio_cb_ctx->rec, rec);
+    return 0;
 }
 
-int audio_io_write_to_record_file(const void* data, size_t bytes){
-    return wav_write(audio_cb_ctx->ww, data, bytes);
+int audio_io_record_stats(recorder_stats_t *st){
+    recorder_t *rec = atomic_load(&audio_cb_ctx->rec);
+    if (!rec)
+        return -1;
+    recorder_get_stats(rec, st);
+    return 0;
 }
 
 int audio_io_close_record_file(){
     int rc = 0;
     set_no_record_flag();
-    if (wav_close(audio_cb_ctx->ww) < 0)
-        rc = -1;
 
-    audio_cb_ctx->ww = NULL;
+    recorder_t *rec = atomic_exchange(&audio_cb_ctx->rec, NULL);
+    if (!rec)
+        return 0;
+
+    // the callback may still hold the old pointer
+    audio_io_quiesce();
+
+    recorder_stats_t st;
+    recorder_get_stats(rec, &st);
+    printf("recorded %llu frames, buffer high water %zu/%zu frames, "
+           "overruns %lu (%llu frames dropped)\n",
+           st.frames_written, st.high_water_frames, st.capacity_frames,
+           st.overruns, st.dropped_frames);
+
+    if (recorder_close(rec) < 0)
+        rc = -1;
     return rc;
 }
 
+int audio_io_spectrum_open(size_t size){
+    if (atomic_load(&audio_cb_ctx->spectrum))
+        return 0;
+    spectrum_t *s = spectrum_open(size, audio_cb_ctx->audio_params.sample_rate,
+        audio_cb_ctx->audio_params.channels);
+    if (!s)
+        return -1;
+    atomic_store(&audio_cb_ctx->spectrum, s);
+    return 0;
+}
+
+spectrum_t *audio_io_spectrum(void){
+    return atomic_load(&audio_cb_ctx->spectrum);
+}
+
+void audio_io_spectrum_close(void){
+    spectrum_t *s = atomic_exchange(&audio_cb_ctx->spectrum, NULL);
+    if (!s)
+        return;
+    audio_io_quiesce();
+    spectrum_fprint_cost(s, stdout);
+    spectrum_close(s);
+}
+
+/* taps: mask of TAP_POINT_BIT()s, 0 turns them off but keeps the ring
+ * mapped so attached analyzers survive a toggle */
+int audio_io_tap_set(uint32_t mask){
+    tap_t *t = atomic_load(&audio_cb_ctx->tap);
+    if (!t && mask){
+        t = tap_open(TAP_SHM_NAME, TAP_DEFAULT_SIZE);
+        if (!t)
+            return -1;
+        atomic_store(&t->mask, mask);
+        atomic_store(&audio_cb_ctx->tap, t);
+        return 0;
+    }
+    if (t)
+        atomic_store(&t->mask, mask);
+    return 0;
+}
+
+tap_t *audio_io_tap(void){
+    return atomic_load(&audio_cb_ctx->tap);
+}
+
+/* wait until any callback that started before the call has returned.
+ * a stopped stream has none in flight; a running one is waited out for as
+ * long as its periods take, returning early would free what it still reads */
+void audio_io_quiesce(void){
+    const struct timespec tick = { 0, 1000 * 1000 };
+    const audio_backend_t *b = audio_engine.backend;
+    unsigned long epoch = atomic_load(&audio_cb_ctx->cb_epoch);
+    while (atomic_load(&audio_cb_ctx->cb_epoch) - epoch < 2){
+        if (!b->active())
+            return;
+        nanosleep(&tick, NULL);
+    }
+}
+
+static effect_chain_t *chain_spare(void){
+    effect_chain_t *live = atomic_load(&audio_cb_ctx->chain);
+    return live == &audio_cb_ctx->chain_slots[0]
+        ? &audio_cb_ctx->chain_slots[1] : &audio_cb_ctx->chain_slots[0];
+}
+
+/* editing happens on the TUI thread only: begin returns a private copy of
+ * the live chain, commit publishes it. the callback never waits */
+effect_chain_t *audio_io_chain_begin(void){
+    effect_chain_t *spare = chain_spare();
+    *spare = *atomic_load(&audio_cb_ctx->chain);
+    return spare;
+}
+
+void audio_io_chain_commit(void){
+    atomic_store_explicit(&audio_cb_ctx->chain, chain_spare(), memory_order_release);
+    // the previous chain becomes the spare once no callback can hold it
+    audio_io_quiesce();
+}
+
+// where edits allocate: the arena of the live chain
+arena_t *audio_io_state_arena(void){
+    return &audio_cb_ctx->state_arena[audio_cb_ctx->state_live];
+}
+
+/* removed stages keep their space in a bump arena. rebuild the live chain
+ * into the other, empty arena and publish it, then the old one is free as
+ * a whole. the surviving stages restart from fresh state */
+int audio_io_chain_compact(void){
+    arena_t *from = audio_io_state_arena();
+    arena_t *to = &audio_cb_ctx->state_arena[!audio_cb_ctx->state_live];
+    arena_reset(to);
+    if (chain_rebuild(chain_spare(), atomic_load(&audio_cb_ctx->chain),
+                &audio_cb_ctx->audio_params, to) < 0)
+        return -1;
+    audio_io_chain_commit();
+    audio_cb_ctx->state_live = !audio_cb_ctx->state_live;
+    arena_reset(from);
+    return 0;
+}
+
 int is_record(void){
     return (audio_cb_ctx->flags & FLAG_RECORD) != 0;
 }
@@ -136,15 +219,16 @@ int stop_recording(){
     set_no_record_flag();
 }
 
-static inline void meter_update(meter_t *m, const SAMPLE *x, unsigned long n) {
-    float peak = 0.0f;
+typedef struct cb_tap_t{
+    tap_t *tap;
+    const audio_params_t *p;
+    uint64_t time_ns;
+} cb_tap_t;
 
-    for (unsigned long i = 0; i < n; ++i) {
-        float v = fabsf((float)x[i]);
-        if (v > peak) peak = v;
-    }
-
-    atomic_store(&m->peak, peak);
+static void cb_tap_stage(void *user, size_t stage, const SAMPLE *x, unsigned long frames){
+    cb_tap_t *ct = user;
+    tap_write(ct->tap, TAP_POINT_STAGE((int)stage), x, frames, ct->p->channels,
+            ct->p->sample_rate, ct->time_ns);
 }
 
 static int audio_cb(const void *input, void *output,
@@ -153,43 +237,73 @@ static int audio_cb(const void *input, void *output,
                                  PaStreamCallbackFlags statusFlags,
                                  void *userData)
 {
-    (void)timeInfo; (void)statusFlags; (void)userData;
+    (void)timeInfo;
+    uint64_t t0 = cbstats_now_ns();
 
     audio_cb_ctx_t *audio_cb_ctx = (audio_cb_ctx_t *)userData; 
     audio_params_t *audio_params = &audio_cb_ctx->audio_params; 
     SAMPLE *in = (SAMPLE *)input;
     SAMPLE *out = (SAMPLE*)output;
 
-    #ifdef VISUALIZE_EFFECTS   
-    for (int i = 0; i < effect_visuals_count; i++){
-        SAMPLE in_copy[sizeof(SAMPLE) * frameCount * audio_params->channels];
-        memcpy(in_copy, in, sizeof(SAMPLE) * frameCount * audio_params->channels);
-        
-        effect_visual_t *ev = effect_visuals[i];
-        ev->effect.func(in_copy, frameCount, audio_params);
-        fwrite(in_copy, sizeof(SAMPLE), 
-            frameCount * audio_params->channels, 
-            ev->file);
-    }
-    #endif
+    params_begin_block(&audio_cb_ctx->params, audio_params, frameCount);
+
+    // taps: a header and a memcpy each into the shared ring, see tap.c
+    tap_t *tap = atomic_load_explicit(&audio_cb_ctx->tap, memory_order_acquire);
+    uint32_t taps = tap ? atomic_load_explicit(&tap->mask, memory_order_relaxed) : 0;
+    cb_tap_t ct = { tap, audio_params, t0 };
+    if (taps & TAP_POINT_BIT(TAP_POINT_INPUT))
+        tap_write(tap, TAP_POINT_INPUT, in, frameCount, audio_params->channels,
+                audio_params->sample_rate, t0);
 
     //dsp
-    if (audio_cb_ctx->dsp_process)
-        audio_cb_ctx->dsp_process(in, frameCount, audio_params);
+    const effect_chain_t *chain = atomic_load_explicit(&audio_cb_ctx->chain, memory_order_acquire);
+    chain_process_tapped(chain, in, frameCount, audio_params,
+            taps >> TAP_POINT_STAGE(0), cb_tap_stage, &ct);
 
     memcpy(out, in, sizeof(SAMPLE) * frameCount * audio_params->channels);
+    if (taps & TAP_POINT_BIT(TAP_POINT_OUTPUT))
+        tap_write(tap, TAP_POINT_OUTPUT, out, frameCount, audio_params->channels,
+                audio_params->sample_rate, t0);
+    if (tap)
+        tap->frame += frameCount;
+    uint64_t t1 = cbstats_now_ns();
+    uint64_t t2 = t1, t3 = t1;
     
-    if (audio_cb_ctx->flags & FLAG_RECORD && audio_cb_ctx->ww){
-        int n = audio_io_write_to_record_file(in, 
-            sizeof(SAMPLE) * frameCount * audio_params->channels);
-        
-        meter_update(&audio_cb_ctx->metrics, in, frameCount);
+    recorder_t *rec = atomic_load_explicit(&audio_cb_ctx->rec, memory_order_acquire);
+    if (audio_cb_ctx->flags & FLAG_RECORD && rec){
+        recorder_push(rec, in, frameCount);
+        t2 = t3 = cbstats_now_ns();
+    }
+
+    // analysis taps: copies only, the math runs on their own threads
+    meter_t *meter = atomic_load_explicit(&audio_cb_ctx->meter, memory_order_acquire);
+    if (meter){
+        meter_push(meter, in, frameCount);
+        t3 = cbstats_now_ns();
     }
+    spectrum_t *spectrum = atomic_load_explicit(&audio_cb_ctx->spectrum, memory_order_acquire);
+    if (spectrum){
+        spectrum_push(spectrum, in, frameCount);
+        t3 = cbstats_now_ns();
+    }
+
+    const uint32_t ns[CBSTATS_PHASES] = {
+        [CBSTATS_DSP] = (uint32_t)(t1 - t0),
+        [CBSTATS_REC] = (uint32_t)(t2 - t1),
+        [CBSTATS_METER] = (uint32_t)(t3 - t2),
+        [CBSTATS_TOTAL] = (uint32_t)(t3 - t0),
+    };
+    uint32_t budget = (uint32_t)(1e9 * frameCount / audio_params->sample_rate);
+    cbstats_record(&audio_cb_ctx->stats, ns, budget, statusFlags);
 
+    atomic_fetch_add_explicit(&audio_cb_ctx->cb_epoch, 1, memory_order_release);
     return paContinue;  
 }
 
-int init_audio_cb_ctx(){
+int init_audio_cb_ctx(void){
+    if (audio_cb_ctx)
+        return 0;
+
     audio_cb_ctx = calloc(1, sizeof(audio_cb_ctx_t));
     if (!audio_cb_ctx) { 
         perror("malloc"); 
@@ -200,20 +314,41 @@ int init_audio_cb_ctx(){
     ap->channels = 1;
     ap->gain = 10.0f;
     ap->volume = 0.2f;
-    audio_cb_ctx->dsp_process = NULL;
+    ap->sample_rate = DEFAULT_SAMPLE_RATE;
+    ap->frames_per_buffer = DEFAULT_FRAMES_PER_BUFFER;
+    atomic_store(&audio_cb_ctx->chain, &audio_cb_ctx->chain_slots[0]);
+    for (int i = 0; i < 2; i++)
+        if (arena_init(&audio_cb_ctx->state_arena[i], EFFECT_ARENA_SIZE) < 0)
+            return -1;
+    if (params_init(&audio_cb_ctx->params) < 0)
+        return -1;
+    audio_cb_ctx->rec_buffer_sec = RECORDER_DEFAULT_BUFFER_SEC;
     return 0;
 }
 
-int start_audio_io(){
-    PaError err = Pa_OpenStream(
+/* ---- portaudio backend ---- */
+
+static int pa_start(const audio_stream_cfg_t *cfg, audio_io_cb_t *cb, void *user){
+    PaError err = Pa_IsFormatSupported(&audio_engine.in_params,
+            &audio_engine.out_params, cfg->sample_rate);
+    if (err != paFormatIsSupported){
+        fprintf(stderr, "error: %.0f Hz, %d ch: %s\n", cfg->sample_rate,
+                cfg->channels, Pa_GetErrorText(err));
+        // one duplex stream, nothing converts between the two devices
+        fprintf(stderr, "input and output device must both support %.0f Hz\n",
+                cfg->sample_rate);
+        return -1;
+    }
+
+    err = Pa_OpenStream(
         &audio_engine.stream, 
         &audio_engine.in_params, 
         &audio_engine.out_params,
-        SAMPLE_RATE,
-        FRAMES_PER_BUFFER,
+        cfg->sample_rate,
+        cfg->frames_per_buffer,
         0,
-        audio_cb,
-        audio_cb_ctx
+        cb,
+        user
     );
     
     if (err){
@@ -228,19 +363,11 @@ int start_audio_io(){
     return 0;
 }
 
-int init_audio_io(int channels){   
-    #ifdef VISUALIZE_EFFECTS
-    open_vis_effects_files();
-    #endif
-    
-    if (init_audio_cb_ctx() < 0)
-        return -1;
-
+static int pa_init(const char *arg, int channels){
+    (void)arg;
     if (Pa_Initialize() < 0)
         return -1;
     
-    PaError err = paNoError;
-    
     PaDeviceIndex input_device = Pa_GetDefaultInputDevice();
     PaDeviceIndex output_device = Pa_GetDefaultOutputDevice();
 
@@ -260,12 +387,10 @@ int init_audio_io(int channels){
     audio_engine.out_params.sampleFormat = paFloat32;
     audio_engine.out_params.suggestedLatency = Pa_GetDeviceInfo( 
         audio_engine.out_params.device )->defaultLowOutputLatency;  
-    
-    if (start_audio_io() < 0)
-        return -1;
+    return 0;
 }
 
-int terminate_audio_io_stream(){
+static int pa_stop(void){
     if (audio_engine.stream == NULL)
         return 0;
     
@@ -286,22 +411,229 @@ int terminate_audio_io_stream(){
     return 0;
 }
 
-int terminate_audio_io(){
+static int pa_terminate(void){
     PaError err;
-    if ((err = terminate_audio_io_stream())){
-        fprintf(stderr, "error: ", Pa_GetErrorText(err));
+    if (pa_stop() < 0)
         return -1;
-    }
     if ((err = Pa_Terminate())){
-        fprintf(stderr, "error: ", Pa_GetErrorText(err));
+        fprintf(stderr, "error: %s\n", Pa_GetErrorText(err));
         return -1;
     }
+    return 0;
+}
 
-    #ifdef VISUALIZE_EFFECTS
-    free_visuals(); 
-    #endif
+static int pa_active(void){
+    return audio_engine.stream && Pa_IsStreamActive(audio_engine.stream) == 1;
+}
+
+const audio_backend_t backend_portaudio = {
+    "portaudio", 1, pa_init, pa_start, pa_stop, pa_terminate, NULL, pa_active
+};
+
+static const audio_backend_t *const backends[] = {
+    &backend_portaudio, &backend_null, &backend_file,
 };
 
+/* "name" or "name:arg", e.g. "null:noise", "file:capture.wav" */
+int audio_io_set_backend(const char *spec){
+    const char *colon = strchr(spec, ':');
+    size_t len = colon ? (size_t)(colon - spec) : strlen(spec);
+
+    for (size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++){
+        if (strlen(backends[i]->name) == len && strncmp(spec, backends[i]->name, len) == 0){
+            audio_engine.backend = backends[i];
+            audio_engine.backend_arg = colon ? colon + 1 : NULL;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *audio_io_backend_name(void){
+    return audio_engine.backend->name;
+}
+
+int audio_io_has_devices(void){
+    return audio_engine.backend->has_devices;
+}
+
+int audio_io_finished(void){
+    const audio_backend_t *b = audio_engine.backend;
+    return b && b->finished && b->finished();
+}
+
+/* ---- engine ---- */
+
+int audio_io_meter_read(meter_reading_t *r){
+    meter_t *m = atomic_load(&audio_cb_ctx->meter);
+    if (!m)
+        return -1;
+    meter_read(m, r);
+    return 0;
+}
+
+void audio_io_meter_reset(void){
+    meter_t *m = atomic_load(&audio_cb_ctx->meter);
+    if (m)
+        meter_reset(m);
+}
+
+/* stream stopped: (re)open the meter when the format changed */
+static int meter_sync(void){
+    const audio_params_t *ap = &audio_cb_ctx->audio_params;
+    meter_t *m = atomic_load(&audio_cb_ctx->meter);
+    if (m && m->sample_rate == ap->sample_rate && m->channels == ap->channels)
+        return 0;
+
+    meter_close(atomic_exchange(&audio_cb_ctx->meter, NULL));
+    m = meter_open(ap->sample_rate, ap->channels);
+    if (!m)
+        return -1;
+    atomic_store(&audio_cb_ctx->meter, m);
+    return 0;
+}
+
+/* stream stopped: an open spectrum is reopened at the same size when the
+ * format changed, its bins and labels follow the rate */
+static int spectrum_sync(void){
+    const audio_params_t *ap = &audio_cb_ctx->audio_params;
+    spectrum_t *s = atomic_load(&audio_cb_ctx->spectrum);
+    if (!s || (s->sample_rate == ap->sample_rate && s->channels == ap->channels))
+        return 0;
+
+    size_t size = s->size;
+    spectrum_close(atomic_exchange(&audio_cb_ctx->spectrum, NULL));
+    s = spectrum_open(size, ap->sample_rate, ap->channels);
+    if (!s)
+        return -1;
+    atomic_store(&audio_cb_ctx->spectrum, s);
+    return 0;
+}
+
+int start_audio_io(){
+    if (meter_sync() < 0 || spectrum_sync() < 0)
+        return -1;
+    // no callback runs here, ramps restart from the current values
+    params_reset(&audio_cb_ctx->params, &audio_cb_ctx->audio_params);
+
+    audio_stream_cfg_t cfg = {
+        .channels = audio_cb_ctx->audio_params.channels,
+        .sample_rate = audio_cb_ctx->audio_params.sample_rate,
+        .frames_per_buffer = audio_cb_ctx->audio_params.frames_per_buffer,
+        .realtime = audio_engine.realtime,
+    };
+    return audio_engine.backend->start(&cfg, audio_cb, audio_cb_ctx);
+}
+
+int terminate_audio_io_stream(){
+    return audio_engine.backend->stop();
+}
+
+/* with the stream stopped: rebuild the live chain for the current params.
+ * eq coefficients, convolution partitions and oversampled stages are all
+ * designed for the rate and block size they were made at */
+static int chain_refit(void){
+    if (atomic_load(&audio_cb_ctx->chain)->count == 0)
+        return 0;
+    return audio_io_chain_compact();
+}
+
+/* block sizes tried by the auto mode, smallest (lowest latency) first */
+static const unsigned long auto_block_sizes[] = { 32, 64, 128, 256, 512, 1024, 2048 };
+#define AUTO_PROBE_MS (500)
+
+static int block_is_clean(const cbstats_t *st){
+    return atomic_load(&st->blocks) > 0
+        && atomic_load(&st->input_overflow) == 0
+        && atomic_load(&st->output_underflow) == 0
+        && atomic_load(&st->hist[CBSTATS_HIST_BUCKETS - 1]) == 0;
+}
+
+/* run the stream at each candidate size for a moment and keep the first
+ * one without xruns or missed deadlines. leaves the stream running */
+static int autotune_block_size(void){
+    audio_params_t *ap = &audio_cb_ctx->audio_params;
+    const size_t n = sizeof(auto_block_sizes) / sizeof(auto_block_sizes[0]);
+    const struct timespec probe = { AUTO_PROBE_MS / 1000, (AUTO_PROBE_MS % 1000) * 1000000L };
+
+    for (size_t i = 0; i < n; i++){
+        ap->frames_per_buffer = auto_block_sizes[i];
+        if (chain_refit() < 0 || start_audio_io() < 0)
+            continue;
+
+        cbstats_reset(&audio_cb_ctx->stats);
+        nanosleep(&probe, NULL);
+        if (block_is_clean(&audio_cb_ctx->stats)){
+            printf("block size: %lu frames (%.1f ms)\n", ap->frames_per_buffer,
+                   1e3 * ap->frames_per_buffer / ap->sample_rate);
+            cbstats_reset(&audio_cb_ctx->stats);
+            return 0;
+        }
+        if (terminate_audio_io_stream() < 0)
+            return -1;
+    }
+
+    // nothing was clean, settle for the largest
+    fprintf(stderr, "block size: no clean size found, using %lu\n", auto_block_sizes[n - 1]);
+    ap->frames_per_buffer = auto_block_sizes[n - 1];
+    if (chain_refit() < 0)
+        return -1;
+    return start_audio_io();
+}
+
+int init_audio_io(int channels){   
+    if (init_audio_cb_ctx() < 0)
+        return -1;
+
+    if (audio_engine.backend->init(audio_engine.backend_arg, channels) < 0)
+        return -1;
+    
+    if (audio_cb_ctx->audio_params.frames_per_buffer == FRAMES_PER_BUFFER_AUTO)
+        return autotune_block_size();
+
+    if (start_audio_io() < 0)
+        return -1;
+    return 0;
+}
+
+/* change rate and/or block size of the running stream. 0 keeps the value,
+ * autotune probes again. the chain is rebuilt for the new format first;
+ * when it cannot be, the stream goes on in the old one */
+int audio_io_reconfigure(int sample_rate, unsigned long frames_per_buffer, int autotune){
+    audio_params_t *ap = &audio_cb_ctx->audio_params;
+    if (is_record()){
+        fprintf(stderr, "stop recording before changing the stream format\n");
+        return -1;
+    }
+    if (terminate_audio_io_stream() < 0)
+        return -1;
+
+    const int old_rate = ap->sample_rate;
+    const unsigned long old_block = ap->frames_per_buffer;
+    if (sample_rate > 0)
+        ap->sample_rate = sample_rate;
+    if (frames_per_buffer > 0 && !autotune)
+        ap->frames_per_buffer = frames_per_buffer;
+    if (chain_refit() < 0){
+        fprintf(stderr, "the chain does not fit %d Hz, %lu frames, keeping the old format\n",
+                ap->sample_rate, ap->frames_per_buffer);
+        ap->sample_rate = old_rate;
+        ap->frames_per_buffer = old_block;
+        start_audio_io();
+        return -1;
+    }
+    if (autotune)
+        return autotune_block_size();
+    return start_audio_io();
+}
+
+int terminate_audio_io(){
+    int rc = audio_engine.backend->terminate();
+    meter_close(atomic_exchange(&audio_cb_ctx->meter, NULL));
+    tap_close(atomic_exchange(&audio_cb_ctx->tap, NULL));
+    return rc;
+}
+
 int restart_audio_io(){
     if (terminate_audio_io_stream() < 0)
         return -1;
@@ -328,6 +660,11 @@ PaError validate_input_device(PaDeviceIndex device, double srate){
 }
 
 int fprint_devices(FILE *file){
+    if (!audio_io_has_devices()){
+        fprintf(file, "backend \"%s\" has no devices\n", audio_io_backend_name());
+        return -1;
+    }
+
     fprintf(file, "Choose your audio device:\n");
     fprintf(file, "---------------------------------------------------------------\n");
     fprintf(file, "%-9s %s\n", "NUMBER", "NAME");
@@ -349,6 +686,8 @@ int fprint_devices(FILE *file){
 }
 
 int set_in_dev_audio_io(device_index idx, int channels){
+    if (!audio_io_has_devices())
+        return -1;
     if (terminate_audio_io_stream() < 0)
         return -1;
 
@@ -367,6 +706,8 @@ int set_in_dev_audio_io(device_index idx, int channels){
 }
 
 int set_out_dev_audio_io(device_index idx, int channels){
+    if (!audio_io_has_devices())
+        return -1;
     if (terminate_audio_io_stream() < 0)
         return -1;
     
@@ -382,3 +723,7 @@ int set_out_dev_audio_io(device_index idx, int channels){
     return 0;
 }
 
+
+void audio_io_set_realtime(int realtime){
+    audio_engine.realtime = realtime;
+}
@@ -7,10 +7,19 @@
 
 #include "audio_types.h"
 #include "wav.h"
+#include "audio_backend.h"
+#include "recorder.h"
+#include "chain.h"
+#include "arena.h"
+#include "cbstats.h"
+#include "spectrum.h"
+#include "meter.h"
+#include "tap.h"
+#include "params.h"
 
-// #define VISUALIZE_EFFECTS
+// room for the partition spectra of a few seconds of convolution IR, twice
+#define EFFECT_ARENA_SIZE (64u << 20)
 
-typedef PaStreamCallback audio_io_cb_t;
 typedef PaDeviceIndex device_index;
 
 typedef uint32_t flags_t;
@@ -20,24 +29,43 @@ enum flags {
 	FLAG_RECORD = 1u << 1,
 };
 
-typedef struct {
-    _Atomic SAMPLE peak; // float [-1...1] 
-    _Atomic unsigned long frames;
-} meter_t;
-
 typedef struct audio_cb_ctx_t{
-    wav_writer* ww;
+    _Atomic(recorder_t *) rec;
+    _Atomic(spectrum_t *) spectrum;    // analyzer tap, NULL when off
+    double rec_buffer_sec;
+    _Atomic unsigned long cb_epoch; // bumped at the end of every callback
     flags_t flags;
+    // gain and friends: the TUI queues changes in params, the callback
+    // applies them to audio_params at the top of each block
     audio_params_t audio_params;
-    meter_t metrics;
-    audio_process_fn dsp_process;
+    params_t params;
+    _Atomic(meter_t *) meter;  // levels and loudness, fed every callback
+    _Atomic(tap_t *) tap;      // shared memory export, NULL until first "tap"
+    // RCU: the callback reads *chain, the TUI edits the spare slot and
+    // publishes it; the old one is reused only after a grace period
+    _Atomic(effect_chain_t *) chain;
+    effect_chain_t chain_slots[2];
+    // effect instance state: the live chain's is all in state_arena[state_live],
+    // a compaction moves it to the other one, "effect clear" resets it
+    arena_t state_arena[2];
+    int state_live;
+    cbstats_t stats;
 } audio_cb_ctx_t;
 
 extern audio_cb_ctx_t *audio_cb_ctx;
 
+int init_audio_cb_ctx(void);
 int init_audio_io(int channels);
 int terminate_audio_io();
 
+int audio_io_reconfigure(int sample_rate, unsigned long frames_per_buffer, int autotune);
+
+int audio_io_set_backend(const char *spec);
+void audio_io_set_realtime(int realtime);
+const char *audio_io_backend_name(void);
+int audio_io_has_devices(void);
+int audio_io_finished(void);
+
 int fprint_devices(FILE *file); 
 
 int set_in_dev_audio_io(device_index idx, int channels);
@@ -47,8 +75,24 @@ int is_record(void);
 void set_record_flag(void);
 void set_no_record_flag(void);
 
-int audio_io_open_record_file(const char* filepath);
-int audio_io_write_to_record_file(const void* data, size_t bytes);
+int audio_io_open_record_file(const char* filepath, const recorder_opts_t *o);
+int audio_io_record_stats(recorder_stats_t *st);
 int audio_io_close_record_file();
 
+int audio_io_meter_read(meter_reading_t *r);
+void audio_io_meter_reset(void);
+
+int audio_io_spectrum_open(size_t size);
+spectrum_t *audio_io_spectrum(void);
+void audio_io_spectrum_close(void);
+int audio_io_tap_set(uint32_t mask);
+tap_t *audio_io_tap(void);
+
+void audio_io_quiesce(void);
+
+effect_chain_t *audio_io_chain_begin(void);
+void audio_io_chain_commit(void);
+arena_t *audio_io_state_arena(void);
+int audio_io_chain_compact(void);
+
 #endif
\ No newline at end of file
@@ -1,7 +1,12 @@
 #pragma once
 
-#define SAMPLE_RATE  (44100)
-#define FRAMES_PER_BUFFER (10)
+// defaults, both can be changed at runtime (--rate, --block)
+#define DEFAULT_SAMPLE_RATE  (44100)
+#define DEFAULT_FRAMES_PER_BUFFER (256)
+#define FRAMES_PER_BUFFER_AUTO (0)
+
+// upper bound for --channels, sizes the per-channel tables
+#define MAX_CHANNELS (32)
 
 typedef float SAMPLE; // float [-1...1] 
 
@@ -11,9 +16,21 @@ typedef float SAMPLE; // float [-1...1]
 typedef struct audio_params_t{
     int volume;
     int channels;
-    float gain;      
+    float gain;      // at the first frame of the block
+    float gain_step; // per frame while a gain change ramps, else 0
+    int sample_rate;
+    unsigned long frames_per_buffer; // FRAMES_PER_BUFFER_AUTO: probe device
 } audio_params_t;
 
+/* samples: interleaved, frameCount * p->channels values, processed in place.
+ * state: the instance block from effect_t.state_size, NULL when stateless */
 typedef void (*audio_process_fn)(SAMPLE *samples,
                                  unsigned long frameCount,
-                                 const audio_params_t *p);
\ No newline at end of file
+                                 const audio_params_t *p,
+                                 void *state);
+/* planar variant: ch[c] points at frameCount contiguous samples of channel
+ * c, p->channels pointers, processed in place */
+typedef void (*audio_planar_fn)(SAMPLE *const *ch,
+                                unsigned long frameCount,
+                                const audio_params_t *p,
+                                void *state);
@@ -0,0 +1,306 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "audio_backend.h"
+#include "audio_types.h"
+#include "wav.h"
+#include "utils.h"
+#include "resample.h"
+
+/* "null" and "file" backends: a thread calls the audio callback either in a
+ * tight loop (as fast as the DSP allows) or on a simulated device clock.
+ * a file at another rate than the stream is resampled to the stream's */
+
+enum sim_source {
+    SRC_SILENCE,
+    SRC_SINE,
+    SRC_NOISE,
+    SRC_FILE,
+};
+
+static struct {
+    enum sim_source source;
+    wav_reader *reader;
+
+    pthread_t thread;
+    _Atomic int running;
+    _Atomic int finished;
+
+    audio_stream_cfg_t cfg;
+    audio_io_cb_t *cb;
+    void *user;
+
+    SAMPLE *in;
+    SAMPLE *out;
+    SAMPLE *scratch;
+    resampler_t *rs;        // file rate -> stream rate, NULL when they match
+    SAMPLE *rs_buf;         // resampled file frames not played yet
+    size_t rs_fill;
+    int rs_flushed;
+    double phase;
+    uint32_t rng;
+    unsigned long long frames;
+} sim;
+
+#define SIM_SINE_HZ   (440.0)
+#define SIM_LEVEL     (0.25f)
+
+static void gen_block(unsigned long frames){
+    const int ch = sim.cfg.channels;
+    const size_t n = frames * (size_t)ch;
+
+    switch (sim.source){
+    case SRC_SILENCE:
+        memset(sim.in, 0, sizeof(SAMPLE) * n);
+        break;
+    case SRC_SINE: {
+        const double step = 2.0 * M_PI * SIM_SINE_HZ / sim.cfg.sample_rate;
+        for (unsigned long i = 0; i < frames; i++){
+            SAMPLE v = SIM_LEVEL * (SAMPLE)sin(sim.phase);
+            sim.phase += step;
+            for (int c = 0; c < ch; c++)
+                sim.in[i * ch + c] = v;
+        }
+        sim.phase = fmod(sim.phase, 2.0 * M_PI);
+        break;
+    }
+    case SRC_NOISE:
+        // xorshift32, reproducible from run to run
+        for (size_t i = 0; i < n; i++){
+            sim.rng ^= sim.rng << 13;
+            sim.rng ^= sim.rng >> 17;
+            sim.rng ^= sim.rng << 5;
+            sim.in[i] = SIM_LEVEL * ((SAMPLE)(sim.rng >> 8) * (2.0f / 16777216.0f) - 1.0f);
+        }
+        break;
+    case SRC_FILE:
+        break;
+    }
+}
+
+/* up to frames of the file at the stream rate, left at the front of
+ * sim.rs_buf. the resampler runs ahead by at most one file block */
+static size_t file_resampled(unsigned long frames, const SAMPLE **blk){
+    const int fch = sim.reader->num_channels;
+    while (sim.rs_fill < frames && !sim.rs_flushed){
+        const SAMPLE *src;
+        SAMPLE *dst = sim.rs_buf + sim.rs_fill * fch;
+        size_t got = wav_reader_next_block(sim.reader, sim.scratch, frames, &src);
+        if (got){
+            sim.rs_fill += resampler_process(sim.rs, src, got, dst);
+        } else {
+            sim.rs_fill += resampler_flush(sim.rs, dst);
+            sim.rs_flushed = 1;
+        }
+    }
+    *blk = sim.rs_buf;
+    return sim.rs_fill < frames ? sim.rs_fill : frames;
+}
+
+/* returns frames placed in sim.in, 0 at end of file */
+static unsigned long file_block(unsigned long frames){
+    const SAMPLE *blk;
+    const int ch = sim.cfg.channels;
+    const int fch = sim.reader->num_channels;
+    size_t got = sim.rs ? file_resampled(frames, &blk)
+                        : wav_reader_next_block(sim.reader, sim.scratch, frames, &blk);
+
+    // map file channels onto the stream, extra stream channels get silence
+    for (size_t i = 0; i < got; i++){
+        for (int c = 0; c < ch; c++)
+            sim.in[i * ch + c] = c < fch ? blk[i * fch + c] : 0.0f;
+    }
+    memset(sim.in + got * ch, 0, sizeof(SAMPLE) * (frames - got) * ch);
+    if (sim.rs){
+        sim.rs_fill -= got;
+        memmove(sim.rs_buf, sim.rs_buf + got * fch, sizeof(SAMPLE) * sim.rs_fill * fch);
+    }
+    return (unsigned long)got;
+}
+
+static void timespec_add_ns(struct timespec *t, long long ns){
+    t->tv_nsec += ns;
+    while (t->tv_nsec >= 1000000000L){
+        t->tv_nsec -= 1000000000L;
+        t->tv_sec++;
+    }
+}
+
+static void *sim_thread(void *arg){
+    (void)arg;
+    const unsigned long fpb = sim.cfg.frames_per_buffer;
+    const long long period_ns = (long long)(1e9 * fpb / sim.cfg.sample_rate);
+
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (atomic_load_explicit(&sim.running, memory_order_acquire)){
+        unsigned long frames = fpb;
+        if (sim.source == SRC_FILE){
+            frames = file_block(fpb);
+            if (frames == 0)
+                break;
+        } else {
+            gen_block(frames);
+        }
+
+        PaStreamCallbackTimeInfo ti;
+        ti.currentTime = (double)sim.frames / sim.cfg.sample_rate;
+        ti.inputBufferAdcTime = ti.currentTime;
+        ti.outputBufferDacTime = ti.currentTime;
+
+        int rc = sim.cb(sim.in, sim.out, frames, &ti, 0, sim.user);
+        sim.frames += frames;
+        if (rc != paContinue)
+            break;
+
+        if (sim.cfg.realtime){
+            timespec_add_ns(&next, period_ns);
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        }
+    }
+
+    atomic_store(&sim.finished, 1);
+    return NULL;
+}
+
+static void sim_free_resampler(void){
+    resampler_free(sim.rs);
+    free(sim.rs_buf);
+    sim.rs = NULL;
+    sim.rs_buf = NULL;
+}
+
+// sim.in set means a thread was started and has to be joined
+static void sim_free_buffers(void){
+    free(sim.in);
+    free(sim.out);
+    free(sim.scratch);
+    sim.in = sim.out = sim.scratch = NULL;
+    sim_free_resampler();
+}
+
+/* on failure nothing is left behind for sim_stop */
+static int sim_start(const audio_stream_cfg_t *cfg, audio_io_cb_t *cb, void *user){
+    sim.cfg = *cfg;
+    if (sim.source == SRC_FILE && sim.reader->sample_rate != (int)cfg->sample_rate){
+        const int fch = sim.reader->num_channels;
+        sim.rs = resampler_create(sim.reader->sample_rate, (int)cfg->sample_rate, fch,
+                resample_quality);
+        if (!sim.rs)
+            return -1;
+        sim.rs_buf = malloc(sizeof(SAMPLE) * fch * (cfg->frames_per_buffer
+                + resampler_out_max(sim.rs, cfg->frames_per_buffer > sim.rs->taps
+                                    ? cfg->frames_per_buffer : sim.rs->taps)));
+        if (!sim.rs_buf){
+            perror("sim_start");
+            sim_free_resampler();
+            return -1;
+        }
+        sim.rs_fill = 0;
+        sim.rs_flushed = 0;
+        printf("file backend: %d Hz file resampled to %.0f Hz (%s)\n",
+               sim.reader->sample_rate, cfg->sample_rate, resample_quality_name(resample_quality));
+    }
+    sim.cb = cb;
+    sim.user = user;
+
+    size_t n = cfg->frames_per_buffer * (size_t)cfg->channels;
+    sim.in = calloc(n, sizeof(SAMPLE));
+    sim.out = calloc(n, sizeof(SAMPLE));
+    if (sim.source == SRC_FILE)
+        sim.scratch = calloc(cfg->frames_per_buffer * (size_t)sim.reader->num_channels,
+                sizeof(SAMPLE));
+    if (!sim.in || !sim.out || (sim.source == SRC_FILE && !sim.scratch)){
+        perror("sim_start");
+        sim_free_buffers();
+        return -1;
+    }
+
+    atomic_store(&sim.finished, 0);
+    atomic_store(&sim.running, 1);
+    if (pthread_create(&sim.thread, NULL, sim_thread, NULL) != 0){
+        perror("sim_start: pthread_create");
+        atomic_store(&sim.running, 0);
+        sim_free_buffers();
+        return -1;
+    }
+    return 0;
+}
+
+static int sim_stop(void){
+    if (!sim.in){
+        sim_free_resampler();
+        return 0;
+    }
+
+    atomic_store_explicit(&sim.running, 0, memory_order_release);
+    pthread_join(sim.thread, NULL);
+    sim_free_buffers();
+    return 0;
+}
+
+static int sim_finished(void){
+    return atomic_load(&sim.finished);
+}
+
+static int sim_active(void){
+    return atomic_load(&sim.running) && !atomic_load(&sim.finished);
+}
+
+/* arg: silence | sine | noise (def: sine) */
+static int null_init(const char *arg, int channels){
+    (void)channels;
+    sim.rng = 0x12345678u;
+    sim.source = SRC_SINE;
+    if (!arg || strcmp(arg, "sine") == 0)
+        return 0;
+    if (strcmp(arg, "silence") == 0)
+        sim.source = SRC_SILENCE;
+    else if (strcmp(arg, "noise") == 0)
+        sim.source = SRC_NOISE;
+    else {
+        fprintf(stderr, "null backend: unknown generator \"%s\"\n", arg);
+        return -1;
+    }
+    return 0;
+}
+
+/* arg: path to the WAV to play as input */
+static int file_init(const char *arg, int channels){
+    (void)channels;
+    if (!arg){
+        fprintf(stderr, "file backend: usage --backend file:PATH\n");
+        return -1;
+    }
+    sim.source = SRC_FILE;
+    sim.reader = wav_reader_open(arg);
+    if (!sim.reader)
+        return -1;
+    return 0;
+}
+
+static int sim_terminate(void){
+    sim_stop();
+    if (sim.reader){
+        wav_reader_close(sim.reader);
+        sim.reader = NULL;
+    }
+    return 0;
+}
+
+const audio_backend_t backend_null = {
+    "null", 0, null_init, sim_start, sim_stop, sim_terminate, sim_finished,
+    sim_active
+};
+
+const audio_backend_t backend_file = {
+    "file", 0, file_init, sim_start, sim_stop, sim_terminate, sim_finished,
+    sim_active
+};
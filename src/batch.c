@@ -0,0 +1,378 @@
+#include <errno.h>
+#include <glob.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdatomic.h>
+
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "batch.h"
+#include "app.h"
+
+typedef struct batch_file_t{
+    char *in;
+    char *out;
+    offline_result_t res;
+    int rc;
+} batch_file_t;
+
+/* the files of one worker: the owner pops from head, thieves take from
+ * tail. tasks are whole files, so a plain mutex per deque costs nothing
+ * next to the work it hands out */
+typedef struct batch_deque_t{
+    _Alignas(64) pthread_mutex_t lock;
+    size_t head;
+    size_t tail;
+} batch_deque_t;
+
+typedef struct batch_t batch_t;
+
+typedef struct batch_worker_t{
+    batch_t *b;
+    int id;
+    pthread_t thread;
+    offline_scratch_t scratch;
+    unsigned long files;
+    unsigned long steals;
+} batch_worker_t;
+
+struct batch_t{
+    batch_file_t *files;
+    size_t nfiles;
+    batch_deque_t *deques;
+    batch_worker_t *workers;
+    int jobs;
+    const offline_opts_t *o;
+    const audio_params_t *params;
+};
+
+static int has_wav_suffix(const char *name){
+    size_t n = strlen(name);
+    return n > 4 && strcasecmp(name + n - 4, ".wav") == 0;
+}
+
+static int add_file(batch_t *b, size_t *cap, const char *path){
+    if (b->nfiles == *cap){
+        size_t ncap = *cap ? *cap * 2 : 64;
+        batch_file_t *f = realloc(b->files, ncap * sizeof *f);
+        if (!f){
+            perror("batch: malloc");
+            return -1;
+        }
+        b->files = f;
+        *cap = ncap;
+    }
+    batch_file_t *f = &b->files[b->nfiles];
+    memset(f, 0, sizeof *f);
+    if (!(f->in = strdup(path))){
+        perror("batch: strdup");
+        return -1;
+    }
+    b->nfiles++;
+    return 0;
+}
+
+static int add_dir(batch_t *b, size_t *cap, const char *dir){
+    DIR *d = opendir(dir);
+    if (!d){
+        fprintf(stderr, "batch: %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+    struct dirent *e;
+    char path[4096];
+    int rc = 0;
+    while (rc == 0 && (e = readdir(d))){
+        if (e->d_name[0] == '.' || !has_wav_suffix(e->d_name))
+            continue;
+        snprintf(path, sizeof path, "%s/%s", dir, e->d_name);
+        rc = add_file(b, cap, path);
+    }
+    closedir(d);
+    return rc;
+}
+
+// directories contribute their *.wav, anything else is a glob pattern
+static int collect(batch_t *b, int argc, char *const argv[]){
+    size_t cap = 0;
+    for (int i = 0; i < argc; i++){
+        struct stat st;
+        if (stat(argv[i], &st) == 0 && S_ISDIR(st.st_mode)){
+            if (add_dir(b, &cap, argv[i]) < 0)
+                return -1;
+            continue;
+        }
+        glob_t g;
+        int grc = glob(argv[i], 0, NULL, &g);
+        if (grc == GLOB_NOMATCH){
+            fprintf(stderr, "batch: %s: no such file\n", argv[i]);
+            return -1;
+        }
+        if (grc != 0){
+            fprintf(stderr, "batch: %s: glob failed\n", argv[i]);
+            return -1;
+        }
+        for (size_t k = 0; k < g.gl_pathc; k++){
+            if (add_file(b, &cap, g.gl_pathv[k]) < 0){
+                globfree(&g);
+                return -1;
+            }
+        }
+        globfree(&g);
+    }
+    return 0;
+}
+
+static int cmp_path(const void *a, const void *b){
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static int cmp_file(const void *a, const void *b){
+    return strcmp(((const batch_file_t *)a)->in, ((const batch_file_t *)b)->in);
+}
+
+/* out = dir/basename(in). refuses to overwrite an input (it is mapped
+ * while its output is written) and two inputs with the same name */
+static int make_out_paths(batch_t *b, const char *dir){
+    if (mkdir(dir, 0777) < 0 && errno != EEXIST){
+        fprintf(stderr, "batch: %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+    for (size_t i = 0; i < b->nfiles; i++){
+        batch_file_t *f = &b->files[i];
+        const char *base = strrchr(f->in, '/');
+        base = base ? base + 1 : f->in;
+        size_t n = strlen(dir) + strlen(base) + 2;
+        if (!(f->out = malloc(n))){
+            perror("batch: malloc");
+            return -1;
+        }
+        snprintf(f->out, n, "%s/%s", dir, base);
+
+        struct stat si, so;
+        if (stat(f->out, &so) == 0 && stat(f->in, &si) == 0
+                && si.st_dev == so.st_dev && si.st_ino == so.st_ino){
+            fprintf(stderr, "batch: %s would overwrite its input\n", f->out);
+            return -1;
+        }
+    }
+
+    char **outs = malloc(b->nfiles * sizeof *outs);
+    if (!outs){
+        perror("batch: malloc");
+        return -1;
+    }
+    for (size_t i = 0; i < b->nfiles; i++)
+        outs[i] = b->files[i].out;
+    qsort(outs, b->nfiles, sizeof *outs, cmp_path);
+    int rc = 0;
+    for (size_t i = 1; i < b->nfiles && rc == 0; i++){
+        if (strcmp(outs[i - 1], outs[i]) == 0){
+            fprintf(stderr, "batch: more than one input named %s\n", outs[i]);
+            rc = -1;
+        }
+    }
+    free(outs);
+    return rc;
+}
+
+static int pop_own(batch_deque_t *q, size_t *idx){
+    int ok = 0;
+    pthread_mutex_lock(&q->lock);
+    if (q->head < q->tail){
+        *idx = q->head++;
+        ok = 1;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ok;
+}
+
+static int steal(batch_deque_t *q, size_t *idx){
+    int ok = 0;
+    pthread_mutex_lock(&q->lock);
+    if (q->head < q->tail){
+        *idx = --q->tail;
+        ok = 1;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ok;
+}
+
+// own deque first, then the others round robin from the next worker on
+static int next_task(batch_worker_t *w, size_t *idx){
+    batch_t *b = w->b;
+    if (pop_own(&b->deques[w->id], idx))
+        return 1;
+    for (int k = 1; k < b->jobs; k++){
+        if (steal(&b->deques[(w->id + k) % b->jobs], idx)){
+            w->steals++;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void *worker_main(void *arg){
+    batch_worker_t *w = arg;
+    batch_t *b = w->b;
+    size_t i;
+    while (next_task(w, &i)){
+        batch_file_t *f = &b->files[i];
+        f->rc = offline_file(b->o, f->in, f->out, b->params, &w->scratch, &f->res);
+        w->files++;
+        if (f->rc < 0){
+            fprintf(stderr, "batch: %s failed\n", f->in);
+            continue;
+        }
+        double audio_sec = (double)f->res.frames / f->res.sample_rate;
+        printf("[%2d] %s: %zu frames, %d ch, %.3f s (%.1fx realtime)\n",
+               w->id, f->in, f->res.frames, f->res.channels, f->res.seconds,
+               f->res.seconds > 0 ? audio_sec / f->res.seconds : 0.0);
+    }
+    return NULL;
+}
+
+static void report(const batch_t *b, double wall){
+    size_t failed = 0;
+    double frames = 0, samples = 0, audio_sec = 0, busy = 0;
+    for (size_t i = 0; i < b->nfiles; i++){
+        const batch_file_t *f = &b->files[i];
+        if (f->rc < 0){
+            failed++;
+            continue;
+        }
+        frames += f->res.frames;
+        samples += (double)f->res.frames * f->res.channels;
+        audio_sec += (double)f->res.frames / f->res.sample_rate;
+        busy += f->res.seconds;
+    }
+    unsigned long steals = 0;
+    for (int k = 0; k < b->jobs; k++)
+        steals += b->workers[k].steals;
+
+    size_t done = b->nfiles - failed;
+    printf("batch: %zu files (%zu failed), %.0f frames, %d jobs, %lu steals\n",
+           b->nfiles, failed, frames, b->jobs, steals);
+    printf("batch: %.3f s wall, %.1f files/s, %.2f Msamples/s, %.1fx realtime, "
+           "%.2f jobs busy on average\n",
+           wall, wall > 0 ? done / wall : 0.0, wall > 0 ? samples / wall * 1e-6 : 0.0,
+           wall > 0 ? audio_sec / wall : 0.0, wall > 0 ? busy / wall : 0.0);
+}
+
+static void batch_free(batch_t *b){
+    for (size_t i = 0; i < b->nfiles; i++){
+        free(b->files[i].in);
+        free(b->files[i].out);
+    }
+    free(b->files);
+    if (b->deques){
+        for (int k = 0; k < b->jobs; k++)
+            pthread_mutex_destroy(&b->deques[k].lock);
+        free(b->deques);
+    }
+    if (b->workers){
+        for (int k = 0; k < b->jobs; k++){
+            free(b->workers[k].scratch.buf);
+            free(b->workers[k].scratch.out);
+            arena_free(&b->workers[k].scratch.arena);
+        }
+        free(b->workers);
+    }
+}
+
+static int batch_check_chain(const char *spec, const audio_params_t *params){
+    arena_t arena;
+    effect_chain_t chain = {0};
+    if (arena_init(&arena, BATCH_ARENA_SIZE) < 0)
+        return -1;
+    int rc = chain_parse(&chain, spec, params, &arena);
+    arena_free(&arena);
+    return rc;
+}
+
+int batch_run(int argc, char *const argv[], const offline_opts_t *o,
+        const audio_params_t *params){
+    if (!o->out_path || argc < 1){
+        fprintf(stderr, "usage: %s batch --out DIR [--effect CHAIN] [--jobs N] "
+                "DIR|FILE|'GLOB'...\n", progname);
+        return -1;
+    }
+
+    batch_t b = {0};
+    b.o = o;
+    b.params = params;
+
+    int rc = -1;
+    if (collect(&b, argc, argv) < 0)
+        goto out;
+    if (b.nfiles == 0){
+        fprintf(stderr, "batch: no .wav files\n");
+        goto out;
+    }
+    qsort(b.files, b.nfiles, sizeof *b.files, cmp_file);
+    // a bad spec would fail every file, say it once before anything runs
+    if (o->chain_spec && batch_check_chain(o->chain_spec, params) < 0)
+        goto out;
+    if (make_out_paths(&b, o->out_path) < 0)
+        goto out;
+
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    b.jobs = o->jobs > 0 ? o->jobs : (ncpu > 0 ? (int)ncpu : 1);
+    if (b.jobs > OFFLINE_MAX_JOBS)
+        b.jobs = OFFLINE_MAX_JOBS;
+    if ((size_t)b.jobs > b.nfiles)
+        b.jobs = (int)b.nfiles;
+
+    b.deques = aligned_alloc(64, sizeof *b.deques * b.jobs);
+    b.workers = calloc(b.jobs, sizeof *b.workers);
+    if (!b.deques || !b.workers){
+        perror("batch: malloc");
+        free(b.deques);
+        b.deques = NULL;
+        b.jobs = 0;
+        goto out;
+    }
+
+    // contiguous, equal shares; stealing evens out uneven file lengths
+    for (int k = 0; k < b.jobs; k++){
+        pthread_mutex_init(&b.deques[k].lock, NULL);
+        b.deques[k].head = b.nfiles * k / b.jobs;
+        b.deques[k].tail = b.nfiles * (k + 1) / b.jobs;
+        b.workers[k].b = &b;
+        b.workers[k].id = k;
+    }
+    for (int k = 0; k < b.jobs; k++){
+        if (arena_init(&b.workers[k].scratch.arena, BATCH_ARENA_SIZE) < 0)
+            goto out;
+    }
+
+    double t0 = offline_now();
+    int started = 0;
+    for (; started < b.jobs; started++){
+        int err = pthread_create(&b.workers[started].thread, NULL, worker_main,
+                &b.workers[started]);
+        if (err){
+            fprintf(stderr, "batch: pthread_create: %s\n", strerror(err));
+            break;
+        }
+    }
+    // if a thread failed to start, the running ones steal its files
+    if (started == 0)
+        worker_main(&b.workers[0]);
+    for (int k = 0; k < started; k++)
+        pthread_join(b.workers[k].thread, NULL);
+    double wall = offline_now() - t0;
+
+    report(&b, wall);
+    rc = 0;
+    for (size_t i = 0; i < b.nfiles; i++)
+        if (b.files[i].rc < 0)
+            rc = -1;
+out:
+    batch_free(&b);
+    return rc;
+}
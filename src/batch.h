@@ -0,0 +1,15 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "audio_types.h"
+#include "offline.h"
+
+#define BATCH_ARENA_SIZE (16u << 20)   // effect state per worker
+
+/* wavecli batch: every WAV under the given directories/globs through the
+ * --effect chain into the --out directory, one file per task, spread over
+ * a work-stealing pool */
+int batch_run(int argc, char *const argv[], const offline_opts_t *o,
+        const audio_params_t *params);
+
+#endif
@@ -0,0 +1,231 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <float.h>
+#include <unistd.h>
+
+#include "../audio_types.h"
+#include "../effect.h"
+#include "../kernels.h"
+#include "../arena.h"
+#include "../wav.h"
+#include "../fft.h"
+#include "../biquad.h"
+#include "../convolver.h"
+#include "../resample.h"
+
+/* microbenchmarks, one CSV row per measurement on stdout:
+ *   effect,<kernels>,<name>,<block>,<channels>,<input>,<ns/sample>,<GB/s>
+ *   wav_write,-,float32,<buffer bytes>,<channels>,-,<ns/sample>,<GB/s>
+ *   fft,-,forward,<points>,1,-,<ns/sample>,<GB/s>
+ *   resample,<kernels>,<quality>,<block>,<channels>,<in>-<out>,<ns/sample>,<Msamples/s>
+ * resample counts input samples, frames times channels
+ * usage: bench [--quick] [--wav-path PATH] */
+
+#define MIN_SAMPLES   (1u << 21)    // per timed run
+#define RUNS          (5)           // best of
+#define WAV_BYTES     (64u << 20)
+
+static const unsigned long blocks[] = { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192 };
+static const int channels[] = { 1, 2, 8 };
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void fill(SAMPLE *x, size_t n, int denormal) {
+    uint32_t r = 0x9E3779B9u;
+    for (size_t i = 0; i < n; i++) {
+        r ^= r << 13; r ^= r >> 17; r ^= r << 5;
+        float v = (float)(r >> 8) * (2.0f / 16777216.0f) - 1.0f;
+        x[i] = denormal ? v * (FLT_MIN / 8) : v * 0.2f;
+    }
+}
+
+static void bench_effect(const dsp_kernels_t *k, const effect_t *e,
+                         unsigned long block, int ch, int denormal, arena_t *arena) {
+    audio_params_t p = {
+        .channels = ch, .gain = 10.0f,
+        .sample_rate = DEFAULT_SAMPLE_RATE, .frames_per_buffer = block,
+    };
+
+    // needs an impulse response file, not part of the bench
+    if (e->func == convolver_process)
+        return;
+
+    arena_reset(arena);
+    void *state = effect_state_create(e, &p, arena);
+    if (e->state_size && !state)
+        return;
+    // four bands, the common multi-band EQ case
+    if (e->func == eq_process)
+        for (int b = 0; b < 4; b++)
+            eq_set_band(state, b, BIQUAD_PEAK, 100.0f * (b + 1) * (b + 1), 1.0f, 3.0f);
+
+    const size_t n = block * (size_t)ch;
+    SAMPLE *src = aligned_alloc(64, ((n * sizeof(SAMPLE)) + 63) & ~(size_t)63);
+    SAMPLE *buf = aligned_alloc(64, ((n * sizeof(SAMPLE)) + 63) & ~(size_t)63);
+    fill(src, n, denormal);
+
+    const size_t iters = MIN_SAMPLES / n + 1;
+    double best = 1e300;
+    for (int r = 0; r < RUNS; r++) {
+        double t0 = now_ns();
+        for (size_t i = 0; i < iters; i++) {
+            // refresh so clipping does not saturate the data run after run
+            if ((i & 63) == 0)
+                memcpy(buf, src, n * sizeof(SAMPLE));
+            e->func(buf, block, &p, state);
+        }
+        double dt = now_ns() - t0;
+        if (dt < best)
+            best = dt;
+    }
+
+    double samples = (double)iters * (double)n;
+    double ns = best / samples;
+    printf("effect,%s,%s,%lu,%d,%s,%.4f,%.3f\n", k->name, e->name, block, ch,
+           denormal ? "denormal" : "normal", ns, sizeof(SAMPLE) / ns);
+    free(src);
+    free(buf);
+}
+
+static void bench_wav_write(const char *path, size_t buffer_bytes, int ch) {
+    unsigned char *buf = malloc(buffer_bytes);
+    memset(buf, 0x3c, buffer_bytes);
+
+    double best = 1e300;
+    for (int r = 0; r < 3; r++) {
+        wav_writer *w = wav_open(path, WAVE_FORMAT_IEEE_FLOAT, DEFAULT_SAMPLE_RATE, ch, 32);
+        if (!w)
+            break;
+        double t0 = now_ns();
+        for (size_t done = 0; done < WAV_BYTES; done += buffer_bytes)
+            wav_write(w, buf, buffer_bytes);
+        wav_close(w);
+        double dt = now_ns() - t0;
+        if (dt < best)
+            best = dt;
+    }
+    unlink(path);
+
+    size_t total = (WAV_BYTES / buffer_bytes) * buffer_bytes;
+    double ns = best / (double)(total / sizeof(SAMPLE));
+    printf("wav_write,-,float32,%zu,%d,-,%.4f,%.3f\n", buffer_bytes, ch, ns,
+           (double)total / best);
+    free(buf);
+}
+
+static void bench_fft(size_t n) {
+    fft_t f;
+    if (fft_init(&f, n) < 0)
+        return;
+    float *x = malloc(sizeof(float) * n);
+    float *re = malloc(sizeof(float) * (n / 2 + 1));
+    float *im = malloc(sizeof(float) * (n / 2 + 1));
+    fill(x, n, 0);
+
+    const size_t iters = MIN_SAMPLES / n + 1;
+    double best = 1e300;
+    for (int r = 0; r < RUNS; r++) {
+        double t0 = now_ns();
+        for (size_t i = 0; i < iters; i++)
+            fft_forward(&f, x, re, im);
+        double dt = now_ns() - t0;
+        if (dt < best)
+            best = dt;
+    }
+
+    double ns = best / ((double)iters * (double)n);
+    printf("fft,-,forward,%zu,1,-,%.4f,%.3f\n", n, ns, sizeof(float) / ns);
+    free(x); free(re); free(im);
+    fft_free(&f);
+}
+
+static const int rate_pairs[][2] = { { 44100, 48000 }, { 48000, 44100 }, { 48000, 96000 } };
+
+static void bench_resample(const dsp_kernels_t *k, int quality, const int rates[2],
+                           unsigned long block, int ch) {
+    resampler_t *r = resampler_create(rates[0], rates[1], ch, quality);
+    if (!r)
+        return;
+    const size_t n = block * (size_t)ch;
+    SAMPLE *src = malloc(sizeof(SAMPLE) * n);
+    SAMPLE *dst = malloc(sizeof(SAMPLE) * resampler_out_max(r, block) * ch);
+    fill(src, n, 0);
+
+    const size_t iters = MIN_SAMPLES / n + 1;
+    double best = 1e300;
+    for (int run = 0; run < RUNS; run++) {
+        double t0 = now_ns();
+        for (size_t i = 0; i < iters; i++)
+            resampler_process(r, src, block, dst);
+        double dt = now_ns() - t0;
+        if (dt < best)
+            best = dt;
+    }
+
+    double ns = best / ((double)iters * (double)n);
+    printf("resample,%s,%s,%lu,%d,%d-%d,%.4f,%.3f\n", k->name, resample_quality_name(quality),
+           block, ch, rates[0], rates[1], ns, 1e3 / ns);
+    resampler_free(r);
+    free(src);
+    free(dst);
+}
+
+int main(int argc, char *argv[]) {
+    int quick = 0;
+    const char *wav_path = "./bench_tmp.wav";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0)
+            quick = 1;
+        else if (strcmp(argv[i], "--wav-path") == 0 && i + 1 < argc)
+            wav_path = argv[++i];
+    }
+
+    arena_t arena;
+    if (arena_init(&arena, 1u << 20) < 0)
+        return 1;
+
+    const dsp_kernels_t *sets[8];
+    size_t nsets = dsp_kernels_available(sets, 8);
+
+    printf("bench,kernels,name,block,channels,input,ns_per_sample,gb_per_s\n");
+    for (size_t s = 0; s < nsets; s++) {
+        dsp_kernels_select(sets[s]->name);
+        for (size_t e = 0; e < effects_count; e++)
+            for (size_t b = 0; b < sizeof(blocks) / sizeof(blocks[0]); b++) {
+                if (quick && blocks[b] != 256)
+                    continue;
+                for (size_t c = 0; c < sizeof(channels) / sizeof(channels[0]); c++)
+                    for (int d = 0; d <= 1; d++)
+                        bench_effect(sets[s], &effects[e], blocks[b], channels[c], d, &arena);
+            }
+        fflush(stdout);
+    }
+
+    for (size_t s = 0; s < nsets; s++) {
+        dsp_kernels_select(sets[s]->name);
+        for (int q = 0; q < RESAMPLE_QUALITIES; q++)
+            for (size_t r = 0; r < sizeof(rate_pairs) / sizeof(rate_pairs[0]); r++)
+                for (size_t c = 0; c < sizeof(channels) / sizeof(channels[0]); c++) {
+                    if (quick && (r > 0 || channels[c] != 2))
+                        continue;
+                    bench_resample(sets[s], q, rate_pairs[r], 4096, channels[c]);
+                }
+        fflush(stdout);
+    }
+
+    for (size_t bytes = 4096; bytes <= (1u << 20); bytes *= quick ? 256 : 4)
+        bench_wav_write(wav_path, bytes, 2);
+
+    for (size_t n = 256; n <= 16384; n *= quick ? 16 : 2)
+        bench_fft(n);
+
+    arena_free(&arena);
+    return 0;
+}
@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "biquad.h"
+#include "kernels.h"
+#include "ringbuf.h"
+
+static const char *const type_names[BIQUAD_TYPES] = {
+    [BIQUAD_LOWPASS] = "lowpass",
+    [BIQUAD_HIGHPASS] = "highpass",
+    [BIQUAD_BANDPASS] = "bandpass",
+    [BIQUAD_NOTCH] = "notch",
+    [BIQUAD_PEAK] = "peak",
+    [BIQUAD_LOWSHELF] = "lowshelf",
+    [BIQUAD_HIGHSHELF] = "highshelf",
+};
+
+static const char *const type_aliases[BIQUAD_TYPES] = {
+    "lp", "hp", "bp", "no", "pk", "ls", "hs",
+};
+
+static const float identity[5] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+
+int biquad_type_parse(const char *name, biquad_type_t *type){
+    for (int i = 0; i < BIQUAD_TYPES; i++){
+        if (strcmp(name, type_names[i]) == 0 || strcmp(name, type_aliases[i]) == 0){
+            *type = (biquad_type_t)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *biquad_type_name(biquad_type_t type){
+    return type < BIQUAD_TYPES ? type_names[type] : "?";
+}
+
+int biquad_design(float c[5], biquad_type_t type, double sample_rate,
+        double freq, double q, double gain_db)
+{
+    if (freq <= 0.0 || freq >= 0.5 * sample_rate || q <= 0.0)
+        return -1;
+
+    const double w0 = 2.0 * M_PI * freq / sample_rate;
+    const double cw = cos(w0);
+    const double alpha = sin(w0) / (2.0 * q);
+    const double a = pow(10.0, gain_db / 40.0);
+    const double sa = 2.0 * sqrt(a) * alpha;
+    double b0, b1, b2, a0, a1, a2;
+
+    switch (type){
+    case BIQUAD_LOWPASS:
+        b0 = (1.0 - cw) / 2.0; b1 = 1.0 - cw; b2 = b0;
+        a0 = 1.0 + alpha; a1 = -2.0 * cw; a2 = 1.0 - alpha;
+        break;
+    case BIQUAD_HIGHPASS:
+        b0 = (1.0 + cw) / 2.0; b1 = -(1.0 + cw); b2 = b0;
+        a0 = 1.0 + alpha; a1 = -2.0 * cw; a2 = 1.0 - alpha;
+        break;
+    case BIQUAD_BANDPASS:   // 0 dB peak gain
+        b0 = alpha; b1 = 0.0; b2 = -alpha;
+        a0 = 1.0 + alpha; a1 = -2.0 * cw; a2 = 1.0 - alpha;
+        break;
+    case BIQUAD_NOTCH:
+        b0 = 1.0; b1 = -2.0 * cw; b2 = 1.0;
+        a0 = 1.0 + alpha; a1 = -2.0 * cw; a2 = 1.0 - alpha;
+        break;
+    case BIQUAD_PEAK:
+        b0 = 1.0 + alpha * a; b1 = -2.0 * cw; b2 = 1.0 - alpha * a;
+        a0 = 1.0 + alpha / a; a1 = -2.0 * cw; a2 = 1.0 - alpha / a;
+        break;
+    case BIQUAD_LOWSHELF:
+        b0 = a * ((a + 1.0) - (a - 1.0) * cw + sa);
+        b1 = 2.0 * a * ((a - 1.0) - (a + 1.0) * cw);
+        b2 = a * ((a + 1.0) - (a - 1.0) * cw - sa);
+        a0 = (a + 1.0) + (a - 1.0) * cw + sa;
+        a1 = -2.0 * ((a - 1.0) + (a + 1.0) * cw);
+        a2 = (a + 1.0) + (a - 1.0) * cw - sa;
+        break;
+    case BIQUAD_HIGHSHELF:
+        b0 = a * ((a + 1.0) + (a - 1.0) * cw + sa);
+        b1 = -2.0 * a * ((a - 1.0) + (a + 1.0) * cw);
+        b2 = a * ((a + 1.0) + (a - 1.0) * cw - sa);
+        a0 = (a + 1.0) - (a - 1.0) * cw + sa;
+        a1 = 2.0 * ((a - 1.0) - (a + 1.0) * cw);
+        a2 = (a + 1.0) - (a - 1.0) * cw - sa;
+        break;
+    default:
+        return -1;
+    }
+
+    c[0] = (float)(b0 / a0);
+    c[1] = (float)(b1 / a0);
+    c[2] = (float)(b2 / a0);
+    c[3] = (float)(a1 / a0);
+    c[4] = (float)(a2 / a0);
+    return 0;
+}
+
+/* ---- eq effect ---- */
+
+size_t eq_state_size(const audio_params_t *p){
+    return sizeof(eq_state_t) + 2 * sizeof(float) * EQ_MAX_BANDS * (size_t)p->channels;
+}
+
+int eq_init(void *state, const audio_params_t *p){
+    eq_state_t *st = state;
+    st->channels = p->channels;
+    st->sample_rate = p->sample_rate;
+    st->smooth = (float)(1.0 - exp(-EQ_SMOOTH_FRAMES / (EQ_SMOOTH_SEC * p->sample_rate)));
+    st->z1 = st->z;
+    st->z2 = st->z + EQ_MAX_BANDS * p->channels;
+    for (int b = 0; b < EQ_MAX_BANDS; b++){
+        memcpy(st->cur[b], identity, sizeof identity);
+        memcpy(st->target[b], identity, sizeof identity);
+    }
+    return ringbuf_init_mem(&st->queue, st->queue_mem, EQ_QUEUE_BYTES);
+}
+
+/* a rebuilt instance keeps the bands, designed again for its own rate and
+ * in place from the start: it is not live yet, nothing glides */
+int eq_carry(void *state, const void *old){
+    eq_state_t *st = state;
+    const eq_state_t *o = old;
+    for (int b = 0; b < EQ_MAX_BANDS; b++){
+        const eq_band_desc_t *d = &o->desc[b];
+        if (!d->on)
+            continue;
+        float c[5];
+        if (biquad_design(c, d->type, st->sample_rate, d->freq, d->q, d->gain_db) < 0){
+            fprintf(stderr, "eq: band %d at %.0f Hz does not fit %d Hz\n", b, d->freq,
+                    st->sample_rate);
+            return -1;
+        }
+        memcpy(st->cur[b], c, sizeof c);
+        memcpy(st->target[b], c, sizeof c);
+        st->active[b] = 1;
+        st->desc[b] = *d;
+    }
+    return 0;
+}
+
+static void glide(eq_state_t *st){
+    for (int b = 0; b < EQ_MAX_BANDS; b++){
+        if (!st->gliding[b])
+            continue;
+        float diff = 0.0f;
+        int moved = 0;
+        for (int i = 0; i < 5; i++){
+            float d = st->target[b][i] - st->cur[b][i];
+            float c = st->cur[b][i] + st->smooth * d;
+            moved |= c != st->cur[b][i];
+            st->cur[b][i] = c;
+            diff = fmaxf(diff, fabsf(d));
+        }
+        // close enough, or the step fell below float resolution
+        if (diff > 1e-5f && moved)
+            continue;
+
+        memcpy(st->cur[b], st->target[b], sizeof st->cur[b]);
+        st->gliding[b] = 0;
+        // a band switched off has glided to identity, drop it
+        if (memcmp(st->cur[b], identity, sizeof identity) == 0){
+            st->active[b] = 0;
+            memset(st->z1 + b * st->channels, 0, sizeof(float) * st->channels);
+            memset(st->z2 + b * st->channels, 0, sizeof(float) * st->channels);
+        }
+    }
+}
+
+void eq_process(SAMPLE *samples, unsigned long frameCount, const audio_params_t *p, void *state){
+    eq_state_t *st = state;
+    const int ch = st->channels;
+    if (p->channels != ch)
+        return;
+
+    eq_msg_t msg;
+    while (ringbuf_read_space(&st->queue) >= sizeof msg){
+        ringbuf_pop(&st->queue, &msg, sizeof msg);
+        if (msg.band < 0 || msg.band >= EQ_MAX_BANDS)
+            continue;
+        memcpy(st->target[msg.band], msg.c, sizeof msg.c);
+        st->gliding[msg.band] = 1;
+        st->active[msg.band] = 1;
+    }
+
+    const dsp_kernels_t *k = dsp_kernels();
+    unsigned long done = 0;
+    while (done < frameCount){
+        unsigned long n = EQ_SMOOTH_FRAMES - st->phase;
+        if (n > frameCount - done)
+            n = frameCount - done;
+
+        for (int b = 0; b < EQ_MAX_BANDS; b++){
+            if (st->active[b])
+                k->biquad(samples + done * ch, n, ch, st->cur[b],
+                          st->z1 + b * ch, st->z2 + b * ch);
+        }
+        st->phase += n;
+        done += n;
+        if (st->phase == EQ_SMOOTH_FRAMES){
+            st->phase = 0;
+            glide(st);
+        }
+    }
+
+    // decaying tails would otherwise sink into denormals
+    for (int i = 0; i < EQ_MAX_BANDS * ch; i++){
+        if (fabsf(st->z1[i]) < 1e-20f) st->z1[i] = 0.0f;
+        if (fabsf(st->z2[i]) < 1e-20f) st->z2[i] = 0.0f;
+    }
+}
+
+static int eq_queue(eq_state_t *st, int band, const float c[5]){
+    eq_msg_t msg = { .band = band };
+    memcpy(msg.c, c, sizeof msg.c);
+    if (ringbuf_push(&st->queue, &msg, sizeof msg) != sizeof msg){
+        fprintf(stderr, "eq: update queue full, is the stream running?\n");
+        return -1;
+    }
+    return 0;
+}
+
+int eq_set_band(eq_state_t *st, int band, biquad_type_t type, float freq,
+        float q, float gain_db)
+{
+    float c[5];
+    if (band < 0 || band >= EQ_MAX_BANDS){
+        fprintf(stderr, "eq: band 0..%d\n", EQ_MAX_BANDS - 1);
+        return -1;
+    }
+    if (biquad_design(c, type, st->sample_rate, freq, q, gain_db) < 0){
+        fprintf(stderr, "eq: need 0 < freq < %d Hz and q > 0\n", st->sample_rate / 2);
+        return -1;
+    }
+    if (eq_queue(st, band, c) < 0)
+        return -1;
+
+    st->desc[band] = (eq_band_desc_t){ 1, type, freq, q, gain_db };
+    return 0;
+}
+
+int eq_band_off(eq_state_t *st, int band){
+    if (band < 0 || band >= EQ_MAX_BANDS)
+        return -1;
+    if (eq_queue(st, band, identity) < 0)
+        return -1;
+    st->desc[band].on = 0;
+    return 0;
+}
+
+void eq_fprint(FILE *out, const eq_state_t *st){
+    int any = 0;
+    for (int b = 0; b < EQ_MAX_BANDS; b++){
+        const eq_band_desc_t *d = &st->desc[b];
+        if (!d->on)
+            continue;
+        fprintf(out, "  band %d: %-9s %8.1f Hz  q %.2f  %+.1f dB\n", b,
+                biquad_type_name(d->type), d->freq, d->q, d->gain_db);
+        any = 1;
+    }
+    if (!any)
+        fprintf(out, "  no bands, flat\n");
+}
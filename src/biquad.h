@@ -0,0 +1,82 @@
+#ifndef BIQUAD_H
+#define BIQUAD_H
+
+#include <stdio.h>
+
+#include "audio_types.h"
+#include "ringbuf.h"
+
+#define EQ_MAX_BANDS      (8)
+#define EQ_SMOOTH_FRAMES  (32)      // coefficients step once per this many frames
+#define EQ_SMOOTH_SEC     (0.02)    // time constant of the coefficient glide
+#define EQ_QUEUE_BYTES    (2048)
+
+typedef enum biquad_type_t{
+    BIQUAD_LOWPASS,
+    BIQUAD_HIGHPASS,
+    BIQUAD_BANDPASS,
+    BIQUAD_NOTCH,
+    BIQUAD_PEAK,
+    BIQUAD_LOWSHELF,
+    BIQUAD_HIGHSHELF,
+    BIQUAD_TYPES,
+} biquad_type_t;
+
+/* RBJ cookbook section normalized to a0 = 1: c = { b0, b1, b2, a1, a2 } */
+int biquad_design(float c[5], biquad_type_t type, double sample_rate,
+        double freq, double q, double gain_db);
+int biquad_type_parse(const char *name, biquad_type_t *type);
+const char *biquad_type_name(biquad_type_t type);
+
+// coefficient update, TUI -> audio thread
+typedef struct eq_msg_t{
+    int band;
+    float c[5];
+} eq_msg_t;
+
+// what the TUI last asked for, touched by the TUI only
+typedef struct eq_band_desc_t{
+    int on;
+    biquad_type_t type;
+    float freq;
+    float q;
+    float gain_db;
+} eq_band_desc_t;
+
+/* "eq" effect: up to EQ_MAX_BANDS cascaded sections with per-channel state.
+ * the TUI designs coefficients and queues them, the callback glides the
+ * running coefficients toward them so changes do not click */
+typedef struct eq_state_t{
+    int channels;
+    int sample_rate;
+    float smooth;           // glide step per EQ_SMOOTH_FRAMES
+    int phase;              // frames into the current glide step
+
+    ringbuf_t queue;
+    _Alignas(64) unsigned char queue_mem[EQ_QUEUE_BYTES];
+
+    // audio thread only
+    float cur[EQ_MAX_BANDS][5];
+    float target[EQ_MAX_BANDS][5];
+    int gliding[EQ_MAX_BANDS];
+    int active[EQ_MAX_BANDS];
+
+    eq_band_desc_t desc[EQ_MAX_BANDS];
+
+    float *z1;              // EQ_MAX_BANDS * channels
+    float *z2;
+    float z[];
+} eq_state_t;
+
+size_t eq_state_size(const audio_params_t *p);
+int eq_init(void *state, const audio_params_t *p);
+int eq_carry(void *state, const void *old);
+void eq_process(SAMPLE *samples, unsigned long frameCount, const audio_params_t *p, void *state);
+
+// TUI side
+int eq_set_band(eq_state_t *st, int band, biquad_type_t type, float freq,
+        float q, float gain_db);
+int eq_band_off(eq_state_t *st, int band);
+void eq_fprint(FILE *out, const eq_state_t *st);
+
+#endif
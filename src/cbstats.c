@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cbstats.h"
+#include "portaudio.h"
+
+static const char *phase_names[CBSTATS_PHASES] = { "dsp", "record", "meter", "total" };
+
+void cbstats_record(cbstats_t *s, const uint32_t ns[CBSTATS_PHASES],
+        uint32_t budget_ns, unsigned long status_flags)
+{
+    const memory_order rx = memory_order_relaxed;
+    unsigned long long n = atomic_load_explicit(&s->blocks, rx);
+    size_t slot = n & (CBSTATS_RING - 1);
+
+    for (int p = 0; p < CBSTATS_PHASES; p++)
+        atomic_store_explicit(&s->ns[p][slot], ns[p], rx);
+    atomic_store_explicit(&s->budget_ns[slot], budget_ns, rx);
+
+    uint64_t pct = budget_ns ? (uint64_t)ns[CBSTATS_TOTAL] * 100 / budget_ns : 100;
+    size_t bucket = pct / CBSTATS_HIST_STEP;
+    if (bucket >= CBSTATS_HIST_BUCKETS)
+        bucket = CBSTATS_HIST_BUCKETS - 1;
+    atomic_fetch_add_explicit(&s->hist[bucket], 1, rx);
+
+    if (status_flags & paInputOverflow)
+        atomic_fetch_add_explicit(&s->input_overflow, 1, rx);
+    if (status_flags & paInputUnderflow)
+        atomic_fetch_add_explicit(&s->input_underflow, 1, rx);
+    if (status_flags & paOutputOverflow)
+        atomic_fetch_add_explicit(&s->output_overflow, 1, rx);
+    if (status_flags & paOutputUnderflow)
+        atomic_fetch_add_explicit(&s->output_underflow, 1, rx);
+
+    // publish last so a reader never sees a slot counted before it is filled
+    atomic_store_explicit(&s->blocks, n + 1, memory_order_release);
+}
+
+void cbstats_reset(cbstats_t *s){
+    // racing with the callback only loses a few samples
+    atomic_store(&s->blocks, 0);
+    for (int i = 0; i < CBSTATS_HIST_BUCKETS; i++)
+        atomic_store(&s->hist[i], 0);
+    atomic_store(&s->input_overflow, 0);
+    atomic_store(&s->input_underflow, 0);
+    atomic_store(&s->output_overflow, 0);
+    atomic_store(&s->output_underflow, 0);
+}
+
+static int cmp_u32(const void *a, const void *b){
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static size_t snapshot(cbstats_t *s, enum cbstats_phase p, uint32_t *out){
+    unsigned long long n = atomic_load_explicit(&s->blocks, memory_order_acquire);
+    size_t cnt = n < CBSTATS_RING ? (size_t)n : CBSTATS_RING;
+    for (size_t i = 0; i < cnt; i++)
+        out[i] = atomic_load_explicit(&s->ns[p][i], memory_order_relaxed);
+    return cnt;
+}
+
+static uint32_t percentile(const uint32_t *sorted, size_t n, double q){
+    if (n == 0)
+        return 0;
+    size_t i = (size_t)(q * (double)(n - 1) + 0.5);
+    return sorted[i];
+}
+
+void cbstats_fprint(FILE *file, cbstats_t *s){
+    static uint32_t v[CBSTATS_RING];
+    unsigned long long blocks = atomic_load(&s->blocks);
+    if (blocks == 0){
+        fprintf(file, "stats: no callbacks yet\n");
+        return;
+    }
+
+    size_t n = blocks < CBSTATS_RING ? (size_t)blocks : CBSTATS_RING;
+    uint32_t budget = atomic_load(&s->budget_ns[(blocks - 1) & (CBSTATS_RING - 1)]);
+
+    fprintf(file, "callbacks: %llu, last %zu shown, budget %.1f us per block\n",
+            blocks, n, budget / 1e3);
+    fprintf(file, "%-8s %10s %10s %10s\n", "PHASE", "p50 us", "p99 us", "max us");
+    for (int p = 0; p < CBSTATS_PHASES; p++){
+        n = snapshot(s, p, v);
+        qsort(v, n, sizeof v[0], cmp_u32);
+        fprintf(file, "%-8s %10.2f %10.2f %10.2f\n", phase_names[p],
+                percentile(v, n, 0.50) / 1e3, percentile(v, n, 0.99) / 1e3,
+                n ? v[n - 1] / 1e3 : 0.0);
+    }
+
+    // margin: what is left of the budget, worst case first
+    n = snapshot(s, CBSTATS_TOTAL, v);
+    qsort(v, n, sizeof v[0], cmp_u32);
+    fprintf(file, "margin: p50 %.1f%%  p99 %.1f%%  min %.1f%%\n",
+            100.0 * (1.0 - (double)percentile(v, n, 0.50) / budget),
+            100.0 * (1.0 - (double)percentile(v, n, 0.99) / budget),
+            100.0 * (1.0 - (double)v[n - 1] / budget));
+
+    fprintf(file, "xruns: input overflow %lu, input underflow %lu, "
+            "output overflow %lu, output underflow %lu\n",
+            atomic_load(&s->input_overflow), atomic_load(&s->input_underflow),
+            atomic_load(&s->output_overflow), atomic_load(&s->output_underflow));
+
+    unsigned long long hist[CBSTATS_HIST_BUCKETS], peak = 1;
+    for (int i = 0; i < CBSTATS_HIST_BUCKETS; i++){
+        hist[i] = atomic_load(&s->hist[i]);
+        if (hist[i] > peak)
+            peak = hist[i];
+    }
+
+    const int width = 40;
+    fprintf(file, "budget used (all callbacks):\n");
+    for (int i = 0; i < CBSTATS_HIST_BUCKETS; i++){
+        if (hist[i] == 0)
+            continue;
+        int bar = (int)(hist[i] * width / peak);
+        if (i == CBSTATS_HIST_BUCKETS - 1)
+            fprintf(file, "   >100%% ");
+        else
+            fprintf(file, "%3d-%3d%% ", i * CBSTATS_HIST_STEP, (i + 1) * CBSTATS_HIST_STEP);
+        fprintf(file, "|%-*.*s| %llu\n", width, bar,
+                "########################################", hist[i]);
+    }
+}
+
+/* one row per recent callback, oldest first */
+int cbstats_write_csv(cbstats_t *s, const char *path){
+    FILE *f = fopen(path, "w");
+    if (!f){
+        perror("cbstats_write_csv");
+        return -1;
+    }
+
+    unsigned long long blocks = atomic_load_explicit(&s->blocks, memory_order_acquire);
+    unsigned long long first = blocks > CBSTATS_RING ? blocks - CBSTATS_RING : 0;
+
+    fprintf(f, "block,dsp_ns,record_ns,meter_ns,total_ns,budget_ns\n");
+    for (unsigned long long b = first; b < blocks; b++){
+        size_t i = b & (CBSTATS_RING - 1);
+        fprintf(f, "%llu,%u,%u,%u,%u,%u\n", b,
+                atomic_load_explicit(&s->ns[CBSTATS_DSP][i], memory_order_relaxed),
+                atomic_load_explicit(&s->ns[CBSTATS_REC][i], memory_order_relaxed),
+                atomic_load_explicit(&s->ns[CBSTATS_METER][i], memory_order_relaxed),
+                atomic_load_explicit(&s->ns[CBSTATS_TOTAL][i], memory_order_relaxed),
+                atomic_load_explicit(&s->budget_ns[i], memory_order_relaxed));
+    }
+
+    return fclose(f) == 0 ? 0 : -1;
+}
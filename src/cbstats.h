@@ -0,0 +1,48 @@
+#ifndef CBSTATS_H
+#define CBSTATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <stdatomic.h>
+
+#define CBSTATS_RING (4096)     // recent blocks kept for percentiles, pow2
+#define CBSTATS_HIST_STEP (5)   // histogram bucket width, % of budget
+#define CBSTATS_HIST_BUCKETS (100 / CBSTATS_HIST_STEP + 1) // last: over budget
+
+enum cbstats_phase {
+    CBSTATS_DSP,
+    CBSTATS_REC,
+    CBSTATS_METER,
+    CBSTATS_TOTAL,
+    CBSTATS_PHASES,
+};
+
+/* per-callback timing, written only by the audio thread with relaxed
+ * atomics and read by the TUI. no locks, no allocation */
+typedef struct cbstats_t{
+    _Atomic uint32_t ns[CBSTATS_PHASES][CBSTATS_RING];
+    _Atomic uint32_t budget_ns[CBSTATS_RING];
+    _Atomic unsigned long long blocks;
+
+    _Atomic unsigned long long hist[CBSTATS_HIST_BUCKETS];
+    _Atomic unsigned long input_overflow;
+    _Atomic unsigned long input_underflow;
+    _Atomic unsigned long output_overflow;
+    _Atomic unsigned long output_underflow;
+} cbstats_t;
+
+static inline uint64_t cbstats_now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+void cbstats_record(cbstats_t *s, const uint32_t ns[CBSTATS_PHASES],
+        uint32_t budget_ns, unsigned long status_flags);
+void cbstats_reset(cbstats_t *s);
+
+void cbstats_fprint(FILE *file, cbstats_t *s);
+int cbstats_write_csv(cbstats_t *s, const char *path);
+
+#endif
@@ -0,0 +1,293 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chain.h"
+#include "effect.h"
+#include "kernels.h"
+#include "utils.h"
+
+static int is_planar(const chain_stage_t *st){
+    return st->bypass || (st->effect->planar && !st->os);
+}
+
+/* stages [from, to) are planar: one deinterleave and one interleave per
+ * chunk for the whole run */
+static void process_planar(const effect_chain_t *c, size_t from, size_t to,
+        SAMPLE *samples, unsigned long frameCount, const audio_params_t *p)
+{
+    const int ch = p->channels;
+    if (!c->planar || ch != c->planar_channels)
+        return;
+
+    const dsp_kernels_t *k = dsp_kernels();
+    SAMPLE *planes[MAX_CHANNELS];
+    for (int i = 0; i < ch; i++)
+        planes[i] = c->planar + (size_t)i * CHAIN_PLANAR_FRAMES;
+
+    for (unsigned long off = 0; off < frameCount; off += CHAIN_PLANAR_FRAMES){
+        unsigned long n = frameCount - off;
+        if (n > CHAIN_PLANAR_FRAMES)
+            n = CHAIN_PLANAR_FRAMES;
+        SAMPLE *x = samples + off * ch;
+
+        k->deinterleave(x, planes, n, ch);
+        for (size_t i = from; i < to; i++){
+            const chain_stage_t *st = &c->stages[i];
+            if (!st->bypass)
+                st->effect->planar(planes, n, p, st->state);
+        }
+        k->interleave((const SAMPLE *const *)planes, x, n, ch);
+    }
+}
+
+void chain_process(const effect_chain_t *c, SAMPLE *samples,
+        unsigned long frameCount, const audio_params_t *p)
+{
+    chain_process_tapped(c, samples, frameCount, p, 0, NULL, NULL);
+}
+
+/* like chain_process, fn sees the buffer after every stage in stage_mask.
+ * a planar run is cut at a tapped stage so the tap sees interleaved data */
+void chain_process_tapped(const effect_chain_t *c, SAMPLE *samples,
+        unsigned long frameCount, const audio_params_t *p,
+        uint32_t stage_mask, chain_tap_fn fn, void *user)
+{
+    size_t i = 0;
+    while (i < c->count){
+        const chain_stage_t *st = &c->stages[i];
+        size_t end = i + 1;
+        if (st->bypass){
+            ;
+        } else if (st->os){
+            oversampler_process(st->os, st->effect, st->state, samples, frameCount, p);
+        } else if (!st->effect->planar){
+            st->effect->func(samples, frameCount, p, st->state);
+        } else {
+            while (end < c->count && is_planar(&c->stages[end])
+                    && !(stage_mask & (1u << (end - 1))))
+                end++;
+            process_planar(c, i, end, samples, frameCount, p);
+        }
+        if (stage_mask & (1u << (end - 1)))
+            fn(user, end - 1, samples, frameCount);
+        i = end;
+    }
+}
+
+/* the instance state is allocated here, on the editing thread, never in
+ * the callback. removed stages keep their arena space until a reset or a
+ * chain_rebuild into another arena */
+int chain_add(effect_chain_t *c, const effect_t *e, const audio_params_t *p,
+        arena_t *arena)
+{
+    if (!e || c->count >= CHAIN_MAX_STAGES)
+        return -1;
+
+    if (p->channels < 1 || p->channels > MAX_CHANNELS)
+        return -1;
+    if (e->planar && (!c->planar || c->planar_channels != p->channels)){
+        c->planar = arena_alloc(arena, sizeof(SAMPLE) * CHAIN_PLANAR_FRAMES * p->channels);
+        if (!c->planar)
+            return -1;
+        c->planar_channels = p->channels;
+    }
+
+    void *state = effect_state_create(e, p, arena);
+    if (e->state_size && !state)
+        return -1;
+
+    c->stages[c->count].effect = e;
+    c->stages[c->count].state = state;
+    c->stages[c->count].bypass = 0;
+    c->stages[c->count].os = NULL;
+    c->count++;
+    return 0;
+}
+
+int chain_remove(effect_chain_t *c, size_t pos){
+    if (pos >= c->count)
+        return -1;
+    memmove(&c->stages[pos], &c->stages[pos + 1],
+            sizeof(chain_stage_t) * (c->count - pos - 1));
+    c->count--;
+    return 0;
+}
+
+int chain_move(effect_chain_t *c, size_t from, size_t to){
+    if (from >= c->count || to >= c->count)
+        return -1;
+
+    chain_stage_t st = c->stages[from];
+    if (from < to)
+        memmove(&c->stages[from], &c->stages[from + 1], sizeof(chain_stage_t) * (to - from));
+    else
+        memmove(&c->stages[to + 1], &c->stages[to], sizeof(chain_stage_t) * (from - to));
+    c->stages[to] = st;
+    return 0;
+}
+
+int chain_set_bypass(effect_chain_t *c, size_t pos, int bypass){
+    if (pos >= c->count)
+        return -1;
+    c->stages[pos].bypass = bypass;
+    return 0;
+}
+
+/* run stage pos at factor (1, 2, 4, 8) times the rate. a stateful effect
+ * gets a fresh instance designed for the new rate, with the settings of
+ * the old one carried over; like every edit this happens on the spare
+ * copy, the live chain keeps its own until published. on failure the
+ * stage and the arena are as they were */
+int chain_set_oversample(effect_chain_t *c, size_t pos, int factor,
+        const audio_params_t *p, arena_t *arena)
+{
+    if (pos >= c->count || !oversample_factor_valid(factor))
+        return -1;
+    chain_stage_t *st = &c->stages[pos];
+    int old = st->os ? st->os->factor : 1;
+    if (factor == old)
+        return 0;
+
+    const size_t mark = arena_mark(arena);
+    oversampler_t *os = NULL;
+    if (factor > 1 && !(os = oversampler_create(factor, p->channels, arena))){
+        fprintf(stderr, "oversample: effect state arena is full\n");
+        arena_rewind(arena, mark);
+        return -1;
+    }
+    void *state = st->state;
+    if (st->effect->state_size){
+        audio_params_t hp = *p;
+        hp.sample_rate = p->sample_rate * factor;
+        state = effect_state_create(st->effect, &hp, arena);
+        if (!state || (st->effect->carry && st->effect->carry(state, st->state) < 0)){
+            arena_rewind(arena, mark);
+            return -1;
+        }
+    }
+    st->state = state;
+    st->os = os;
+    return 0;
+}
+
+/* base rate frames the chain delays its input by */
+double chain_latency(const effect_chain_t *c){
+    double frames = 0.0;
+    for (size_t i = 0; i < c->count; i++)
+        if (!c->stages[i].bypass && c->stages[i].os)
+            frames += oversampler_latency(c->stages[i].os);
+    return frames;
+}
+
+void chain_clear(effect_chain_t *c){
+    c->count = 0;
+    c->planar = NULL;   // the arena is reset after a clear
+    c->planar_channels = 0;
+}
+
+/* dst becomes a fresh copy of src for params p, every instance from arena:
+ * same stages, bypass and oversampling, the settings carried over by
+ * effect->carry. src is only read, it can stay live meanwhile */
+int chain_rebuild(effect_chain_t *dst, const effect_chain_t *src,
+        const audio_params_t *p, arena_t *arena)
+{
+    chain_clear(dst);
+    for (size_t i = 0; i < src->count; i++){
+        const chain_stage_t *old = &src->stages[i];
+        const effect_t *e = old->effect;
+        if (chain_add(dst, e, p, arena) < 0
+                || chain_set_oversample(dst, i, old->os ? old->os->factor : 1, p, arena) < 0){
+            fprintf(stderr, "cannot rebuild \"%s\"\n", e->name);
+            return -1;
+        }
+        dst->stages[i].bypass = old->bypass;
+        if (e->carry && e->carry(dst->stages[i].state, old->state) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/* "soft,hard@4,gain": effect names or ids separated by commas, @N runs
+ * that stage N times oversampled */
+int chain_parse(effect_chain_t *c, const char *spec, const audio_params_t *p,
+        arena_t *arena)
+{
+    char *copy = strdup(spec);
+    if (!copy)
+        return -1;
+
+    int rc = 0;
+    char *save = NULL;
+    for (char *tok = strtok_r(copy, ",", &save); tok; tok = strtok_r(NULL, ",", &save)){
+        int factor = 1;
+        char *at = strrchr(tok, '@');
+        if (at){
+            *at = '\0';
+            if (parse_int(at + 1, &factor) < 0 || !oversample_factor_valid(factor)){
+                fprintf(stderr, "\"%s\": oversampling is 1, 2, 4 or 8\n", tok);
+                rc = -1;
+                break;
+            }
+        }
+        const effect_t *e = effect_find(tok);
+        if (!e){
+            fprintf(stderr, "unknown effect \"%s\"\n", tok);
+            rc = -1;
+            break;
+        }
+        if (chain_add(c, e, p, arena) < 0
+                || chain_set_oversample(c, c->count - 1, factor, p, arena) < 0){
+            fprintf(stderr, "cannot add \"%s\" to the chain\n", tok);
+            rc = -1;
+            break;
+        }
+    }
+
+    free(copy);
+    return rc;
+}
+
+/* frames of warm-up that bring a fresh copy of the chain to the exact
+ * state it has at any point of a stream: 0 when every stage is stateless,
+ * -1 when some stage remembers without bound (IIR, convolution) */
+long chain_history(const effect_chain_t *c){
+    long total = 0;
+    for (size_t i = 0; i < c->count; i++){
+        const chain_stage_t *st = &c->stages[i];
+        const effect_t *e = st->effect;
+        if (st->bypass)
+            continue;
+        if (st->os)
+            total += (long)oversampler_history(st->os);
+        if (!e->state_size)
+            continue;
+        if (!e->history)
+            return -1;
+        // the effect's history is counted at its own, higher rate
+        total += st->os ? ((long)e->history + st->os->factor - 1) / st->os->factor
+                        : (long)e->history;
+    }
+    return total;
+}
+
+void chain_fprint(FILE *file, const effect_chain_t *c){
+    if (c->count == 0){
+        fprintf(file, "chain: empty\n");
+        return;
+    }
+
+    fprintf(file, "%-4s %-15s %-7s %s\n", "POS", "EFFECT", "STATE", "RATE");
+    for (size_t i = 0; i < c->count; i++){
+        const chain_stage_t *st = &c->stages[i];
+        fprintf(file, "%-4zu %-15s %-7s ", i, st->effect->name, st->bypass ? "bypass" : "on");
+        if (st->os)
+            fprintf(file, "x%d, %.1f frames latency\n", st->os->factor,
+                    oversampler_latency(st->os));
+        else
+            fprintf(file, "x1\n");
+    }
+    double latency = chain_latency(c);
+    if (latency > 0.0)
+        fprintf(file, "chain latency: %.1f frames\n", latency);
+}
@@ -0,0 +1,61 @@
+#ifndef CHAIN_H
+#define CHAIN_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "audio_types.h"
+#include "effect.h"
+#include "arena.h"
+#include "oversample.h"
+
+#define CHAIN_MAX_STAGES (16)
+#define CHAIN_PLANAR_FRAMES (1024)  // planar stages run in chunks of this
+
+typedef struct chain_stage_t{
+    const effect_t *effect;
+    void *state;    // instance state from the arena, NULL if stateless
+    int bypass;
+    oversampler_t *os;  // NULL: base rate, else runs at os->factor times
+} chain_stage_t;
+
+/* ordered, fixed-size list of effects run in place on one buffer.
+ * plain data: the audio thread only ever reads a published copy */
+typedef struct effect_chain_t{
+    chain_stage_t stages[CHAIN_MAX_STAGES];
+    size_t count;
+    // per-channel buffers for planar stages, CHAIN_PLANAR_FRAMES each,
+    // from the arena on the first planar chain_add
+    SAMPLE *planar;
+    int planar_channels;
+} effect_chain_t;
+
+// called after a stage with the interleaved buffer, see chain_process_tapped
+typedef void (*chain_tap_fn)(void *user, size_t stage, const SAMPLE *samples,
+        unsigned long frameCount);
+
+void chain_process(const effect_chain_t *c, SAMPLE *samples,
+        unsigned long frameCount, const audio_params_t *p);
+void chain_process_tapped(const effect_chain_t *c, SAMPLE *samples,
+        unsigned long frameCount, const audio_params_t *p,
+        uint32_t stage_mask, chain_tap_fn fn, void *user);
+
+int chain_add(effect_chain_t *c, const effect_t *e, const audio_params_t *p,
+        arena_t *arena);
+int chain_remove(effect_chain_t *c, size_t pos);
+int chain_move(effect_chain_t *c, size_t from, size_t to);
+int chain_set_bypass(effect_chain_t *c, size_t pos, int bypass);
+int chain_set_oversample(effect_chain_t *c, size_t pos, int factor,
+        const audio_params_t *p, arena_t *arena);
+double chain_latency(const effect_chain_t *c);
+void chain_clear(effect_chain_t *c);
+int chain_rebuild(effect_chain_t *dst, const effect_chain_t *src,
+        const audio_params_t *p, arena_t *arena);
+
+int chain_parse(effect_chain_t *c, const char *spec, const audio_params_t *p,
+        arena_t *arena);
+long chain_history(const effect_chain_t *c);
+void chain_fprint(FILE *file, const effect_chain_t *c);
+
+#endif
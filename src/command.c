@@ -9,13 +9,40 @@
 #include "effect.h"
 #include "audio_io.h"
 #include "audio_types.h"
+#include "offline.h"
+#include "kernels.h"
+#include "convolver.h"
+#include "biquad.h"
+#include "resample.h"
 #include "portaudio.h"
 
+const char *opt_record_path;
+recorder_opts_t opt_record = { .dither = 1 };  // --format, --no-dither, --rec-direct
+int spectrum_view = SPECTRUM_VIEW_BARS;
+int meter_view;
+
 const struct option long_options[] = {
     { "help",     no_argument,       NULL, 'h'},
     { "gain",     required_argument, NULL, 'g'},
     { "rate",     required_argument, NULL, 'r'},
     { "channels", required_argument, NULL, 'c'},
+    { "rec-buffer", required_argument, NULL, 'b'},
+    { "in",       required_argument, NULL, 'i'},
+    { "out",      required_argument, NULL, 'o'},
+    { "effect",   required_argument, NULL, 'e'},
+    { "simd",     required_argument, NULL, 's'},
+    { "backend",  required_argument, NULL, 'B'},
+    { "clock",    required_argument, NULL, 'C'},
+    { "record",   required_argument, NULL, 'w'},
+    { "block",    required_argument, NULL, 'k'},
+    { "ir",       required_argument, NULL, 'I'},
+    { "jobs",     required_argument, NULL, 'j'},
+    { "format",   required_argument, NULL, 'f'},
+    { "no-dither", no_argument,      NULL, 'D'},
+    { "rec-direct", no_argument,     NULL, 'R'},
+    { "peaks",    no_argument,       NULL, 'P'},
+    { "rec-rate", required_argument, NULL, 'W'},
+    { "src-quality", required_argument, NULL, 'Q'},
     { 0, 0, 0, 0 }
 };
 
@@ -23,14 +50,44 @@ void print_help(){
     printf("\n");
     printf("WAVECLI — minimal real-time audio DSP monitor / capture tool\n");
     printf("\n"
-           "Usage: %s [--gain X] [--rate N] [--channels 1|2] [--help]\n"
+           "Usage: %s [--gain X] [--rate N] [--block N|auto] [--channels N] [--rec-buffer SEC] [--help]\n"
            "\n"
            "  --gain     X        gain multiplier (def: 1.0)\n"
-           "  --rate     N        sample rate (def: 48000)\n"
-           "  --channels 1|2      mono/stereo (def: 2)\n"
+           "  --rate     N        sample rate (def: %d)\n"
+           "  --block    N|auto   frames per callback, auto probes the device (def: %d)\n"
+           "  --channels N        1..%d, interleaved on the device (def: 1)\n"
+           "  --rec-buffer SEC    recording ring buffer length (def: %d)\n"
+           "  --simd     NAME     force kernel set: scalar|sse2|avx2|neon (def: best)\n"
+           "  --backend  SPEC     portaudio | null[:sine|noise|silence] | file:PATH\n"
+           "  --clock    MODE     null/file backends: realtime | fast (def: realtime)\n"
+           "  --record   PATH     start recording as soon as the stream starts\n"
+           "  --ir       PATH     impulse response for the convolve effect\n"
+           "  --format   FMT      recorded/offline file format: float32|pcm16|pcm24|pcm32\n"
+           "  --no-dither         no TPDF dither when writing pcm16/pcm24\n"
+           "  --rec-direct        record with O_DIRECT, bypassing the page cache\n"
+           "  --peaks             write a FILE.peaks waveform overview with every output\n"
+           "  --rec-rate N        record at N Hz, resampled from the stream rate\n"
+           "  --src-quality Q     sample rate conversion: fast|medium|best (def: best)\n"
            "  --help              this help\n"
+           "\n"
+           "Offline: %s --in in.wav --out out.wav [--effect NAME[@N][,NAME...]] [--rate N]\n"
+           "  runs the effect over a file as fast as possible, no audio device.\n"
+           "  with --rate the file is resampled to N Hz before the effects\n"
+           "\n"
+           "Batch: %s batch --out DIR [--effect CHAIN] [--jobs N] DIR|FILE|'GLOB'...\n"
+           "  every .wav through the chain into DIR, N files at a time (def: one per core)\n"
+           "\n"
+           "Repair: %s repair FILE.wav...\n"
+           "  fixes the sizes of recordings cut short by a crash\n"
+           "\n"
+           "Peaks: %s peaks FILE.wav...\n"
+           "  writes FILE.wav.peaks, the min/max/rms overview visualize.py zooms with\n"
+           "\n"
+           "Tapcat: %s tapcat [in|out|STAGE] > FILE.raw\n"
+           "  raw float32 of one tap point of a running wavecli (\"tap\" command)\n"
            "\n",
-           progname);
+           progname, DEFAULT_SAMPLE_RATE, DEFAULT_FRAMES_PER_BUFFER, MAX_CHANNELS,
+           RECORDER_DEFAULT_BUFFER_SEC, progname, progname, progname, progname, progname);
 
 
     printf("Notes:\n");
@@ -46,6 +103,10 @@ void parse_opts(int argc, char *argv[]){
         float volume_val;
         float gain_val; 
         int channels_val; 
+        int rec_buffer_val;
+        int rate_val;
+        int block_val;
+        int jobs_val;
 
         switch (ch){
             // short option 't'
@@ -68,14 +129,105 @@ void parse_opts(int argc, char *argv[]){
                 audio_cb_ctx->audio_params.volume = volume_val;
                 break;
             case 'c':
-                if (parse_int(optarg, &channels_val)){
+                if (parse_int(optarg, &channels_val) || channels_val < 1
+                        || channels_val > MAX_CHANNELS){
                     fprintf(stderr, "wrong val, used default\n");
                     break;
                 }
                 audio_cb_ctx->audio_params.channels = channels_val;
                 break;
+            case 'r':
+                if (parse_int(optarg, &rate_val) || rate_val <= 0){
+                    fprintf(stderr, "wrong val, used default\n");
+                    break;
+                }
+                audio_cb_ctx->audio_params.sample_rate = rate_val;
+                offline_opts.rate = rate_val;
+                break;
+            case 'k':
+                if (strcmp(optarg, "auto") == 0){
+                    audio_cb_ctx->audio_params.frames_per_buffer = FRAMES_PER_BUFFER_AUTO;
+                    break;
+                }
+                if (parse_int(optarg, &block_val) || block_val <= 0){
+                    fprintf(stderr, "wrong val, used default\n");
+                    break;
+                }
+                audio_cb_ctx->audio_params.frames_per_buffer = block_val;
+                break;
+            case 'b':
+                if (parse_int(optarg, &rec_buffer_val) || rec_buffer_val <= 0){
+                    fprintf(stderr, "wrong val, used default\n");
+                    break;
+                }
+                audio_cb_ctx->rec_buffer_sec = rec_buffer_val;
+                break;
+            case 'i':
+                offline_opts.in_path = optarg;
+                break;
+            case 'o':
+                offline_opts.out_path = optarg;
+                break;
+            case 'e':
+                offline_opts.chain_spec = optarg;
+                break;
+            case 's':
+                if (dsp_kernels_select(optarg) < 0)
+                    fprintf(stderr, "kernel set \"%s\" not available, used %s\n",
+                            optarg, dsp_kernels()->name);
+                break;
+            case 'B':
+                if (audio_io_set_backend(optarg) < 0)
+                    die("error: unknown backend \"%s\"", optarg);
+                break;
+            case 'C':
+                if (strcmp(optarg, "fast") == 0)
+                    audio_io_set_realtime(0);
+                else if (strcmp(optarg, "realtime") == 0)
+                    audio_io_set_realtime(1);
+                else
+                    fprintf(stderr, "wrong val, used default\n");
+                break;
             case 'w':
-                audio_cb_ctx->flags |= FLAG_RECORD;
+                opt_record_path = optarg;
+                break;
+            case 'I':
+                if (convolver_ir_load(optarg) < 0)
+                    die("cannot load impulse response %s", optarg);
+                break;
+            case 'f':
+                if (!(opt_record.format = pcm_format_find(optarg)))
+                    die("unknown format %s (float32, pcm16, pcm24, pcm32)", optarg);
+                offline_opts.format = opt_record.format;
+                break;
+            case 'D':
+                opt_record.dither = 0;
+                offline_opts.dither = 0;
+                break;
+            case 'P':
+                opt_record.peaks = 1;
+                offline_opts.peaks = 1;
+                break;
+            case 'R':
+                opt_record.direct = 1;
+                break;
+            case 'W':
+                if (parse_int(optarg, &rate_val) || rate_val <= 0){
+                    fprintf(stderr, "wrong val, used default\n");
+                    break;
+                }
+                opt_record.rate = rate_val;
+                break;
+            case 'Q':
+                if ((resample_quality = resample_quality_find(optarg)) < 0)
+                    die("unknown quality %s (fast, medium, best)", optarg);
+                break;
+            case 'j':
+                if (parse_int(optarg, &jobs_val) || jobs_val < 1){
+                    fprintf(stderr, "wrong val, used default\n");
+                    break;
+                }
+                offline_opts.jobs = jobs_val;
                 break;
             default:
                 die("error: unknown option");
@@ -83,17 +235,27 @@ void parse_opts(int argc, char *argv[]){
     }
 }
 
+/* gain             show the gain
+ * gain G [MS] [exp] ramp to G over MS milliseconds (def 20), linearly or
+ *                   at a constant dB rate. never touches the callback's copy */
 int set_gain_cmd(int argc, const char** argv){
+    params_t *ps = &audio_cb_ctx->params;
     if (argv == NULL || argc < 1){
-        DEBUG_PRINTF("handle set gain command. no args\n");
+        printf("gain: %.3f\n", params_get(ps, PARAM_GAIN));
+        return 0;
+    }
+    float gain, ms = (float)(PARAM_DEFAULT_RAMP_SEC * 1e3);
+    param_shape_t shape = PARAM_LINEAR;
+    if (parse_float(argv[0], &gain) < 0 || (argc > 1 && parse_float(argv[1], &ms) < 0)
+            || (argc > 2 && strcmp(argv[2], "exp") != 0 && strcmp(argv[2], "lin") != 0)
+            || argc > 3 || ms < 0.0f){
+        fprintf(stderr, "usage: gain VALUE [RAMP_MS] [lin|exp]\n");
         return -1;
     }
-    float gain;
-    parse_float(argv[0], &gain);
+    if (argc > 2 && strcmp(argv[2], "exp") == 0)
+        shape = PARAM_EXP;
     DEBUG_PRINTF("handle set gain command. args: %0.2f\n", gain);
-    audio_params_t *p = &audio_cb_ctx->audio_params;
-    p->gain = gain;
-    return 0;
+    return params_set(ps, PARAM_GAIN, gain, ms * 1e-3f, shape);
 }
 
 int set_volume_cmd(int argc, const char** args){
@@ -119,9 +281,15 @@ static int print_effects(void) {
     return 0;
 }
 
-int set_effect_cmd(int argc, const char** argv){
-    (void)argv;
+static int parse_pos(const char *s, size_t *pos){
+    int v;
+    if (!s || parse_int(s, &v) < 0 || v < 0)
+        return -1;
+    *pos = (size_t)v;
+    return 0;
+}
 
+static const effect_t *pick_effect_interactive(void){
     print_effects();
     const int maxsize = 50;
     char line[maxsize];
@@ -129,29 +297,148 @@ int set_effect_cmd(int argc, const char** argv){
 
     int effect_index;
     if (parse_int(line, &effect_index) < 0)
-        return -1;
+        return NULL;
     
-    if (effect_index >= effects_count)
+    if (effect_index < 0 || (size_t)effect_index >= effects_count)
+        return NULL;
+
+    return &effects[effect_index];
+}
+
+/* one edit of the spare copy c, states from arena. pick: the effect the
+ * prompt chose for a bare "effect". -2: bad usage */
+static int effect_edit(effect_chain_t *c, int argc, const char **argv,
+        const effect_t *pick, arena_t *arena)
+{
+    const audio_params_t *p = &audio_cb_ctx->audio_params;
+    const char *sub = argc >= 1 ? argv[0] : NULL;
+    size_t a, b;
+
+    if (!sub)
+        return pick ? chain_add(c, pick, p, arena) : -1;
+    if (strcmp(sub, "add") == 0 && argc >= 2)
+        // NAME[@FACTOR], same syntax as --effect
+        return chain_parse(c, argv[1], p, arena);
+    if (strcmp(sub, "rm") == 0 && parse_pos(argc >= 2 ? argv[1] : NULL, &a) == 0)
+        return chain_remove(c, a);
+    if (strcmp(sub, "mv") == 0 && parse_pos(argc >= 2 ? argv[1] : NULL, &a) == 0
+            && parse_pos(argc >= 3 ? argv[2] : NULL, &b) == 0)
+        return chain_move(c, a, b);
+    if (strcmp(sub, "bypass") == 0 && parse_pos(argc >= 2 ? argv[1] : NULL, &a) == 0){
+        int on = a < c->count ? !c->stages[a].bypass : 1;
+        if (argc >= 3)
+            on = strcmp(argv[2], "off") != 0;
+        return chain_set_bypass(c, a, on);
+    }
+    if (strcmp(sub, "os") == 0 && parse_pos(argc >= 2 ? argv[1] : NULL, &a) == 0
+            && argc >= 3){
+        int factor;
+        if (parse_int(argv[2], &factor) < 0 || !oversample_factor_valid(factor)){
+            fprintf(stderr, "effect os: factor 1, 2, 4 or 8\n");
+            return -2;
+        }
+        return chain_set_oversample(c, a, factor, p, arena);
+    }
+    if (strcmp(sub, "clear") == 0){
+        chain_clear(c);
+        return 0;
+    }
+    fprintf(stderr, "usage: effect [add NAME[@N]|rm POS|mv FROM TO|bypass POS [on|off]|os POS N|clear|list]\n");
+    return -2;
+}
+
+static void fprint_state_arena(FILE *file){
+    const arena_t *a = audio_io_state_arena();
+    fprintf(file, "effect state: %.1f of %.1f MiB used\n", a->used / 1048576.0,
+            a->size / 1048576.0);
+}
+
+/* effect                      list effects, prompt for one to append
+ * effect add NAME|ID[@N]     append a stage, @N oversampled
+ * effect rm POS               remove a stage
+ * effect mv FROM TO           reorder
+ * effect bypass POS [on|off]  toggle or set bypass
+ * effect os POS N             run stage POS N times oversampled (1, 2, 4, 8)
+ * effect clear | list */
+int set_effect_cmd(int argc, const char** argv){
+    const char *sub = argc >= 1 ? argv[0] : NULL;
+    const effect_t *pick = NULL;
+
+    if (sub && strcmp(sub, "list") == 0){
+        chain_fprint(stdout, atomic_load(&audio_cb_ctx->chain));
+        fprint_state_arena(stdout);
+        return 0;
+    }
+    if (!sub && !(pick = pick_effect_interactive()))
+        return -1;
+
+    effect_chain_t *c = audio_io_chain_begin();
+    audio_io_state_arena()->full = 0;
+    int rc = effect_edit(c, argc, argv, pick, audio_io_state_arena());
+    // out of arena: win back the space of removed stages and try once more
+    if (rc == -1 && audio_io_state_arena()->full){
+        if (audio_io_chain_compact() == 0){
+            fprintf(stderr, "effect: reclaimed the space of removed stages\n");
+            c = audio_io_chain_begin();
+            rc = effect_edit(c, argc, argv, pick, audio_io_state_arena());
+        }
+        if (rc == -1 && audio_io_state_arena()->full){
+            fprintf(stderr, "effect %s: no room left even after compacting, remove "
+                    "stages or run effect clear\n", sub ? sub : "add");
+            fprint_state_arena(stderr);
+        }
+    }
+    if (rc == -2)
         return -1;
+    if (rc < 0){
+        fprintf(stderr, "effect %s: failed\n", sub ? sub : "");
+        return -1;
+    }
 
-    audio_cb_ctx->dsp_process = effects[effect_index].func;
+    audio_io_chain_commit();
+    // nothing live points into the arena after an empty chain is published
+    if (c->count == 0){
+        chain_clear(c);
+        arena_reset(audio_io_state_arena());
+    }
+    chain_fprint(stdout, c);
     return 0;
 }
 
 int start_recording_cmd(int argc, const char** argv){
     DEBUG_PRINTF("handle start record command\n");
-    set_record_flag();
 
     printf("argc: %d\n", argc);
     for (int i = 0; i<argc; i++)    
         printf("arg %d: %s\n", i, argv[i]);
 
+    // record [FILE] [RATE] [float32|pcm16|pcm24|pcm32] [dither|nodither] [direct] [peaks]
     const char *filepath = NULL;
-    if (argc >= 1)
-        filepath = argv[0];
+    recorder_opts_t o = opt_record;
+    for (int i = 0; i < argc; i++){
+        const pcm_format_t *f = pcm_format_find(argv[i]);
+        int rate;
+        if (f)
+            o.format = f;
+        else if (strcmp(argv[i], "nodither") == 0)
+            o.dither = 0;
+        else if (strcmp(argv[i], "dither") == 0)
+            o.dither = 1;
+        else if (strcmp(argv[i], "direct") == 0)
+            o.direct = 1;
+        else if (strcmp(argv[i], "peaks") == 0)
+            o.peaks = 1;
+        else if (parse_int(argv[i], &rate) == 0 && rate > 0)
+            o.rate = rate;
+        else
+            filepath = argv[i];
+    }
 
     printf("filepath: %s\n", filepath);
-    audio_io_open_record_file(filepath);
+    if (audio_io_open_record_file(filepath, &o) < 0)
+        return -1;
+
+    set_record_flag();
     return 0;
 }
 
@@ -172,24 +459,42 @@ int help_cmd(int argc, const char **argv) {
 
     printf("%-7s %-5s %s\n", "Command", "Alias", "Description");
     printf("─────── ───── ────────────────────────────────────────────────\n");
-    printf("gain    g     Set gain multiplier           <value>\n");
-    printf("effect  e     Select & apply audio effect      \n");
+    printf("gain    g     Set gain multiplier           <value> [ramp ms] [lin|exp]\n");
+    printf("effect  e     Edit the effect chain         [add|rm|mv|bypass|os|clear|list]\n");
     printf("record  r     Start recording to file       optional[filename]\n");
     printf("input   di    Select input device               \n");
     printf("output  do    Select output device              \n");
+    printf("stats   st    Callback timing and xruns     [reset|csv FILE]\n");
+    printf("rate    sr    Show/set sample rate          optional[hz]\n");
+    printf("block   bs    Show/set frames per callback  optional[n|auto]\n");
+    printf("spectrum sp   Live FFT spectrum view        [bars|gram] [points]\n");
+    printf("ir      ir    Load IR for convolve / costs  optional[path]\n");
+    printf("eq      eq    Set eq bands of a chain stage [stage band type freq q dB|off]\n");
+    printf("meter   m     Levels, true peak, LUFS       optional[reset]\n");
+    printf("tap     tp    Export blocks to shared memory [off|in|out|all|stage...]\n");
     printf("help    h     Show this help\n");
     printf("\n");
 
     printf("Examples:\n");
-    printf("  gain 1.5          or   g 1.5       → ≈ +3.5 dB gain\n");
+    printf("  gain 1.5          or   g 1.5       → ≈ +3.5 dB gain, 20 ms ramp\n");
+    printf("  gain 0.1 2000 exp                  → 2 s fade at a constant dB rate\n");
     printf("  record            or   r           → record to default filename\n");
     printf("  record test.wav                    → record to \"test.wav\"\n");
+    printf("  record test.wav pcm24              → 24-bit PCM, TPDF dithered\n");
+    printf("  record test.wav 44100              → resampled to 44.1 kHz while writing\n");
     printf("  effect            or   e           → show list and prompt for number\n");
+    printf("  effect add soft                    → append soft clip to the chain\n");
+    printf("  effect mv 1 0                      → move stage 1 to the front\n");
+    printf("  effect bypass 0                    → toggle bypass of stage 0\n");
+    printf("  effect os 0 4                      → stage 0 at 4x the rate, less aliasing\n");
+    printf("  spectrum gram 8192                 → scrolling spectrogram, 8192 points\n");
+    printf("  eq 0 1 peak 2500 1.4 -6            → stage 0, band 1: -6 dB bell at 2.5 kHz\n");
+    printf("  tap in 1 out                       → export input, stage 1 and output\n");
     printf("  input             or   di          → interactive device selection\n\n");
 
     printf("Note:\n");
     printf("  • Commands without arguments usually enter interactive mode\n");
-    printf("  • Short aliases (g, e, r, di, do, h) work everywhere\n\n");
+    printf("  • Short aliases (g, e, r, di, do, st, sr, bs, sp, m, tp, h) work everywhere\n\n");
 
     return 0;
 }
@@ -256,13 +561,207 @@ int select_output_device_cmd(int argc, const char** argv){
 }
 
 
+int set_rate_cmd(int argc, const char** argv){
+    int rate;
+    if (argc < 1 || parse_int(argv[0], &rate) < 0 || rate <= 0){
+        printf("sample rate: %d Hz\n", audio_cb_ctx->audio_params.sample_rate);
+        return argc < 1 ? 0 : -1;
+    }
+    return audio_io_reconfigure(rate, 0, 0);
+}
+
+int set_block_cmd(int argc, const char** argv){
+    int block;
+    if (argc < 1){
+        printf("block size: %lu frames\n", audio_cb_ctx->audio_params.frames_per_buffer);
+        return 0;
+    }
+    if (strcmp(argv[0], "auto") == 0)
+        return audio_io_reconfigure(0, 0, 1);
+    if (parse_int(argv[0], &block) < 0 || block <= 0)
+        return -1;
+    return audio_io_reconfigure(0, (unsigned long)block, 0);
+}
+
+/* stats             percentiles, margin, xruns, histogram
+ * stats csv FILE    dump the recent per-callback timings
+ * stats reset */
+int stats_cmd(int argc, const char** argv){
+    cbstats_t *st = &audio_cb_ctx->stats;
+    if (argc == 0){
+        cbstats_fprint(stdout, st);
+        return 0;
+    }
+    if (strcmp(argv[0], "reset") == 0){
+        cbstats_reset(st);
+        return 0;
+    }
+    if (strcmp(argv[0], "csv") == 0 && argc >= 2)
+        return cbstats_write_csv(st, argv[1]);
+
+    fprintf(stderr, "usage: stats [reset|csv FILE]\n");
+    return -1;
+}
+
+/* ir PATH   load the impulse response used by new convolve instances
+ * ir        show it and the per-block cost of the live convolve stages */
+int ir_cmd(int argc, const char** argv){
+    if (argc >= 1){
+        if (convolver_ir_load(argv[0]) < 0)
+            return -1;
+        const convolver_ir_t *r = convolver_ir();
+        printf("impulse response: %zu frames, %d ch, %d Hz, add it with: effect add convolve\n",
+               r->frames, r->channels, r->sample_rate);
+        return 0;
+    }
+
+    const convolver_ir_t *r = convolver_ir();
+    if (!r)
+        printf("no impulse response loaded\n");
+    else
+        printf("impulse response: %zu frames, %d ch, %d Hz\n",
+               r->frames, r->channels, r->sample_rate);
+
+    const effect_chain_t *c = atomic_load(&audio_cb_ctx->chain);
+    for (size_t i = 0; i < c->count; i++){
+        if (c->stages[i].effect->func == convolver_process){
+            printf("[%zu] ", i);
+            convolver_fprint(stdout, c->stages[i].state);
+        }
+    }
+    return 0;
+}
+
+/* eq                                    list the eq stages of the live chain
+ * eq STAGE BAND TYPE FREQ [Q] [GAIN_DB]  set a band, TYPE lowpass|highpass|
+ *                                        bandpass|notch|peak|lowshelf|highshelf
+ * eq STAGE BAND off */
+int eq_cmd(int argc, const char** argv){
+    const effect_chain_t *c = atomic_load(&audio_cb_ctx->chain);
+    if (argc == 0){
+        for (size_t i = 0; i < c->count; i++){
+            if (c->stages[i].effect->func != eq_process)
+                continue;
+            printf("[%zu] eq\n", i);
+            eq_fprint(stdout, c->stages[i].state);
+        }
+        return 0;
+    }
+
+    int stage, band;
+    if (parse_int(argv[0], &stage) < 0 || stage < 0 || (size_t)stage >= c->count
+            || c->stages[stage].effect->func != eq_process){
+        fprintf(stderr, "eq: stage %s is not an eq, add one with: effect add eq\n", argv[0]);
+        return -1;
+    }
+    eq_state_t *st = c->stages[stage].state;
+    if (argc == 1){
+        eq_fprint(stdout, st);
+        return 0;
+    }
+
+    if (parse_int(argv[1], &band) < 0)
+        return -1;
+    if (argc == 3 && strcmp(argv[2], "off") == 0)
+        return eq_band_off(st, band);
+
+    biquad_type_t type;
+    float freq, q = 0.707f, gain_db = 0.0f;
+    if (argc < 4 || biquad_type_parse(argv[2], &type) < 0 || parse_float(argv[3], &freq) < 0
+            || (argc > 4 && parse_float(argv[4], &q) < 0)
+            || (argc > 5 && parse_float(argv[5], &gain_db) < 0)){
+        fprintf(stderr, "usage: eq STAGE BAND lowpass|highpass|bandpass|notch|peak|"
+                "lowshelf|highshelf FREQ [Q] [GAIN_DB]\n");
+        return -1;
+    }
+    return eq_set_band(st, band, type, freq, q, gain_db);
+}
+
+/* meter         live levels and loudness until cntrl + c
+ * meter reset   restart integrated loudness and true peak */
+int meter_cmd(int argc, const char** argv){
+    if (argc >= 1 && strcmp(argv[0], "reset") == 0){
+        audio_io_meter_reset();
+        return 0;
+    }
+    if (argc >= 1){
+        fprintf(stderr, "usage: meter [reset]\n");
+        return -1;
+    }
+    meter_view = 1;
+    return 0;
+}
+
+/* spectrum [bars|gram] [N]   live FFT view until cntrl + c, N points */
+int spectrum_cmd(int argc, const char** argv){
+    int size = SPECTRUM_DEFAULT_SIZE;
+    spectrum_view = SPECTRUM_VIEW_BARS;
+
+    for (int i = 0; i < argc; i++){
+        if (strcmp(argv[i], "bars") == 0)
+            spectrum_view = SPECTRUM_VIEW_BARS;
+        else if (strcmp(argv[i], "gram") == 0)
+            spectrum_view = SPECTRUM_VIEW_GRAM;
+        else if (parse_int(argv[i], &size) < 0 || size < 64 || (size & (size - 1)) != 0){
+            fprintf(stderr, "usage: spectrum [bars|gram] [power of two >= 64]\n");
+            return -1;
+        }
+    }
+    return audio_io_spectrum_open((size_t)size);
+}
+
+/* tap                 show the shared memory export
+ * tap off             stop writing blocks, the ring stays for readers
+ * tap in 0 2 out|all  points to export: input, after stage N, output */
+int tap_cmd(int argc, const char** argv){
+    if (argc == 0){
+        tap_t *t = audio_io_tap();
+        uint32_t mask = t ? atomic_load(&t->mask) : 0;
+        if (!mask){
+            printf("tap: off\n");
+            return 0;
+        }
+        char name[16];
+        printf("tap: %s, %llu blocks, %llu KiB ring, points:", t->name,
+               (unsigned long long)t->seq, (unsigned long long)t->shm->size >> 10);
+        for (int p = 0; p < 32; p++)
+            if (mask & TAP_POINT_BIT(p))
+                printf(" %s", tap_point_name(p, name, sizeof name));
+        printf("\n");
+        return 0;
+    }
+    if (argc == 1 && strcmp(argv[0], "off") == 0)
+        return audio_io_tap_set(0);
+
+    uint32_t mask = 0;
+    for (int i = 0; i < argc; i++){
+        if (tap_point_parse(argv[i], &mask) < 0){
+            fprintf(stderr, "usage: tap [off | in|out|all|STAGE...]\n");
+            return -1;
+        }
+    }
+    if (audio_io_tap_set(mask) < 0)
+        return -1;
+    printf("tap: writing to shared memory %s, read it with: %s tapcat\n",
+           TAP_SHM_NAME, progname);
+    return 0;
+}
+
 static const command_t commands[] = {
     { "gain",    "g",   set_gain_cmd       },
     { "effect",  "e",   set_effect_cmd         },
     { "record",  "r",   start_recording_cmd    },
     { "help",    "h",   help_cmd          },     
     { "input",   "di",  select_input_device_cmd  },
-    { "output",  "do",  select_output_device_cmd }
+    { "output",  "do",  select_output_device_cmd },
+    { "stats",   "st",  stats_cmd },
+    { "rate",    "sr",  set_rate_cmd },
+    { "block",   "bs",  set_block_cmd },
+    { "spectrum", "sp", spectrum_cmd },
+    { "ir",      "ir",  ir_cmd },
+    { "eq",      "eq",  eq_cmd },
+    { "meter",   "m",   meter_cmd },
+    { "tap",     "tp",  tap_cmd }
 };
 
 static const size_t commands_count = sizeof(commands) / sizeof((commands[0]));
@@ -273,8 +772,9 @@ static const size_t commands_count = sizeof(commands) / sizeof((commands[0]));
 int handle_command(const char *cmd, int argc, const char **argv){
     for (int i = 0; i < commands_count; i++){
         if (strcmp(cmd, commands[i].longname) == 0 || strcmp(cmd, commands[i].shortname) == 0){
-            commands[i].func(argc, argv);
+            return commands[i].func(argc, argv);
         }
     }
+    return -1;
 }
 
@@ -3,6 +3,7 @@
 
 #include <getopt.h>    // for option
 #include "audio_io.h"  // for device_index
+#include "pcm.h"
 
 typedef int (*command_fn)(int argc, const char** args);
 
@@ -13,7 +14,16 @@ typedef struct command_t{
     char *help;
 } command_t;
 
+enum spectrum_view {
+    SPECTRUM_VIEW_BARS,
+    SPECTRUM_VIEW_GRAM,
+};
+
 extern const struct option long_options[];
+extern const char *opt_record_path;
+extern recorder_opts_t opt_record;
+extern int spectrum_view;
+extern int meter_view;
 
 void parse_opts(int argc, char *argv[]);
 int handle_command(const char *cmd, int argc, const char **argv);
@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "convolver.h"
+#include "cbstats.h"
+#include "wav.h"
+#include "fft.h"
+
+static convolver_ir_t ir;
+static unsigned long ir_id;     // bumped by every load
+
+int convolver_ir_load(const char *path){
+    wav_reader *r = wav_reader_open(path);
+    if (!r)
+        return -1;
+
+    size_t frames = r->num_frames;
+    size_t max_frames = (size_t)CONVOLVER_MAX_IR_SEC * r->sample_rate;
+    if (frames > max_frames){
+        fprintf(stderr, "%s: impulse response cut to %d s\n", path, CONVOLVER_MAX_IR_SEC);
+        frames = max_frames;
+    }
+    if (frames == 0){
+        fprintf(stderr, "%s: empty impulse response\n", path);
+        wav_reader_close(r);
+        return -1;
+    }
+
+    SAMPLE *samples = malloc(sizeof(SAMPLE) * frames * (size_t)r->num_channels);
+    if (!samples){
+        perror("convolver_ir_load");
+        wav_reader_close(r);
+        return -1;
+    }
+    frames = wav_reader_read(r, samples, frames);
+
+    convolver_ir_free();
+    ir_id++;
+    ir.samples = samples;
+    ir.frames = frames;
+    ir.channels = r->num_channels;
+    ir.sample_rate = r->sample_rate;
+    wav_reader_close(r);
+    return 0;
+}
+
+const convolver_ir_t *convolver_ir(void){
+    return ir.samples ? &ir : NULL;
+}
+
+void convolver_ir_free(void){
+    free(ir.samples);
+    memset(&ir, 0, sizeof ir);
+}
+
+static size_t round64(size_t bytes){
+    return (bytes + 63) & ~(size_t)63;
+}
+
+static size_t partition_size(const audio_params_t *p){
+    size_t b = CONVOLVER_MIN_BLOCK;
+    while (b < p->frames_per_buffer && b < CONVOLVER_MAX_BLOCK)
+        b <<= 1;
+    return b;
+}
+
+/* fills the geometry of st, returns the bytes the whole instance needs */
+static size_t layout(convolver_state_t *st, const audio_params_t *p){
+    const size_t b = partition_size(p);
+    st->channels = p->channels;
+    st->ir_channels = ir.channels < p->channels ? ir.channels : p->channels;
+    st->sample_rate = p->sample_rate;
+    st->ir_id = ir_id;
+    st->ir_frames = ir.frames;
+    st->block = b;
+    st->parts = (ir.frames + b - 1) / b;
+    st->bins = b + 1;
+
+    const size_t spectrum = round64(sizeof(float) * st->parts * st->bins);
+    return round64(sizeof(convolver_state_t))
+        + fft_mem_size(2 * b)
+        + round64(sizeof(float) * 2 * b) * (size_t)st->channels
+        + round64(sizeof(float) * b) * (size_t)st->channels
+        + 2 * spectrum * (size_t)st->channels
+        + 2 * spectrum * (size_t)st->ir_channels
+        + 2 * round64(sizeof(float) * st->bins)
+        + round64(sizeof(float) * 2 * b);
+}
+
+size_t convolver_state_size(const audio_params_t *p){
+    convolver_state_t st;
+    if (!ir.samples)
+        return sizeof(convolver_state_t);
+    return layout(&st, p);
+}
+
+static float *carve(unsigned char **p, size_t count){
+    float *r = (float *)*p;
+    *p += round64(sizeof(float) * count);
+    return r;
+}
+
+int convolver_init(void *state, const audio_params_t *p){
+    convolver_state_t *st = state;
+    if (!ir.samples){
+        fprintf(stderr, "convolve: no impulse response loaded, use: ir PATH\n");
+        return -1;
+    }
+    if (ir.sample_rate != p->sample_rate)
+        fprintf(stderr, "convolve: impulse response is %d Hz, stream is %d Hz\n",
+                ir.sample_rate, p->sample_rate);
+
+    layout(st, p);
+    const size_t b = st->block, bins = st->bins, parts = st->parts;
+
+    unsigned char *mem = (unsigned char *)state + round64(sizeof(convolver_state_t));
+    fft_init_mem(&st->fft, 2 * b, mem);
+    mem += fft_mem_size(2 * b);
+
+    st->in = carve(&mem, 2 * b * (size_t)st->channels);
+    st->out = carve(&mem, b * (size_t)st->channels);
+    st->fdl_re = carve(&mem, parts * bins * (size_t)st->channels);
+    st->fdl_im = carve(&mem, parts * bins * (size_t)st->channels);
+    st->ir_re = carve(&mem, parts * bins * (size_t)st->ir_channels);
+    st->ir_im = carve(&mem, parts * bins * (size_t)st->ir_channels);
+    st->acc_re = carve(&mem, bins);
+    st->acc_im = carve(&mem, bins);
+    st->time = carve(&mem, 2 * b);
+
+    // H[k] = FFT of IR frames [k b, (k + 1) b) padded with b zeros
+    for (int c = 0; c < st->ir_channels; c++){
+        for (size_t k = 0; k < parts; k++){
+            memset(st->time, 0, sizeof(float) * 2 * b);
+            for (size_t i = 0; i < b && k * b + i < ir.frames; i++)
+                st->time[i] = ir.samples[(k * b + i) * ir.channels + c];
+            size_t off = ((size_t)c * parts + k) * bins;
+            fft_forward(&st->fft, st->time, st->ir_re + off, st->ir_im + off);
+        }
+    }
+    return 0;
+}
+
+/* the IR is not kept per instance, a rebuild transforms the loaded one
+ * again: only valid while it is still the one the stage was made from */
+int convolver_carry(void *state, const void *old){
+    const convolver_state_t *st = state, *o = old;
+    if (st->ir_id != o->ir_id){
+        fprintf(stderr, "convolve: another impulse response was loaded since the stage "
+                "was added, remove it and add it again\n");
+        return -1;
+    }
+    return 0;
+}
+
+static inline void cmac(float *restrict acc_re, float *restrict acc_im,
+        const float *restrict xr, const float *restrict xi,
+        const float *restrict hr, const float *restrict hi, size_t n){
+    for (size_t k = 0; k < n; k++){
+        acc_re[k] += xr[k] * hr[k] - xi[k] * hi[k];
+        acc_im[k] += xr[k] * hi[k] + xi[k] * hr[k];
+    }
+}
+
+static void run_partition(convolver_state_t *st){
+    const size_t b = st->block, bins = st->bins, parts = st->parts;
+
+    st->head = st->head + 1 == parts ? 0 : st->head + 1;
+    for (int c = 0; c < st->channels; c++){
+        float *in = st->in + (size_t)c * 2 * b;
+        float *fdl_re = st->fdl_re + (size_t)c * parts * bins;
+        float *fdl_im = st->fdl_im + (size_t)c * parts * bins;
+        const size_t h = (size_t)(c % st->ir_channels) * parts * bins;
+
+        fft_forward(&st->fft, in, fdl_re + st->head * bins, fdl_im + st->head * bins);
+        memcpy(in, in + b, sizeof(float) * b);
+
+        // Y = sum over k of X[now - k] H[k]
+        memset(st->acc_re, 0, sizeof(float) * bins);
+        memset(st->acc_im, 0, sizeof(float) * bins);
+        size_t slot = st->head;
+        for (size_t k = 0; k < parts; k++){
+            cmac(st->acc_re, st->acc_im, fdl_re + slot * bins, fdl_im + slot * bins,
+                 st->ir_re + h + k * bins, st->ir_im + h + k * bins, bins);
+            slot = slot == 0 ? parts - 1 : slot - 1;
+        }
+
+        // overlap-save: the second half is the valid linear convolution
+        fft_inverse(&st->fft, st->acc_re, st->acc_im, st->time);
+        memcpy(st->out + (size_t)c * b, st->time + b, sizeof(float) * b);
+    }
+}
+
+void convolver_process(SAMPLE *samples, unsigned long frameCount, const audio_params_t *p, void *state){
+    convolver_state_t *st = state;
+    const int ch = st->channels;
+    const size_t b = st->block;
+    if (p->channels != ch)
+        return;
+
+    unsigned long done = 0;
+    while (done < frameCount){
+        size_t n = b - st->pos;
+        if (n > frameCount - done)
+            n = frameCount - done;
+
+        for (int c = 0; c < ch; c++){
+            float *in = st->in + (size_t)c * 2 * b + b + st->pos;
+            const float *out = st->out + (size_t)c * b + st->pos;
+            SAMPLE *s = samples + done * ch + c;
+            for (size_t i = 0; i < n; i++){
+                in[i] = s[i * ch];
+                s[i * ch] = out[i];
+            }
+        }
+        st->pos += n;
+        done += n;
+
+        if (st->pos == b){
+            uint64_t t0 = cbstats_now_ns();
+            run_partition(st);
+            uint32_t ns = (uint32_t)(cbstats_now_ns() - t0);
+            st->pos = 0;
+
+            atomic_store_explicit(&st->last_ns, ns, memory_order_relaxed);
+            if (ns > atomic_load_explicit(&st->max_ns, memory_order_relaxed))
+                atomic_store_explicit(&st->max_ns, ns, memory_order_relaxed);
+            atomic_fetch_add_explicit(&st->total_ns, ns, memory_order_relaxed);
+            atomic_fetch_add_explicit(&st->partitions_done, 1, memory_order_relaxed);
+        }
+    }
+}
+
+void convolver_fprint(FILE *out, const void *state){
+    const convolver_state_t *st = state;
+    const double budget_us = 1e6 * (double)st->block / st->sample_rate;
+    unsigned long n = atomic_load(&st->partitions_done);
+    double avg_us = n ? (double)atomic_load(&st->total_ns) / n / 1000.0 : 0.0;
+
+    fprintf(out, "convolve: IR %.2f s, %d ch, partition %zu frames (latency %.1f ms), "
+            "%zu partitions\n", (double)st->ir_frames / st->sample_rate, st->channels,
+            st->block, budget_us / 1000.0, st->parts);
+    fprintf(out, "  per block: last %.1f us, avg %.1f us, max %.1f us, "
+            "%.1f%% of the %.0f us budget\n",
+            atomic_load(&st->last_ns) / 1000.0, avg_us,
+            atomic_load(&st->max_ns) / 1000.0,
+            budget_us > 0 ? 100.0 * avg_us / budget_us : 0.0, budget_us);
+}
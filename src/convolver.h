@@ -0,0 +1,69 @@
+#ifndef CONVOLVER_H
+#define CONVOLVER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "audio_types.h"
+#include "fft.h"
+
+#define CONVOLVER_MAX_IR_SEC   (10)
+#define CONVOLVER_MIN_BLOCK    (32)
+#define CONVOLVER_MAX_BLOCK    (65536)
+
+/* impulse response shared by new "convolve" instances. each instance
+ * transforms it into its own partitions at creation, so loading another
+ * one never touches a running chain */
+typedef struct convolver_ir_t{
+    SAMPLE *samples;    // interleaved
+    size_t frames;
+    int channels;
+    int sample_rate;
+} convolver_ir_t;
+
+/* uniformly partitioned overlap-save convolution. the input is cut into
+ * partitions of `block` frames (frames per buffer rounded up to a power of
+ * two), every partition costs one FFT, a complex multiply-add against each
+ * IR partition and one inverse FFT. latency is one partition */
+typedef struct convolver_state_t{
+    int channels;
+    int ir_channels;    // channel c uses IR channel c % ir_channels
+    int sample_rate;
+    unsigned long ir_id;    // which convolver_ir_load it was made from
+    size_t ir_frames;
+    size_t block;
+    size_t parts;
+    size_t bins;        // block + 1
+    size_t pos;         // frames buffered in the current partition
+    size_t head;        // newest slot of the frequency delay line
+    fft_t fft;          // 2 * block points
+
+    float *in;          // channels * 2 block, previous + current partition
+    float *out;         // channels * block
+    float *fdl_re;      // channels * parts * bins, input spectra
+    float *fdl_im;
+    float *ir_re;       // ir_channels * parts * bins
+    float *ir_im;
+    float *acc_re;      // bins
+    float *acc_im;
+    float *time;        // 2 block
+
+    // written by the audio thread, read by the TUI
+    _Atomic uint32_t last_ns;
+    _Atomic uint32_t max_ns;
+    _Atomic unsigned long long total_ns;
+    _Atomic unsigned long partitions_done;
+} convolver_state_t;
+
+int convolver_ir_load(const char *path);
+const convolver_ir_t *convolver_ir(void);
+void convolver_ir_free(void);
+
+size_t convolver_state_size(const audio_params_t *p);
+int convolver_init(void *state, const audio_params_t *p);
+int convolver_carry(void *state, const void *old);
+void convolver_process(SAMPLE *samples, unsigned long frameCount, const audio_params_t *p, void *state);
+void convolver_fprint(FILE *out, const void *state);
+
+#endif
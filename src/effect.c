@@ -1,74 +1,156 @@
 #include <stdio.h>
+#include <string.h>
 #include "audio_types.h"
 #include "effect.h"
+#include "kernels.h"
+#include "utils.h"
+#include "convolver.h"
+#include "biquad.h"
 
-static float SOFTCLIP_BORDER = 2.0f/3.0f;
-void soft_clip(SAMPLE *samples, unsigned long frameCount, const audio_params_t *p){
-    for(int i = 0; i < frameCount; i++){
-        SAMPLE s = samples[i] * p->gain;
-        if (s > SAMPLE_MAX_VALUE)
-            s = SOFTCLIP_BORDER;
-        else if (s < SAMPLE_MIN_VALUE)
-            s = -SOFTCLIP_BORDER;
-        else
-            s = s - (s*s*s/3);
-        samples[i] = s;
+/* the loops live in kernels.c, dispatched to the widest SIMD set the CPU has */
+void soft_clip(SAMPLE *samples, unsigned long frameCount, const audio_params_t *p, void *state){
+    (void)state;
+    const dsp_kernels_t *k = dsp_kernels();
+    if (p->gain_step != 0.0f){
+        // gain is ramping: apply it per frame, then clip at unity
+        k->gain_ramp(samples, frameCount, p->channels, p->gain, p->gain_step);
+        k->soft_clip(samples, frameCount * p->channels, 1.0f);
+    } else {
+        k->soft_clip(samples, frameCount * p->channels, p->gain);
     }
 }
 
-void hard_clip(SAMPLE *samples, unsigned long frameCount, const audio_params_t *p){
-    for(int i = 0; i < frameCount; i++){
-        SAMPLE s = samples[i] * p->gain;
-        if (s > SAMPLE_MAX_VALUE)
-            s = SAMPLE_MAX_VALUE;
-        else if (s < SAMPLE_MIN_VALUE)
-            s = SAMPLE_MIN_VALUE;
-        samples[i] = s;
+void hard_clip(SAMPLE *samples, unsigned long frameCount, const audio_params_t *p, void *state){
+    (void)state;
+    const dsp_kernels_t *k = dsp_kernels();
+    if (p->gain_step != 0.0f){
+        k->gain_ramp(samples, frameCount, p->channels, p->gain, p->gain_step);
+        k->hard_clip(samples, frameCount * p->channels, 1.0f);
+    } else {
+        k->hard_clip(samples, frameCount * p->channels, p->gain);
     }
 }
 
-void invert(SAMPLE *samples, unsigned long frameCount, const audio_params_t *p){
-    (void)p;
-    for (unsigned long i = 0; i < frameCount; ++i)
-        samples[i] = -samples[i];
+void invert(SAMPLE *samples, unsigned long frameCount, const audio_params_t *p, void *state){
+    (void)state;
+    dsp_kernels()->invert(samples, frameCount * p->channels);
+}
+
+void gain(SAMPLE *samples, unsigned long frameCount, const audio_params_t *p, void *state){
+    (void)state;
+    const dsp_kernels_t *k = dsp_kernels();
+    if (p->gain_step != 0.0f)
+        k->gain_ramp(samples, frameCount, p->channels, p->gain, p->gain_step);
+    else
+        k->gain(samples, frameCount * p->channels, p->gain);
 }
 
-void no_change(SAMPLE *samples, unsigned long frameCount, const audio_params_t *p){
+void no_change(SAMPLE *samples, unsigned long frameCount, const audio_params_t *p, void *state){
     (void)samples;
     (void)frameCount;
     (void)p;
+    (void)state;
+}
+
+// one delay element per channel
+typedef struct feed_forward_state_t{
+    int channels;
+    SAMPLE z[];
+} feed_forward_state_t;
+
+static size_t feed_forward_state_size(const audio_params_t *p){
+    return sizeof(feed_forward_state_t) + sizeof(SAMPLE) * (size_t)p->channels;
+}
+
+static int feed_forward_init(void *state, const audio_params_t *p){
+    feed_forward_state_t *st = state;
+    st->channels = p->channels;
+    return 0;
+}
+
+void feed_forward_filter(SAMPLE *samples, unsigned long frameCount, const audio_params_t *p, void *state){
+    feed_forward_state_t *st = state;
+    const float a0 = 0.5f;
+    const float b0 = 0.5f;
+    const int ch = st->channels;
+    if (p->channels != ch)
+        return;
+
+    for (int c = 0; c < ch; c++){
+        SAMPLE z = st->z[c];
+        for (unsigned long i = 0; i < frameCount; i++){
+            SAMPLE s = samples[i * ch + c];
+            samples[i * ch + c] = a0 * s + b0 * z;
+            z = s;
+        }
+        st->z[c] = z;
+    }
 }
 
-static SAMPLE state_register = 0;
-void feed_forward_filter(SAMPLE *samples, unsigned long frameCount, const audio_params_t *p){
+// same filter on one contiguous buffer per channel
+void feed_forward_planar(SAMPLE *const *ch, unsigned long frameCount, const audio_params_t *p, void *state){
+    feed_forward_state_t *st = state;
     const float a0 = 0.5f;
     const float b0 = 0.5f;
-    for(int i = 0; i < frameCount; i++){
-        SAMPLE new_s = a0 * samples[i] + b0 * state_register;
-        state_register = samples[i];
-        samples[i] = new_s;
+    if (p->channels != st->channels)
+        return;
+
+    for (int c = 0; c < st->channels; c++){
+        SAMPLE *x = ch[c];
+        SAMPLE z = st->z[c];
+        for (unsigned long i = 0; i < frameCount; i++){
+            SAMPLE s = x[i];
+            x[i] = a0 * s + b0 * z;
+            z = s;
+        }
+        st->z[c] = z;
     }
 }
 
 const effect_t effects[] = {
-    {"none", "No processing", no_change },
-    {"soft", "Soft clipping", soft_clip },
-    {"hard", "Hard clipping", hard_clip },
-    {"inversion", "inverted samples", invert },
-    {"feed forward", "-", feed_forward_filter}
+    { .name = "none", .description = "No processing", .func = no_change },
+    { .name = "soft", .description = "Soft clipping", .func = soft_clip },
+    { .name = "hard", .description = "Hard clipping", .func = hard_clip },
+    { .name = "inversion", .description = "inverted samples", .func = invert },
+    { .name = "feed forward", .description = "-", .func = feed_forward_filter,
+        .state_size = feed_forward_state_size, .init = feed_forward_init,
+        .planar = feed_forward_planar, .history = 1 },
+    { .name = "gain", .description = "Gain multiplier", .func = gain },
+    { .name = "convolve", .description = "FFT convolution with the loaded IR",
+        .func = convolver_process, .state_size = convolver_state_size,
+        .init = convolver_init, .carry = convolver_carry },
+    { .name = "eq", .description = "Parametric EQ, bands set with the eq command",
+        .func = eq_process, .state_size = eq_state_size, .init = eq_init,
+        .carry = eq_carry },
 };
 
 const size_t effects_count = sizeof(effects) / sizeof(effects[0]);
 
-// const effect_t *effect_by_id(effect_id id) {
-//     for (size_t i = 0; i < effects_count; i++){
-//         if (effects[i].id == id) 
-//             return &effects[i];
-//     }
-//     return NULL;
-// }
-
-// audio_process_fn effect_func_by_id(effect_id id){
-//     const effect_t *e = effect_by_id(id);
-//     return e ? e->func : NULL;
-// }
\ No newline at end of file
+/* lookup by name or by index in effects[] */
+const effect_t *effect_find(const char *name){
+    for (size_t i = 0; i < effects_count; i++){
+        if (strcmp(effects[i].name, name) == 0)
+            return &effects[i];
+    }
+
+    int idx;
+    if (parse_int(name, &idx) == 0 && idx >= 0 && (size_t)idx < effects_count)
+        return &effects[idx];
+    return NULL;
+}
+
+/* allocate and initialise the state block of one instance. NULL with no
+ * error for stateless effects, check e->state_size to tell them apart */
+void *effect_state_create(const effect_t *e, const audio_params_t *p, arena_t *arena){
+    if (!e->state_size)
+        return NULL;
+
+    void *state = arena_alloc(arena, e->state_size(p));
+    if (!state){
+        fprintf(stderr, "%s: effect state arena is full\n", e->name);
+        return NULL;
+    }
+    if (e->init && e->init(state, p) < 0)
+        return NULL;
+    return state;
+}
@@ -1,12 +1,32 @@
 #pragma once
 
+#include <stddef.h>
 #include "audio_types.h"
+#include "arena.h"
+
+// bytes of state one instance needs for the given params
+typedef size_t (*effect_state_size_fn)(const audio_params_t *p);
+// optional, runs once on the zeroed state when the instance is created
+typedef int (*effect_init_fn)(void *state, const audio_params_t *p);
+// optional, copies what the user set on an old instance into a fresh one,
+// which may be for other params. only reads the TUI side of old
+typedef int (*effect_carry_fn)(void *state, const void *old);
 
 typedef struct effect_t{
     char *name;
     char *description;
     audio_process_fn func;
+    effect_state_size_fn state_size; // NULL: stateless
+    effect_init_fn init;
+    audio_planar_fn planar; // optional, the chain prefers it over func
+    // stateful only: frames of past input that fully determine the state
+    // (FIR order), 0 if unbounded. lets offline split a file into chunks
+    unsigned long history;
+    effect_carry_fn carry;
 } effect_t;
 
 extern const effect_t effects[];
-extern const size_t effects_count;
\ No newline at end of file
+extern const size_t effects_count;
+
+const effect_t *effect_find(const char *name);
+void *effect_state_create(const effect_t *e, const audio_params_t *p, arena_t *arena);
\ No newline at end of file
@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "fft.h"
+
+static size_t round64(size_t bytes){
+    return (bytes + 63) & ~(size_t)63;
+}
+
+size_t fft_mem_size(size_t n){
+    size_t m = n / 2;
+    return round64(m * sizeof(uint32_t))
+        + 2 * round64((m / 2 + 1) * sizeof(float))
+        + 2 * round64((m + 1) * sizeof(float))
+        + 2 * round64(m * sizeof(float));
+}
+
+static void *carve(unsigned char **p, size_t bytes){
+    void *r = *p;
+    *p += round64(bytes);
+    return r;
+}
+
+int fft_init_mem(fft_t *f, size_t n, void *mem){
+    memset(f, 0, sizeof *f);
+    if (n < 4 || (n & (n - 1)) != 0){
+        fprintf(stderr, "fft_init: size %zu is not a power of two >= 4\n", n);
+        return -1;
+    }
+
+    f->n = n;
+    f->m = n / 2;
+    const size_t m = f->m;
+
+    unsigned char *p = mem;
+    f->bitrev = carve(&p, m * sizeof(uint32_t));
+    f->tw_re = carve(&p, (m / 2 + 1) * sizeof(float));
+    f->tw_im = carve(&p, (m / 2 + 1) * sizeof(float));
+    f->rt_re = carve(&p, (m + 1) * sizeof(float));
+    f->rt_im = carve(&p, (m + 1) * sizeof(float));
+    f->z_re = carve(&p, m * sizeof(float));
+    f->z_im = carve(&p, m * sizeof(float));
+
+    int bits = 0;
+    while (((size_t)1 << bits) < m)
+        bits++;
+    for (size_t i = 0; i < m; i++){
+        uint32_t r = 0;
+        for (int b = 0; b < bits; b++)
+            r |= ((i >> b) & 1u) << (bits - 1 - b);
+        f->bitrev[i] = r;
+    }
+
+    // tables in double so large sizes keep full float accuracy
+    for (size_t k = 0; k < m / 2; k++){
+        double a = -2.0 * M_PI * (double)k / (double)m;
+        f->tw_re[k] = (float)cos(a);
+        f->tw_im[k] = (float)sin(a);
+    }
+    for (size_t k = 0; k <= m; k++){
+        double a = -2.0 * M_PI * (double)k / (double)n;
+        f->rt_re[k] = (float)cos(a);
+        f->rt_im[k] = (float)sin(a);
+    }
+    return 0;
+}
+
+int fft_init(fft_t *f, size_t n){
+    if (n < 4 || (n & (n - 1)) != 0)
+        return fft_init_mem(f, n, NULL);
+
+    void *mem = aligned_alloc(64, fft_mem_size(n));
+    if (!mem){
+        perror("fft_init");
+        return -1;
+    }
+    if (fft_init_mem(f, n, mem) < 0){
+        free(mem);
+        return -1;
+    }
+    f->owned = mem;
+    return 0;
+}
+
+void fft_free(fft_t *f){
+    free(f->owned);
+    memset(f, 0, sizeof *f);
+}
+
+/* in-place complex FFT of size m on bit-reversed input. sign -1: forward,
+ * +1: inverse (unscaled) */
+static void cfft(const fft_t *f, float *re, float *im, float sign){
+    const size_t m = f->m;
+    for (size_t len = 2; len <= m; len <<= 1){
+        const size_t half = len / 2;
+        const size_t step = m / len;
+        for (size_t i = 0; i < m; i += len){
+            for (size_t j = 0; j < half; j++){
+                float wr = f->tw_re[j * step];
+                float wi = sign < 0 ? f->tw_im[j * step] : -f->tw_im[j * step];
+                size_t a = i + j, b = a + half;
+                float tr = re[b] * wr - im[b] * wi;
+                float ti = re[b] * wi + im[b] * wr;
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+}
+
+void fft_forward(fft_t *f, const float *in, float *re, float *im){
+    const size_t m = f->m;
+    float *zr = f->z_re, *zi = f->z_im;
+
+    // pack even/odd samples as one complex sequence, bit-reversed
+    for (size_t i = 0; i < m; i++){
+        uint32_t r = f->bitrev[i];
+        zr[r] = in[2 * i];
+        zi[r] = in[2 * i + 1];
+    }
+    cfft(f, zr, zi, -1.0f);
+
+    // split: X[k] = E[k] + W^k O[k]
+    for (size_t k = 0; k <= m; k++){
+        size_t k1 = k == m ? 0 : k;
+        size_t k2 = k == 0 ? 0 : m - k;
+        float ar = zr[k1], ai = zi[k1];
+        float br = zr[k2], bi = -zi[k2];             // conj(Z[m - k])
+        float er = 0.5f * (ar + br), ei = 0.5f * (ai + bi);
+        float or_ = 0.5f * (ai - bi), oi = -0.5f * (ar - br);  // (a - b) / 2i
+        float wr = f->rt_re[k], wi = f->rt_im[k];
+        re[k] = er + (or_ * wr - oi * wi);
+        im[k] = ei + (or_ * wi + oi * wr);
+    }
+}
+
+void fft_inverse(fft_t *f, const float *re, const float *im, float *out){
+    const size_t m = f->m;
+    float *zr = f->z_re, *zi = f->z_im;
+    const float scale = 1.0f / (float)f->n;
+
+    // E[k] = (X[k] + conj(X[m-k])) / 2, O[k] = (X[k] - conj(X[m-k])) W^-k / 2,
+    // Z[k] = E[k] + i O[k], the 1/m of the inverse folded in
+    for (size_t k = 0; k < m; k++){
+        float ar = re[k], ai = im[k];
+        float br = re[m - k], bi = -im[m - k];
+        float er = ar + br, ei = ai + bi;
+        float dr = ar - br, di = ai - bi;
+        float wr = f->rt_re[k], wi = -f->rt_im[k];
+        float or_ = dr * wr - di * wi, oi = dr * wi + di * wr;
+        uint32_t r = f->bitrev[k];
+        zr[r] = (er - oi) * scale;
+        zi[r] = (ei + or_) * scale;
+    }
+    cfft(f, zr, zi, 1.0f);
+
+    for (size_t i = 0; i < m; i++){
+        out[2 * i] = zr[i];
+        out[2 * i + 1] = zi[i];
+    }
+}
+
+void fft_window_hann(float *w, size_t n){
+    for (size_t i = 0; i < n; i++)
+        w[i] = (float)(0.5 - 0.5 * cos(2.0 * M_PI * (double)i / (double)n));
+}
@@ -0,0 +1,38 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* real FFT of power-of-two size n, computed as an n/2 point complex radix-2
+ * FFT plus a split step. spectra are split re/im arrays of n/2 + 1 bins.
+ * all tables and scratch are allocated in fft_init, transforms never
+ * allocate */
+typedef struct fft_t{
+    size_t n;
+    size_t m;           // n / 2, complex size
+    uint32_t *bitrev;   // m
+    float *tw_re;       // m / 2, e^{-2 pi i k / m}
+    float *tw_im;
+    float *rt_re;       // m + 1, e^{-2 pi i k / n} for the split step
+    float *rt_im;
+    float *z_re;        // m, scratch
+    float *z_im;
+    void *owned;        // tables block when allocated by fft_init
+} fft_t;
+
+int fft_init(fft_t *f, size_t n);
+void fft_free(fft_t *f);
+
+// tables carved from caller memory (64 byte aligned, fft_mem_size bytes),
+// for instances that live in an arena. fft_free does not release it
+size_t fft_mem_size(size_t n);
+int fft_init_mem(fft_t *f, size_t n, void *mem);
+
+void fft_forward(fft_t *f, const float *in, float *re, float *im);
+// exact inverse of fft_forward, scaling included
+void fft_inverse(fft_t *f, const float *re, const float *im, float *out);
+
+void fft_window_hann(float *w, size_t n);
+
+#endif
@@ -0,0 +1,816 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "kernels.h"
+#include "audio_types.h"
+
+/* every set is bit-exact with the scalar loops only if no compiler fuses
+ * a * b + c into an fma in one of them: gcc does by default whenever the
+ * target has fma (x86-64 with -march=haswell, every aarch64). that covers
+ * the neon intrinsics too, gcc fuses vmulq + vaddq like plain float ops */
+#if defined(__clang__)
+  #pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+  #pragma GCC optimize("fp-contract=off")
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+  #define KERNELS_X86
+  #include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  #define KERNELS_NEON
+  #include <arm_neon.h>
+#endif
+
+static const float SOFTCLIP_BORDER = 2.0f/3.0f;
+
+/* ---- scalar reference ---- */
+
+static void gain_scalar(SAMPLE *x, size_t n, float g){
+    for (size_t i = 0; i < n; i++)
+        x[i] *= g;
+}
+
+static void invert_scalar(SAMPLE *x, size_t n){
+    for (size_t i = 0; i < n; i++)
+        x[i] = -x[i];
+}
+
+static void hard_clip_scalar(SAMPLE *x, size_t n, float g){
+    for (size_t i = 0; i < n; i++){
+        SAMPLE s = x[i] * g;
+        if (s > SAMPLE_MAX_VALUE)
+            s = SAMPLE_MAX_VALUE;
+        else if (s < SAMPLE_MIN_VALUE)
+            s = SAMPLE_MIN_VALUE;
+        x[i] = s;
+    }
+}
+
+static void soft_clip_scalar(SAMPLE *x, size_t n, float g){
+    for (size_t i = 0; i < n; i++){
+        SAMPLE s = x[i] * g;
+        if (s > SAMPLE_MAX_VALUE)
+            s = SOFTCLIP_BORDER;
+        else if (s < SAMPLE_MIN_VALUE)
+            s = -SOFTCLIP_BORDER;
+        else
+            s = s - (s*s*s/3);
+        x[i] = s;
+    }
+}
+
+// channels c0..channels-1, also the tail of the SIMD versions. inlined so
+// the tail of the AVX2 kernel is VEX encoded too (no SSE/AVX transitions)
+#define KERNEL_INLINE static inline __attribute__((always_inline))
+
+KERNEL_INLINE void biquad_lanes_scalar(SAMPLE *x, size_t frames, int channels, int c0,
+                                const float c[5], float *z1, float *z2){
+    for (int ch = c0; ch < channels; ch++){
+        float s1 = z1[ch], s2 = z2[ch];
+        for (size_t i = 0; i < frames; i++){
+            float in = x[i * channels + ch];
+            float y = c[0] * in + s1;
+            s1 = c[1] * in - c[3] * y + s2;
+            s2 = c[2] * in - c[4] * y;
+            x[i * channels + ch] = y;
+        }
+        z1[ch] = s1;
+        z2[ch] = s2;
+    }
+}
+
+static void biquad_scalar(SAMPLE *x, size_t frames, int channels, const float c[5],
+                          float *z1, float *z2){
+    biquad_lanes_scalar(x, frames, channels, 0, c, z1, z2);
+}
+
+// frames from i0 on, also the tail of the SIMD versions
+KERNEL_INLINE void deinterleave_from_scalar(const SAMPLE *in, SAMPLE *const *out,
+                                            size_t i0, size_t frames, int channels){
+    for (int c = 0; c < channels; c++){
+        SAMPLE *o = out[c];
+        for (size_t i = i0; i < frames; i++)
+            o[i] = in[i * channels + c];
+    }
+}
+
+KERNEL_INLINE void interleave_from_scalar(const SAMPLE *const *in, SAMPLE *out,
+                                          size_t i0, size_t frames, int channels){
+    for (int c = 0; c < channels; c++){
+        const SAMPLE *s = in[c];
+        for (size_t i = i0; i < frames; i++)
+            out[i * channels + c] = s[i];
+    }
+}
+
+static void deinterleave_scalar(const SAMPLE *in, SAMPLE *const *out, size_t frames, int channels){
+    deinterleave_from_scalar(in, out, 0, frames, channels);
+}
+
+static void interleave_scalar(const SAMPLE *const *in, SAMPLE *out, size_t frames, int channels){
+    interleave_from_scalar(in, out, 0, frames, channels);
+}
+
+// comparisons written like minps/maxps (second operand on NaN) and lrintf
+// rounds to nearest even like cvtps2dq/fcvtns
+KERNEL_INLINE void quantize_from_scalar(const SAMPLE *x, const float *dither, int32_t *out,
+                                        size_t i, size_t n, float scale, float max){
+    for (; i < n; i++){
+        float v = x[i] * scale;
+        if (dither)
+            v = v + dither[i];
+        v = v < max ? v : max;
+        v = v > -scale ? v : -scale;
+        out[i] = (int32_t)lrintf(v);
+    }
+}
+
+static void quantize_scalar(const SAMPLE *x, const float *dither, int32_t *out, size_t n,
+                            float scale, float max){
+    quantize_from_scalar(x, dither, out, 0, n, scale, max);
+}
+
+// frames f0.. of the ramp. the gain is computed from f every frame, never
+// accumulated, so any split into vectors gives the same values
+KERNEL_INLINE void gain_ramp_from_scalar(SAMPLE *x, size_t f0, size_t frames, int channels,
+                                         float g0, float dg){
+    for (size_t f = f0; f < frames; f++){
+        float g = g0 + dg * (float)f;
+        SAMPLE *p = x + f * channels;
+        for (int c = 0; c < channels; c++)
+            p[c] *= g;
+    }
+}
+
+static void gain_ramp_scalar(SAMPLE *x, size_t frames, int channels, float g0, float dg){
+    gain_ramp_from_scalar(x, 0, frames, channels, g0, dg);
+}
+
+// the SIMD versions compute 4/8 outputs at once, each summed in tap order
+KERNEL_INLINE void fir_from_scalar(const float *x, float *y, size_t i, size_t n,
+                                   const float *c, size_t taps){
+    for (; i < n; i++){
+        float acc = 0.0f;
+        for (size_t k = 0; k < taps; k++)
+            acc = acc + c[k] * x[i + k];
+        y[i] = acc;
+    }
+}
+
+static void fir_scalar(const float *x, float *y, size_t n, const float *c, size_t taps){
+    fir_from_scalar(x, y, 0, n, c, taps);
+}
+
+KERNEL_INLINE float dot8_scalar(const float *c, const float *x, size_t taps){
+    float s[8] = { 0.0f };
+    for (size_t k = 0; k < taps; k += 8)
+        for (int j = 0; j < 8; j++)
+            s[j] = s[j] + c[k + j] * x[k + j];
+    float t0 = s[0] + s[4], t1 = s[1] + s[5], t2 = s[2] + s[6], t3 = s[3] + s[7];
+    return (t0 + t2) + (t1 + t3);
+}
+
+static void poly_fir_scalar(const float *x, const size_t *at, const float *const *c,
+                            float *y, size_t n, size_t taps){
+    for (size_t j = 0; j < n; j++)
+        y[j] = dot8_scalar(c[j], x + at[j], taps);
+}
+
+const dsp_kernels_t kernels_scalar = {
+    "scalar", gain_scalar, invert_scalar, hard_clip_scalar, soft_clip_scalar,
+    biquad_scalar, deinterleave_scalar, interleave_scalar, quantize_scalar,
+    gain_ramp_scalar, fir_scalar, poly_fir_scalar
+};
+
+/* ---- SIMD sets ----
+ * branch-free: the cubic is computed for every lane and the out of range
+ * lanes are blended in with compare masks. the division by 3 is kept (no
+ * reciprocal multiply) so results match the scalar code bit for bit.
+ * min/max take the constant first so NaN passes through like in scalar.
+ * tails fall back to the scalar loop. the biquad vectorizes across
+ * channels (4 or 8 per frame), the recursion over time stays serial */
+
+#ifdef KERNELS_X86
+
+static void gain_sse2(SAMPLE *x, size_t n, float g){
+    const __m128 vg = _mm_set1_ps(g);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(x + i, _mm_mul_ps(_mm_loadu_ps(x + i), vg));
+    gain_scalar(x + i, n - i, g);
+}
+
+static void invert_sse2(SAMPLE *x, size_t n){
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(x + i, _mm_xor_ps(_mm_loadu_ps(x + i), sign));
+    invert_scalar(x + i, n - i);
+}
+
+static void hard_clip_sse2(SAMPLE *x, size_t n, float g){
+    const __m128 vg = _mm_set1_ps(g);
+    const __m128 hi = _mm_set1_ps(SAMPLE_MAX_VALUE);
+    const __m128 lo = _mm_set1_ps(SAMPLE_MIN_VALUE);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4){
+        __m128 s = _mm_mul_ps(_mm_loadu_ps(x + i), vg);
+        _mm_storeu_ps(x + i, _mm_min_ps(hi, _mm_max_ps(lo, s)));
+    }
+    hard_clip_scalar(x + i, n - i, g);
+}
+
+static inline __m128 blend_sse2(__m128 mask, __m128 a, __m128 b){
+    return _mm_or_ps(_mm_and_ps(mask, b), _mm_andnot_ps(mask, a));
+}
+
+static void soft_clip_sse2(SAMPLE *x, size_t n, float g){
+    const __m128 vg = _mm_set1_ps(g);
+    const __m128 hi = _mm_set1_ps(SAMPLE_MAX_VALUE);
+    const __m128 lo = _mm_set1_ps(SAMPLE_MIN_VALUE);
+    const __m128 three = _mm_set1_ps(3.0f);
+    const __m128 bhi = _mm_set1_ps(SOFTCLIP_BORDER);
+    const __m128 blo = _mm_set1_ps(-SOFTCLIP_BORDER);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4){
+        __m128 s = _mm_mul_ps(_mm_loadu_ps(x + i), vg);
+        __m128 cube = _mm_mul_ps(_mm_mul_ps(s, s), s);
+        __m128 y = _mm_sub_ps(s, _mm_div_ps(cube, three));
+        y = blend_sse2(_mm_cmpgt_ps(s, hi), y, bhi);
+        y = blend_sse2(_mm_cmplt_ps(s, lo), y, blo);
+        _mm_storeu_ps(x + i, y);
+    }
+    soft_clip_scalar(x + i, n - i, g);
+}
+
+KERNEL_INLINE void biquad_lanes_sse2(SAMPLE *x, size_t frames, int channels, int c0,
+                              const float c[5], float *z1, float *z2){
+    const __m128 b0 = _mm_set1_ps(c[0]), b1 = _mm_set1_ps(c[1]), b2 = _mm_set1_ps(c[2]);
+    const __m128 a1 = _mm_set1_ps(c[3]), a2 = _mm_set1_ps(c[4]);
+    int ch = c0;
+    for (; ch + 4 <= channels; ch += 4){
+        __m128 s1 = _mm_loadu_ps(z1 + ch), s2 = _mm_loadu_ps(z2 + ch);
+        for (size_t i = 0; i < frames; i++){
+            SAMPLE *p = x + i * channels + ch;
+            __m128 in = _mm_loadu_ps(p);
+            __m128 y = _mm_add_ps(_mm_mul_ps(b0, in), s1);
+            s1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, in), _mm_mul_ps(a1, y)), s2);
+            s2 = _mm_sub_ps(_mm_mul_ps(b2, in), _mm_mul_ps(a2, y));
+            _mm_storeu_ps(p, y);
+        }
+        _mm_storeu_ps(z1 + ch, s1);
+        _mm_storeu_ps(z2 + ch, s2);
+    }
+    biquad_lanes_scalar(x, frames, channels, ch, c, z1, z2);
+}
+
+static void biquad_sse2(SAMPLE *x, size_t frames, int channels, const float c[5],
+                        float *z1, float *z2){
+    biquad_lanes_sse2(x, frames, channels, 0, c, z1, z2);
+}
+
+// stereo and 4 channels are shuffles, other counts use the scalar loops
+static void deinterleave_sse2(const SAMPLE *in, SAMPLE *const *out, size_t frames, int channels){
+    size_t i = 0;
+    if (channels == 2){
+        for (; i + 4 <= frames; i += 4){
+            __m128 a = _mm_loadu_ps(in + 2 * i), b = _mm_loadu_ps(in + 2 * i + 4);
+            _mm_storeu_ps(out[0] + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+            _mm_storeu_ps(out[1] + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+        }
+    } else if (channels == 4){
+        for (; i + 4 <= frames; i += 4){
+            __m128 r0 = _mm_loadu_ps(in + 4 * i), r1 = _mm_loadu_ps(in + 4 * i + 4);
+            __m128 r2 = _mm_loadu_ps(in + 4 * i + 8), r3 = _mm_loadu_ps(in + 4 * i + 12);
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            _mm_storeu_ps(out[0] + i, r0);
+            _mm_storeu_ps(out[1] + i, r1);
+            _mm_storeu_ps(out[2] + i, r2);
+            _mm_storeu_ps(out[3] + i, r3);
+        }
+    }
+    deinterleave_from_scalar(in, out, i, frames, channels);
+}
+
+static void interleave_sse2(const SAMPLE *const *in, SAMPLE *out, size_t frames, int channels){
+    size_t i = 0;
+    if (channels == 2){
+        for (; i + 4 <= frames; i += 4){
+            __m128 l = _mm_loadu_ps(in[0] + i), r = _mm_loadu_ps(in[1] + i);
+            _mm_storeu_ps(out + 2 * i, _mm_unpacklo_ps(l, r));
+            _mm_storeu_ps(out + 2 * i + 4, _mm_unpackhi_ps(l, r));
+        }
+    } else if (channels == 4){
+        for (; i + 4 <= frames; i += 4){
+            __m128 r0 = _mm_loadu_ps(in[0] + i), r1 = _mm_loadu_ps(in[1] + i);
+            __m128 r2 = _mm_loadu_ps(in[2] + i), r3 = _mm_loadu_ps(in[3] + i);
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            _mm_storeu_ps(out + 4 * i, r0);
+            _mm_storeu_ps(out + 4 * i + 4, r1);
+            _mm_storeu_ps(out + 4 * i + 8, r2);
+            _mm_storeu_ps(out + 4 * i + 12, r3);
+        }
+    }
+    interleave_from_scalar(in, out, i, frames, channels);
+}
+
+KERNEL_INLINE void quantize_from_sse2(const SAMPLE *x, const float *dither, int32_t *out,
+                                      size_t i, size_t n, float scale, float max){
+    const __m128 vs = _mm_set1_ps(scale);
+    const __m128 hi = _mm_set1_ps(max);
+    const __m128 lo = _mm_set1_ps(-scale);
+    for (; i + 4 <= n; i += 4){
+        __m128 v = _mm_mul_ps(_mm_loadu_ps(x + i), vs);
+        if (dither)
+            v = _mm_add_ps(v, _mm_loadu_ps(dither + i));
+        v = _mm_max_ps(_mm_min_ps(v, hi), lo);
+        _mm_storeu_si128((__m128i *)(out + i), _mm_cvtps_epi32(v));
+    }
+    quantize_from_scalar(x, dither, out, i, n, scale, max);
+}
+
+static void quantize_sse2(const SAMPLE *x, const float *dither, int32_t *out, size_t n,
+                          float scale, float max){
+    quantize_from_sse2(x, dither, out, 0, n, scale, max);
+}
+
+/* mono and stereo: a vector covers 4 or 2 frames, the lanes get their frame
+ * number from an offset pattern. wider frames broadcast one gain per frame */
+static void gain_ramp_sse2(SAMPLE *x, size_t frames, int channels, float g0, float dg){
+    const __m128 vg0 = _mm_set1_ps(g0), vdg = _mm_set1_ps(dg);
+    size_t f = 0;
+    if (channels <= 2){
+        const size_t per = (size_t)(4 / channels);
+        const __m128 off = channels == 1 ? _mm_setr_ps(0, 1, 2, 3) : _mm_setr_ps(0, 0, 1, 1);
+        for (; f + per <= frames; f += per){
+            __m128 idx = _mm_add_ps(_mm_set1_ps((float)f), off);
+            __m128 g = _mm_add_ps(vg0, _mm_mul_ps(vdg, idx));
+            SAMPLE *p = x + f * channels;
+            _mm_storeu_ps(p, _mm_mul_ps(_mm_loadu_ps(p), g));
+        }
+    } else if (channels >= 4){
+        for (; f < frames; f++){
+            float gs = g0 + dg * (float)f;
+            __m128 g = _mm_set1_ps(gs);
+            SAMPLE *p = x + f * channels;
+            int c = 0;
+            for (; c + 4 <= channels; c += 4)
+                _mm_storeu_ps(p + c, _mm_mul_ps(_mm_loadu_ps(p + c), g));
+            for (; c < channels; c++)
+                p[c] *= gs;
+        }
+    }
+    gain_ramp_from_scalar(x, f, frames, channels, g0, dg);
+}
+
+static void fir_sse2(const float *x, float *y, size_t n, const float *c, size_t taps){
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4){
+        __m128 acc = _mm_setzero_ps();
+        for (size_t k = 0; k < taps; k++)
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(c[k]), _mm_loadu_ps(x + i + k)));
+        _mm_storeu_ps(y + i, acc);
+    }
+    fir_from_scalar(x, y, i, n, c, taps);
+}
+
+// (t0 + t2) + (t1 + t3) of t = lo + hi, the fold of dot8_scalar
+static inline float fold_sse2(__m128 lo, __m128 hi){
+    __m128 t = _mm_add_ps(lo, hi);
+    __m128 u = _mm_add_ps(t, _mm_movehl_ps(t, t));
+    return _mm_cvtss_f32(_mm_add_ss(u, _mm_shuffle_ps(u, u, 1)));
+}
+
+// two outputs per pass, four add chains in flight
+static void poly_fir_sse2(const float *x, const size_t *at, const float *const *c,
+                          float *y, size_t n, size_t taps){
+    size_t j = 0;
+    for (; j + 2 <= n; j += 2){
+        const float *c0 = c[j], *x0 = x + at[j];
+        const float *c1 = c[j + 1], *x1 = x + at[j + 1];
+        __m128 lo0 = _mm_setzero_ps(), hi0 = _mm_setzero_ps();
+        __m128 lo1 = _mm_setzero_ps(), hi1 = _mm_setzero_ps();
+        for (size_t k = 0; k < taps; k += 8){
+            lo0 = _mm_add_ps(lo0, _mm_mul_ps(_mm_loadu_ps(c0 + k), _mm_loadu_ps(x0 + k)));
+            hi0 = _mm_add_ps(hi0, _mm_mul_ps(_mm_loadu_ps(c0 + k + 4), _mm_loadu_ps(x0 + k + 4)));
+            lo1 = _mm_add_ps(lo1, _mm_mul_ps(_mm_loadu_ps(c1 + k), _mm_loadu_ps(x1 + k)));
+            hi1 = _mm_add_ps(hi1, _mm_mul_ps(_mm_loadu_ps(c1 + k + 4), _mm_loadu_ps(x1 + k + 4)));
+        }
+        y[j] = fold_sse2(lo0, hi0);
+        y[j + 1] = fold_sse2(lo1, hi1);
+    }
+    for (; j < n; j++)
+        y[j] = dot8_scalar(c[j], x + at[j], taps);
+}
+
+static const dsp_kernels_t kernels_sse2 = {
+    "sse2", gain_sse2, invert_sse2, hard_clip_sse2, soft_clip_sse2, biquad_sse2,
+    deinterleave_sse2, interleave_sse2, quantize_sse2, gain_ramp_sse2,
+    fir_sse2, poly_fir_sse2
+};
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static void gain_avx2(SAMPLE *x, size_t n, float g){
+    const __m256 vg = _mm256_set1_ps(g);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(x + i, _mm256_mul_ps(_mm256_loadu_ps(x + i), vg));
+    gain_sse2(x + i, n - i, g);
+}
+
+AVX2 static void invert_avx2(SAMPLE *x, size_t n){
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(x + i, _mm256_xor_ps(_mm256_loadu_ps(x + i), sign));
+    invert_sse2(x + i, n - i);
+}
+
+AVX2 static void hard_clip_avx2(SAMPLE *x, size_t n, float g){
+    const __m256 vg = _mm256_set1_ps(g);
+    const __m256 hi = _mm256_set1_ps(SAMPLE_MAX_VALUE);
+    const __m256 lo = _mm256_set1_ps(SAMPLE_MIN_VALUE);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8){
+        __m256 s = _mm256_mul_ps(_mm256_loadu_ps(x + i), vg);
+        _mm256_storeu_ps(x + i, _mm256_min_ps(hi, _mm256_max_ps(lo, s)));
+    }
+    hard_clip_sse2(x + i, n - i, g);
+}
+
+AVX2 static void soft_clip_avx2(SAMPLE *x, size_t n, float g){
+    const __m256 vg = _mm256_set1_ps(g);
+    const __m256 hi = _mm256_set1_ps(SAMPLE_MAX_VALUE);
+    const __m256 lo = _mm256_set1_ps(SAMPLE_MIN_VALUE);
+    const __m256 three = _mm256_set1_ps(3.0f);
+    const __m256 bhi = _mm256_set1_ps(SOFTCLIP_BORDER);
+    const __m256 blo = _mm256_set1_ps(-SOFTCLIP_BORDER);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8){
+        __m256 s = _mm256_mul_ps(_mm256_loadu_ps(x + i), vg);
+        __m256 cube = _mm256_mul_ps(_mm256_mul_ps(s, s), s);
+        __m256 y = _mm256_sub_ps(s, _mm256_div_ps(cube, three));
+        y = _mm256_blendv_ps(y, bhi, _mm256_cmp_ps(s, hi, _CMP_GT_OQ));
+        y = _mm256_blendv_ps(y, blo, _mm256_cmp_ps(s, lo, _CMP_LT_OQ));
+        _mm256_storeu_ps(x + i, y);
+    }
+    soft_clip_sse2(x + i, n - i, g);
+}
+
+AVX2 static void biquad_avx2(SAMPLE *x, size_t frames, int channels, const float c[5],
+                             float *z1, float *z2){
+    const __m256 b0 = _mm256_set1_ps(c[0]), b1 = _mm256_set1_ps(c[1]), b2 = _mm256_set1_ps(c[2]);
+    const __m256 a1 = _mm256_set1_ps(c[3]), a2 = _mm256_set1_ps(c[4]);
+    int ch = 0;
+    for (; ch + 8 <= channels; ch += 8){
+        __m256 s1 = _mm256_loadu_ps(z1 + ch), s2 = _mm256_loadu_ps(z2 + ch);
+        for (size_t i = 0; i < frames; i++){
+            SAMPLE *p = x + i * channels + ch;
+            __m256 in = _mm256_loadu_ps(p);
+            __m256 y = _mm256_add_ps(_mm256_mul_ps(b0, in), s1);
+            s1 = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(b1, in), _mm256_mul_ps(a1, y)), s2);
+            s2 = _mm256_sub_ps(_mm256_mul_ps(b2, in), _mm256_mul_ps(a2, y));
+            _mm256_storeu_ps(p, y);
+        }
+        _mm256_storeu_ps(z1 + ch, s1);
+        _mm256_storeu_ps(z2 + ch, s2);
+    }
+    biquad_lanes_sse2(x, frames, channels, ch, c, z1, z2);
+}
+
+AVX2 static void quantize_avx2(const SAMPLE *x, const float *dither, int32_t *out, size_t n,
+                               float scale, float max){
+    const __m256 vs = _mm256_set1_ps(scale);
+    const __m256 hi = _mm256_set1_ps(max);
+    const __m256 lo = _mm256_set1_ps(-scale);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8){
+        __m256 v = _mm256_mul_ps(_mm256_loadu_ps(x + i), vs);
+        if (dither)
+            v = _mm256_add_ps(v, _mm256_loadu_ps(dither + i));
+        v = _mm256_max_ps(_mm256_min_ps(v, hi), lo);
+        _mm256_storeu_si256((__m256i *)(out + i), _mm256_cvtps_epi32(v));
+    }
+    quantize_from_sse2(x, dither, out, i, n, scale, max);
+}
+
+AVX2 static void gain_ramp_avx2(SAMPLE *x, size_t frames, int channels, float g0, float dg){
+    static const float offsets[3][8] = {
+        { 0, 1, 2, 3, 4, 5, 6, 7 }, { 0, 0, 1, 1, 2, 2, 3, 3 }, { 0, 0, 0, 0, 1, 1, 1, 1 },
+    };
+    const __m256 vg0 = _mm256_set1_ps(g0), vdg = _mm256_set1_ps(dg);
+    size_t f = 0;
+    if (channels == 1 || channels == 2 || channels == 4){
+        const size_t per = (size_t)(8 / channels);
+        const __m256 off = _mm256_loadu_ps(offsets[channels == 4 ? 2 : channels - 1]);
+        for (; f + per <= frames; f += per){
+            __m256 idx = _mm256_add_ps(_mm256_set1_ps((float)f), off);
+            __m256 g = _mm256_add_ps(vg0, _mm256_mul_ps(vdg, idx));
+            SAMPLE *p = x + f * channels;
+            _mm256_storeu_ps(p, _mm256_mul_ps(_mm256_loadu_ps(p), g));
+        }
+    } else if (channels >= 8){
+        for (; f < frames; f++){
+            float gs = g0 + dg * (float)f;
+            __m256 g = _mm256_set1_ps(gs);
+            SAMPLE *p = x + f * channels;
+            int c = 0;
+            for (; c + 8 <= channels; c += 8)
+                _mm256_storeu_ps(p + c, _mm256_mul_ps(_mm256_loadu_ps(p + c), g));
+            for (; c < channels; c++)
+                p[c] *= gs;
+        }
+    } else {
+        gain_ramp_sse2(x, frames, channels, g0, dg);
+        return;
+    }
+    gain_ramp_from_scalar(x, f, frames, channels, g0, dg);
+}
+
+// two accumulators, 16 outputs per pass, hide the add latency
+AVX2 static void fir_avx2(const float *x, float *y, size_t n, const float *c, size_t taps){
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16){
+        __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps();
+        for (size_t k = 0; k < taps; k++){
+            __m256 ck = _mm256_broadcast_ss(c + k);
+            a0 = _mm256_add_ps(a0, _mm256_mul_ps(ck, _mm256_loadu_ps(x + i + k)));
+            a1 = _mm256_add_ps(a1, _mm256_mul_ps(ck, _mm256_loadu_ps(x + i + 8 + k)));
+        }
+        _mm256_storeu_ps(y + i, a0);
+        _mm256_storeu_ps(y + i + 8, a1);
+    }
+    for (; i + 8 <= n; i += 8){
+        __m256 acc = _mm256_setzero_ps();
+        for (size_t k = 0; k < taps; k++)
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_broadcast_ss(c + k),
+                                                   _mm256_loadu_ps(x + i + k)));
+        _mm256_storeu_ps(y + i, acc);
+    }
+    fir_from_scalar(x, y, i, n, c, taps);
+}
+
+AVX2 static inline float fold_avx2(__m256 a){
+    return fold_sse2(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+}
+
+// four outputs per pass, each in its own register, hide the add latency
+AVX2 static void poly_fir_avx2(const float *x, const size_t *at, const float *const *c,
+                               float *y, size_t n, size_t taps){
+    size_t j = 0;
+    for (; j + 4 <= n; j += 4){
+        const float *c0 = c[j], *c1 = c[j + 1], *c2 = c[j + 2], *c3 = c[j + 3];
+        const float *x0 = x + at[j], *x1 = x + at[j + 1];
+        const float *x2 = x + at[j + 2], *x3 = x + at[j + 3];
+        __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps();
+        __m256 a2 = _mm256_setzero_ps(), a3 = _mm256_setzero_ps();
+        for (size_t k = 0; k < taps; k += 8){
+            a0 = _mm256_add_ps(a0, _mm256_mul_ps(_mm256_loadu_ps(c0 + k), _mm256_loadu_ps(x0 + k)));
+            a1 = _mm256_add_ps(a1, _mm256_mul_ps(_mm256_loadu_ps(c1 + k), _mm256_loadu_ps(x1 + k)));
+            a2 = _mm256_add_ps(a2, _mm256_mul_ps(_mm256_loadu_ps(c2 + k), _mm256_loadu_ps(x2 + k)));
+            a3 = _mm256_add_ps(a3, _mm256_mul_ps(_mm256_loadu_ps(c3 + k), _mm256_loadu_ps(x3 + k)));
+        }
+        y[j] = fold_avx2(a0);
+        y[j + 1] = fold_avx2(a1);
+        y[j + 2] = fold_avx2(a2);
+        y[j + 3] = fold_avx2(a3);
+    }
+    poly_fir_sse2(x, at + j, c + j, y + j, n - j, taps);
+}
+
+// shuffles are bound by loads and stores, the SSE2 versions are as fast
+static const dsp_kernels_t kernels_avx2 = {
+    "avx2", gain_avx2, invert_avx2, hard_clip_avx2, soft_clip_avx2, biquad_avx2,
+    deinterleave_sse2, interleave_sse2, quantize_avx2, gain_ramp_avx2,
+    fir_avx2, poly_fir_avx2
+};
+
+#endif // KERNELS_X86
+
+#ifdef KERNELS_NEON
+
+static void gain_neon(SAMPLE *x, size_t n, float g){
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        vst1q_f32(x + i, vmulq_n_f32(vld1q_f32(x + i), g));
+    gain_scalar(x + i, n - i, g);
+}
+
+static void invert_neon(SAMPLE *x, size_t n){
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        vst1q_f32(x + i, vnegq_f32(vld1q_f32(x + i)));
+    invert_scalar(x + i, n - i);
+}
+
+static void hard_clip_neon(SAMPLE *x, size_t n, float g){
+    const float32x4_t hi = vdupq_n_f32(SAMPLE_MAX_VALUE);
+    const float32x4_t lo = vdupq_n_f32(SAMPLE_MIN_VALUE);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4){
+        float32x4_t s = vmulq_n_f32(vld1q_f32(x + i), g);
+        vst1q_f32(x + i, vminq_f32(vmaxq_f32(s, lo), hi));
+    }
+    hard_clip_scalar(x + i, n - i, g);
+}
+
+static void soft_clip_neon(SAMPLE *x, size_t n, float g){
+    const float32x4_t hi = vdupq_n_f32(SAMPLE_MAX_VALUE);
+    const float32x4_t lo = vdupq_n_f32(SAMPLE_MIN_VALUE);
+    const float32x4_t three = vdupq_n_f32(3.0f);
+    const float32x4_t bhi = vdupq_n_f32(SOFTCLIP_BORDER);
+    const float32x4_t blo = vdupq_n_f32(-SOFTCLIP_BORDER);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4){
+        float32x4_t s = vmulq_n_f32(vld1q_f32(x + i), g);
+        float32x4_t cube = vmulq_f32(vmulq_f32(s, s), s);
+        float32x4_t y = vsubq_f32(s, vdivq_f32(cube, three));
+        y = vbslq_f32(vcgtq_f32(s, hi), bhi, y);
+        y = vbslq_f32(vcltq_f32(s, lo), blo, y);
+        vst1q_f32(x + i, y);
+    }
+    soft_clip_scalar(x + i, n - i, g);
+}
+
+static void biquad_neon(SAMPLE *x, size_t frames, int channels, const float c[5],
+                        float *z1, float *z2){
+    const float32x4_t b0 = vdupq_n_f32(c[0]), b1 = vdupq_n_f32(c[1]), b2 = vdupq_n_f32(c[2]);
+    const float32x4_t a1 = vdupq_n_f32(c[3]), a2 = vdupq_n_f32(c[4]);
+    int ch = 0;
+    for (; ch + 4 <= channels; ch += 4){
+        float32x4_t s1 = vld1q_f32(z1 + ch), s2 = vld1q_f32(z2 + ch);
+        for (size_t i = 0; i < frames; i++){
+            SAMPLE *p = x + i * channels + ch;
+            float32x4_t in = vld1q_f32(p);
+            // vmul + vadd, not vmla/vfma, to stay bit-exact with scalar; holds
+            // because contraction is off for this file (see the top)
+            float32x4_t y = vaddq_f32(vmulq_f32(b0, in), s1);
+            s1 = vaddq_f32(vsubq_f32(vmulq_f32(b1, in), vmulq_f32(a1, y)), s2);
+            s2 = vsubq_f32(vmulq_f32(b2, in), vmulq_f32(a2, y));
+            vst1q_f32(p, y);
+        }
+        vst1q_f32(z1 + ch, s1);
+        vst1q_f32(z2 + ch, s2);
+    }
+    biquad_lanes_scalar(x, frames, channels, ch, c, z1, z2);
+}
+
+static void deinterleave_neon(const SAMPLE *in, SAMPLE *const *out, size_t frames, int channels){
+    size_t i = 0;
+    if (channels == 2){
+        for (; i + 4 <= frames; i += 4){
+            float32x4x2_t v = vld2q_f32(in + 2 * i);
+            vst1q_f32(out[0] + i, v.val[0]);
+            vst1q_f32(out[1] + i, v.val[1]);
+        }
+    } else if (channels == 4){
+        for (; i + 4 <= frames; i += 4){
+            float32x4x4_t v = vld4q_f32(in + 4 * i);
+            for (int c = 0; c < 4; c++)
+                vst1q_f32(out[c] + i, v.val[c]);
+        }
+    }
+    deinterleave_from_scalar(in, out, i, frames, channels);
+}
+
+static void interleave_neon(const SAMPLE *const *in, SAMPLE *out, size_t frames, int channels){
+    size_t i = 0;
+    if (channels == 2){
+        for (; i + 4 <= frames; i += 4){
+            float32x4x2_t v = { { vld1q_f32(in[0] + i), vld1q_f32(in[1] + i) } };
+            vst2q_f32(out + 2 * i, v);
+        }
+    } else if (channels == 4){
+        for (; i + 4 <= frames; i += 4){
+            float32x4x4_t v = { { vld1q_f32(in[0] + i), vld1q_f32(in[1] + i),
+                                  vld1q_f32(in[2] + i), vld1q_f32(in[3] + i) } };
+            vst4q_f32(out + 4 * i, v);
+        }
+    }
+    interleave_from_scalar(in, out, i, frames, channels);
+}
+
+// vminq/vmaxq propagate NaN, compare + select keeps the scalar semantics
+static void quantize_neon(const SAMPLE *x, const float *dither, int32_t *out, size_t n,
+                          float scale, float max){
+    const float32x4_t vs = vdupq_n_f32(scale);
+    const float32x4_t hi = vdupq_n_f32(max);
+    const float32x4_t lo = vdupq_n_f32(-scale);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4){
+        float32x4_t v = vmulq_f32(vld1q_f32(x + i), vs);
+        if (dither)
+            v = vaddq_f32(v, vld1q_f32(dither + i));
+        v = vbslq_f32(vcltq_f32(v, hi), v, hi);
+        v = vbslq_f32(vcgtq_f32(v, lo), v, lo);
+        vst1q_s32(out + i, vcvtnq_s32_f32(v));
+    }
+    quantize_from_scalar(x, dither, out, i, n, scale, max);
+}
+
+static void gain_ramp_neon(SAMPLE *x, size_t frames, int channels, float g0, float dg){
+    static const float offsets[2][4] = { { 0, 1, 2, 3 }, { 0, 0, 1, 1 } };
+    const float32x4_t vg0 = vdupq_n_f32(g0);
+    size_t f = 0;
+    if (channels <= 2){
+        const size_t per = (size_t)(4 / channels);
+        const float32x4_t off = vld1q_f32(offsets[channels - 1]);
+        for (; f + per <= frames; f += per){
+            float32x4_t idx = vaddq_f32(vdupq_n_f32((float)f), off);
+            // vmul + vadd, not vfma, like the scalar loop (no contraction here)
+            float32x4_t g = vaddq_f32(vg0, vmulq_n_f32(idx, dg));
+            SAMPLE *p = x + f * channels;
+            vst1q_f32(p, vmulq_f32(vld1q_f32(p), g));
+        }
+    } else if (channels >= 4){
+        for (; f < frames; f++){
+            float gs = g0 + dg * (float)f;
+            SAMPLE *p = x + f * channels;
+            int c = 0;
+            for (; c + 4 <= channels; c += 4)
+                vst1q_f32(p + c, vmulq_n_f32(vld1q_f32(p + c), gs));
+            for (; c < channels; c++)
+                p[c] *= gs;
+        }
+    }
+    gain_ramp_from_scalar(x, f, frames, channels, g0, dg);
+}
+
+static void fir_neon(const float *x, float *y, size_t n, const float *c, size_t taps){
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4){
+        float32x4_t acc = vdupq_n_f32(0.0f);
+        for (size_t k = 0; k < taps; k++)
+            acc = vaddq_f32(acc, vmulq_n_f32(vld1q_f32(x + i + k), c[k]));
+        vst1q_f32(y + i, acc);
+    }
+    fir_from_scalar(x, y, i, n, c, taps);
+}
+
+static void poly_fir_neon(const float *x, const size_t *at, const float *const *c,
+                          float *y, size_t n, size_t taps){
+    for (size_t j = 0; j < n; j++){
+        const float *cj = c[j], *xj = x + at[j];
+        float32x4_t lo = vdupq_n_f32(0.0f), hi = vdupq_n_f32(0.0f);
+        for (size_t k = 0; k < taps; k += 8){
+            lo = vaddq_f32(lo, vmulq_f32(vld1q_f32(cj + k), vld1q_f32(xj + k)));
+            hi = vaddq_f32(hi, vmulq_f32(vld1q_f32(cj + k + 4), vld1q_f32(xj + k + 4)));
+        }
+        float32x4_t t = vaddq_f32(lo, hi);
+        float32x2_t u = vadd_f32(vget_low_f32(t), vget_high_f32(t));
+        y[j] = vget_lane_f32(u, 0) + vget_lane_f32(u, 1);
+    }
+}
+
+static const dsp_kernels_t kernels_neon = {
+    "neon", gain_neon, invert_neon, hard_clip_neon, soft_clip_neon, biquad_neon,
+    deinterleave_neon, interleave_neon, quantize_neon, gain_ramp_neon,
+    fir_neon, poly_fir_neon
+};
+
+#endif // KERNELS_NEON
+
+size_t dsp_kernels_available(const dsp_kernels_t **out, size_t max){
+    size_t n = 0;
+    if (n < max) out[n++] = &kernels_scalar;
+#ifdef KERNELS_X86
+    if (n < max) out[n++] = &kernels_sse2;
+    if (n < max && __builtin_cpu_supports("avx2")) out[n++] = &kernels_avx2;
+#endif
+#ifdef KERNELS_NEON
+    if (n < max) out[n++] = &kernels_neon;
+#endif
+    return n;
+}
+
+static _Atomic(const dsp_kernels_t *) active;
+
+const dsp_kernels_t *dsp_kernels(void){
+    const dsp_kernels_t *k = atomic_load_explicit(&active, memory_order_acquire);
+    if (k)
+        return k;
+
+    // last entry is the widest one the CPU supports
+    const dsp_kernels_t *sets[4];
+    size_t n = dsp_kernels_available(sets, 4);
+    k = sets[n - 1];
+    atomic_store_explicit(&active, k, memory_order_release);
+    return k;
+}
+
+int dsp_kernels_select(const char *name){
+    const dsp_kernels_t *sets[4];
+    size_t n = dsp_kernels_available(sets, 4);
+    for (size_t i = 0; i < n; i++){
+        if (strcmp(sets[i]->name, name) == 0){
+            atomic_store(&active, sets[i]);
+            return 0;
+        }
+    }
+    return -1;
+}
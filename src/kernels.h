@@ -0,0 +1,50 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "audio_types.h"
+
+/* inner loops of the built-in effects. every set must be bit-exact with
+ * kernels_scalar, which is the reference implementation */
+typedef struct dsp_kernels_t{
+    const char *name;
+    void (*gain)(SAMPLE *x, size_t n, float g);
+    void (*invert)(SAMPLE *x, size_t n);
+    void (*hard_clip)(SAMPLE *x, size_t n, float g);
+    void (*soft_clip)(SAMPLE *x, size_t n, float g);
+    // one second-order section (b0 b1 b2 a1 a2, transposed direct form II)
+    // over interleaved frames, channels run in parallel lanes
+    void (*biquad)(SAMPLE *x, size_t frames, int channels, const float c[5],
+                   float *z1, float *z2);
+    // interleaved frames <-> one contiguous buffer per channel
+    void (*deinterleave)(const SAMPLE *in, SAMPLE *const *out, size_t frames, int channels);
+    void (*interleave)(const SAMPLE *const *in, SAMPLE *out, size_t frames, int channels);
+    // out = round_even(clamp(x * scale + dither, -scale, max)), for integer
+    // PCM. dither (in LSB) may be NULL, NaN comes out as max
+    void (*quantize)(const SAMPLE *x, const float *dither, int32_t *out, size_t n,
+                     float scale, float max);
+    // x[f * channels + c] *= g0 + dg * f: one linear gain ramp over
+    // interleaved frames, dg is the step per frame
+    void (*gain_ramp)(SAMPLE *x, size_t frames, int channels, float g0, float dg);
+    // y[i] = sum c[k] * x[i + k], k = 0..taps-1 in order: FIR over one
+    // channel, x holds taps - 1 samples of history before the n new ones
+    void (*fir)(const float *x, float *y, size_t n, const float *c, size_t taps);
+    // y[j] = sum c[j][k] * x[at[j] + k]: one coefficient row per output, for
+    // polyphase resampling. taps is a multiple of 8; tap k goes to partial
+    // sum k % 8 and the sums fold like one 8-lane register,
+    // ((s0 + s4) + (s2 + s6)) + ((s1 + s5) + (s3 + s7))
+    void (*poly_fir)(const float *x, const size_t *at, const float *const *c,
+                     float *y, size_t n, size_t taps);
+} dsp_kernels_t;
+
+extern const dsp_kernels_t kernels_scalar;
+
+// best set for this CPU, detected on first use
+const dsp_kernels_t *dsp_kernels(void);
+
+// sets usable on this CPU, scalar first. returns count
+size_t dsp_kernels_available(const dsp_kernels_t **out, size_t max);
+int dsp_kernels_select(const char *name);
+
+#endif
@@ -7,6 +7,7 @@
 
 #include <unistd.h>
 #include <signal.h>
+#include <time.h>
 
 #include "app.h"
 #include "audio_io.h"
@@ -16,6 +17,10 @@
 #include "command.h"
 #include "effect.h"
 #include "audio_io.h"
+#include "offline.h"
+#include "batch.h"
+#include "overview.h"
+#include "convolver.h"
 
 #define BUFSIZE (8192)
 
@@ -25,7 +30,10 @@ char *lineprompt;
 static volatile sig_atomic_t g_sigint = 0;
 
 void free_app(){
+    for (int i = 0; i < 2; i++)
+        arena_free(&audio_cb_ctx->state_arena[i]);
     free(audio_cb_ctx);
+    convolver_ir_free();
 }
 
 static float clamp01(float x) {
@@ -60,24 +68,130 @@ static float clamp01(float x) {
 //     fflush(stdout);
 // }
 
-void print_record_meter(const meter_t *m) {
+void print_record_meter(void) {
     const int width = 50;
-    const float gain = 30.0f;
-
-    float peak = atomic_load(&m->peak);
-    peak = clamp01(peak * gain);
-
-    int filled = (int)lroundf(peak * width);
-    if (filled < 0) filled = 0;
-    if (filled > width) filled = width;
+    static const char levels[] = " .:-=+*#%@";
+
+    meter_reading_t r;
+    if (audio_io_meter_read(&r) < 0)
+        memset(&r, 0, sizeof r);
+
+    // bar and level characters span -60..0 dBFS
+    float peak = 0.0f;
+    char chans[MAX_CHANNELS + 1];
+    for (int c = 0; c < r.channels; c++) {
+        if (r.peak[c] > peak) peak = r.peak[c];
+        float v = clamp01((meter_db(r.peak[c]) + 60.0f) / 60.0f);
+        chans[c] = levels[(int)(v * (sizeof(levels) - 2) + 0.5f)];
+    }
+    chans[r.channels] = '\0';
 
+    int filled = (int)lroundf(clamp01((meter_db(peak) + 60.0f) / 60.0f) * width);
     char bar[width + 1];
     for (int i = 0; i < width; ++i)
         bar[i] = (i < filled) ? '#' : ' ';
     bar[width] = '\0';
 
-    printf("\rREC peak=%0.2f |%s| cntrl + c to stop", peak, bar);
+    recorder_stats_t st;
+    if (audio_io_record_stats(&st) < 0){
+        printf("\rREC %6.1f dB |%s| [%s] M %6.1f LUFS cntrl + c to stop",
+               meter_db(peak), bar, chans, r.momentary);
+    } else {
+        int fill = st.capacity_frames ? (int)(100 * st.fill_frames / st.capacity_frames) : 0;
+        printf("\rREC %6.1f dB |%s| [%s] M %6.1f LUFS buf %3d%% xrun %lu cntrl + c to stop",
+               meter_db(peak), bar, chans, r.momentary, fill, st.overruns);
+    }
+    fflush(stdout);
+}
+
+static void print_meter(void) {
+    static int drawn;
+    meter_reading_t r;
+    if (!meter_view) {
+        drawn = 0;
+        return;
+    }
+    if (audio_io_meter_read(&r) == 0)
+        meter_render(&r, stdout, &drawn);
+}
+
+static void print_spectrum(spectrum_t *s){
+    static unsigned long last_seq;
+    if (spectrum_view == SPECTRUM_VIEW_GRAM){
+        while (spectrum_render_gram(s, stdout, 72, &last_seq))
+            ;
+    } else {
+        spectrum_render_bars(s, stdout, 64, 16);
+    }
+}
+
+// wavecli repair FILE...: sizes of recordings cut short by a crash
+static int repair_files(int argc, char *argv[]){
+    if (argc < 1){
+        fprintf(stderr, "usage: %s repair FILE.wav...\n", progname);
+        return -1;
+    }
+    int rc = 0;
+    for (int i = 0; i < argc; i++){
+        size_t frames, old_frames;
+        if (wav_repair(argv[i], &frames, &old_frames) < 0){
+            rc = -1;
+            continue;
+        }
+        printf("%s: %zu frames (header said %zu)\n", argv[i], frames, old_frames);
+    }
+    return rc;
+}
+
+void init_signals(struct sigaction *sigact);
+
+/* wavecli tapcat [POINT]: the raw float32 frames of one tap point of a
+ * running wavecli, read in place from the shared ring, until ctrl + c */
+static int tapcat(int argc, char *argv[]){
+    uint32_t mask = 0;
+    if (argc > 1 || tap_point_parse(argc ? argv[0] : "out", &mask) < 0
+            || (mask & (mask - 1))){
+        fprintf(stderr, "usage: %s tapcat [in|out|STAGE] > FILE.raw\n", progname);
+        return -1;
+    }
+    tap_reader_t r;
+    if (tap_reader_open(&r, TAP_SHM_NAME) < 0)
+        return -1;
+    struct sigaction sigact;
+    init_signals(&sigact);
+
+    const struct timespec idle = { 0, 2 * 1000 * 1000 };
+    unsigned long long blocks = 0, frames = 0, torn = 0;
+    uint64_t next_frame = 0;
+    int rc = 0;
+    while (!g_sigint){
+        const tap_block_t *b = tap_reader_next(&r);
+        if (!b){
+            nanosleep(&idle, NULL);
+            continue;
+        }
+        if (!(mask & TAP_POINT_BIT(b->point)))
+            continue;
+        if (blocks && b->frame != next_frame)
+            fprintf(stderr, "tapcat: gap of %lld frames at %llu\n",
+                    (long long)(b->frame - next_frame), (unsigned long long)b->frame);
+        size_t n = (size_t)b->frames * b->channels;
+        if (fwrite(b + 1, sizeof(float), n, stdout) != n){
+            perror("tapcat");
+            rc = -1;
+            break;
+        }
+        if (!tap_reader_valid(&r))
+            torn++;
+        next_frame = b->frame + b->frames;
+        blocks++;
+        frames += b->frames;
+    }
     fflush(stdout);
+    fprintf(stderr, "tapcat: %llu blocks, %llu frames, %llu torn, %llu bytes lost\n",
+            blocks, frames, torn, (unsigned long long)r.lost);
+    tap_reader_close(&r);
+    return rc;
 }
 
 static void signal_handler(int signum){
@@ -106,16 +220,69 @@ int main(int argc, char *argv[]){
     //initialize prompt in stdout
     sprintf(lineprompt, "%s> ", progname);
     
-    const int default_channels = 1;
-    if (init_audio_io(default_channels) < 0)
+    if (init_audio_cb_ctx() < 0)
         die("audio initialization failed\n");
 
     parse_opts(argc, argv);
 
+    // wavecli batch [opts] DIR|GLOB...: options may come before or after
+    if (optind < argc && strcmp(argv[optind], "batch") == 0){
+        int rc = batch_run(argc - optind - 1, argv + optind + 1, &offline_opts,
+                &audio_cb_ctx->audio_params);
+        free_app();
+        return rc < 0 ? 1 : 0;
+    }
+
+    if (optind < argc && strcmp(argv[optind], "peaks") == 0){
+        int rc = 0;
+        for (int i = optind + 1; i < argc; i++)
+            if (overview_build(argv[i]) < 0)
+                rc = -1;
+        free_app();
+        return rc < 0 ? 1 : 0;
+    }
+
+    if (optind < argc && strcmp(argv[optind], "tapcat") == 0){
+        int rc = tapcat(argc - optind - 1, argv + optind + 1);
+        free_app();
+        return rc < 0 ? 1 : 0;
+    }
+
+    if (optind < argc && strcmp(argv[optind], "repair") == 0){
+        int rc = repair_files(argc - optind - 1, argv + optind + 1);
+        free_app();
+        return rc < 0 ? 1 : 0;
+    }
+
+    // offline mode: no sound card, no TUI
+    if (offline_opts.in_path || offline_opts.out_path){
+        int rc = offline_run(&offline_opts, &audio_cb_ctx->audio_params);
+        free_app();
+        return rc < 0 ? 1 : 0;
+    }
+
+    // --effect outside offline mode seeds the live chain
+    if (offline_opts.chain_spec){
+        effect_chain_t *c = audio_io_chain_begin();
+        if (chain_parse(c, offline_opts.chain_spec, &audio_cb_ctx->audio_params,
+                    audio_io_state_arena()) < 0)
+            die("bad --effect chain");
+        audio_io_chain_commit();
+    }
+
+    // --record: armed before the first callback so nothing is missed
+    if (opt_record_path){
+        if (audio_io_open_record_file(opt_record_path, &opt_record) < 0)
+            die("cannot record to %s", opt_record_path);
+        set_record_flag();
+    }
+
     int channels = audio_cb_ctx->audio_params.channels;
+    if (init_audio_io(channels) < 0)
+        die("audio initialization failed\n");
 
     //starting choice 
-    if (select_input_device_cmd(0, NULL) < 0)
+    if (audio_io_has_devices() && select_input_device_cmd(0, NULL) < 0)
         return 1;
     
     char line[MAXLINESIZE];
@@ -129,6 +296,16 @@ int main(int argc, char *argv[]){
     for (;;){
         if (g_sigint) {
             g_sigint = 0;
+            if (audio_io_spectrum()) { // leave the spectrum view
+                printf("\n");
+                audio_io_spectrum_close();
+                continue;
+            }
+            if (meter_view) {
+                meter_view = 0;
+                print_meter();
+                continue;
+            }
             if (is_record()) { // stop recording 
                 stop_recording_cmd(0, NULL);
                 printf("\n");
@@ -136,9 +313,26 @@ int main(int argc, char *argv[]){
             }
             goto cleanup;
         }
+        // file backend reached the end of its input
+        if (audio_io_finished()) {
+            audio_io_spectrum_close();
+            if (is_record())
+                stop_recording_cmd(0, NULL);
+            goto cleanup;
+        }
+        if (audio_io_spectrum()) {
+            print_spectrum(audio_io_spectrum());
+            usleep(50 * 1000);
+            continue;
+        }
+        if (meter_view) {
+            print_meter();
+            usleep(100 * 1000);
+            continue;
+        }
         //when record
         if (is_record()) {
-            print_record_meter(&audio_cb_ctx->metrics);
+            print_record_meter();
             usleep(50 * 1000);
             continue;
         }
@@ -0,0 +1,341 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "meter.h"
+#include "kernels.h"
+#include "ringbuf.h"
+
+#define METER_IDLE_NS (5 * 1000 * 1000)
+
+float meter_db(float amplitude){
+    return amplitude > 1e-6f ? 20.0f * log10f(amplitude) : METER_FLOOR_DB;
+}
+
+static float lufs(double energy){
+    return energy > 0.0 ? (float)(-0.691 + 10.0 * log10(energy)) : METER_FLOOR_DB;
+}
+
+/* BS.1770 K-weighting for any rate: the 48 kHz reference filters
+ * re-derived through the bilinear transform */
+static void design_k_weighting(float c[2][5], double fs){
+    double f0 = 1681.974450955533, g = 3.999843853973347, q = 0.7071752369554196;
+    double k = tan(M_PI * f0 / fs);
+    double vh = pow(10.0, g / 20.0);
+    double vb = pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    c[0][0] = (float)((vh + vb * k / q + k * k) / a0);
+    c[0][1] = (float)(2.0 * (k * k - vh) / a0);
+    c[0][2] = (float)((vh - vb * k / q + k * k) / a0);
+    c[0][3] = (float)(2.0 * (k * k - 1.0) / a0);
+    c[0][4] = (float)((1.0 - k / q + k * k) / a0);
+
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = tan(M_PI * f0 / fs);
+    a0 = 1.0 + k / q + k * k;
+    c[1][0] = 1.0f;
+    c[1][1] = -2.0f;
+    c[1][2] = 1.0f;
+    c[1][3] = (float)(2.0 * (k * k - 1.0) / a0);
+    c[1][4] = (float)((1.0 - k / q + k * k) / a0);
+}
+
+/* windowed-sinc interpolator, one phase per output position between two
+ * input samples, each phase normalized to unity gain */
+static void design_true_peak(float coef[METER_TP_PHASES][METER_TP_TAPS]){
+    const int len = METER_TP_PHASES * METER_TP_TAPS;
+    const double center = (len - 1) / 2.0;
+    for (int p = 0; p < METER_TP_PHASES; p++){
+        double sum = 0.0;
+        for (int k = 0; k < METER_TP_TAPS; k++){
+            int i = k * METER_TP_PHASES + p;
+            double t = (i - center) / METER_TP_PHASES;
+            double sinc = t == 0.0 ? 1.0 : sin(M_PI * t) / (M_PI * t);
+            double w = 0.5 - 0.5 * cos(2.0 * M_PI * (i + 0.5) / len);
+            coef[p][k] = (float)(sinc * w);
+            sum += coef[p][k];
+        }
+        for (int k = 0; k < METER_TP_TAPS; k++)
+            coef[p][k] = (float)(coef[p][k] / sum);
+    }
+}
+
+static void reset_state(meter_t *m){
+    memset(m->kz1, 0, sizeof m->kz1);
+    memset(m->kz2, 0, sizeof m->kz2);
+    memset(m->tp_hist, 0, sizeof m->tp_hist);
+    memset(m->ms, 0, sizeof m->ms);
+    memset(m->hold_age, 0, sizeof m->hold_age);
+    memset(m->subs, 0, sizeof m->subs);
+    memset(m->hist_count, 0, sizeof m->hist_count);
+    memset(m->hist_energy, 0, sizeof m->hist_energy);
+    m->sub_energy = 0.0;
+    m->sub_frames = 0;
+    m->sub_pos = m->sub_count = 0;
+
+    pthread_mutex_lock(&m->lock);
+    memset(&m->out, 0, sizeof m->out);
+    m->out.channels = m->channels;
+    m->out.momentary = m->out.short_term = m->out.integrated = METER_FLOOR_DB;
+    pthread_mutex_unlock(&m->lock);
+}
+
+static double mean_subs(const meter_t *m, int count){
+    double e = 0.0;
+    for (int i = 1; i <= count; i++)
+        e += m->subs[(m->sub_pos - i + METER_SHORT_SUBS) % METER_SHORT_SUBS];
+    return e / count;
+}
+
+static float integrated(const meter_t *m){
+    unsigned long n = 0;
+    double e = 0.0;
+    for (int b = 0; b < METER_HIST_BINS; b++){
+        n += m->hist_count[b];
+        e += m->hist_energy[b];
+    }
+    if (n == 0)
+        return METER_FLOOR_DB;
+
+    // relative gate 10 LU under the absolute-gated mean
+    double gate = lufs(e / n) - 10.0;
+    int first = (int)((gate - METER_HIST_MIN_LUFS) / METER_HIST_STEP);
+    if (first < 0)
+        first = 0;
+    n = 0;
+    e = 0.0;
+    for (int b = first; b < METER_HIST_BINS; b++){
+        n += m->hist_count[b];
+        e += m->hist_energy[b];
+    }
+    return n ? lufs(e / n) : METER_FLOOR_DB;
+}
+
+/* one 100 ms step: momentary/short-term, and a 400 ms gating block every
+ * step (75% overlap) */
+static void close_subblock(meter_t *m, meter_reading_t *r){
+    m->subs[m->sub_pos] = m->sub_energy / (double)m->sub_len;
+    m->sub_pos = (m->sub_pos + 1) % METER_SHORT_SUBS;
+    if (m->sub_count < METER_SHORT_SUBS)
+        m->sub_count++;
+    m->sub_energy = 0.0;
+    m->sub_frames = 0;
+
+    if (m->sub_count >= METER_MOMENTARY_SUBS){
+        double e = mean_subs(m, METER_MOMENTARY_SUBS);
+        r->momentary = lufs(e);
+        int b = (int)((r->momentary - METER_HIST_MIN_LUFS) / METER_HIST_STEP);
+        if (r->momentary > METER_HIST_MIN_LUFS && b >= 0){
+            if (b >= METER_HIST_BINS)
+                b = METER_HIST_BINS - 1;
+            m->hist_count[b]++;
+            m->hist_energy[b] += e;
+        }
+        r->integrated = integrated(m);
+    }
+    if (m->sub_count >= METER_SHORT_SUBS)
+        r->short_term = lufs(mean_subs(m, METER_SHORT_SUBS));
+}
+
+static void analyze(meter_t *m, const float *x, size_t n, meter_reading_t *r){
+    const int ch = m->channels;
+    const float fall = powf(10.0f, -METER_FALL_DB_SEC * (float)n / m->sample_rate / 20.0f);
+    const int hold_frames = (int)(METER_HOLD_SEC * m->sample_rate);
+
+    for (int c = 0; c < ch; c++){
+        float peak = 0.0f, tp = r->true_peak[c], ms = m->ms[c];
+        float *h = m->tp_hist[c];
+        for (size_t i = 0; i < n; i++){
+            float v = x[i * ch + c];
+            float a = fabsf(v);
+            if (a > peak) peak = a;
+            ms += m->rms_alpha * (v * v - ms);
+
+            memmove(h + 1, h, sizeof(float) * (METER_TP_TAPS - 1));
+            h[0] = v;
+            for (int p = 0; p < METER_TP_PHASES; p++){
+                float y = 0.0f;
+                for (int k = 0; k < METER_TP_TAPS; k++)
+                    y += m->tp_coef[p][k] * h[k];
+                if (fabsf(y) > tp) tp = fabsf(y);
+            }
+        }
+        if (peak > tp) tp = peak;
+        m->ms[c] = ms;
+        r->rms[c] = sqrtf(ms);
+        r->true_peak[c] = tp;
+
+        float p = r->peak[c] * fall;
+        r->peak[c] = peak > p ? peak : p;
+        m->hold_age[c] += (int)n;
+        if (peak >= r->peak_hold[c] || m->hold_age[c] > hold_frames){
+            r->peak_hold[c] = peak > r->peak[c] ? peak : r->peak[c];
+            m->hold_age[c] = 0;
+        }
+    }
+
+    // loudness: K-weight a copy, channels in parallel lanes
+    const dsp_kernels_t *k = dsp_kernels();
+    memcpy(m->kbuf, x, sizeof(float) * n * ch);
+    k->biquad(m->kbuf, n, ch, m->kc[0], m->kz1[0], m->kz2[0]);
+    k->biquad(m->kbuf, n, ch, m->kc[1], m->kz1[1], m->kz2[1]);
+    for (int c = 0; c < ch; c++){
+        if (m->weight[c] == 0.0f)
+            continue;
+        double e = 0.0;
+        for (size_t i = 0; i < n; i++){
+            float y = m->kbuf[i * ch + c];
+            e += (double)y * y;
+        }
+        m->sub_energy += m->weight[c] * e;
+    }
+    m->sub_frames += n;
+    if (m->sub_frames == m->sub_len)
+        close_subblock(m, r);
+
+    r->frames += n;
+}
+
+static void *meter_thread(void *arg){
+    meter_t *m = arg;
+    const struct timespec idle = { 0, METER_IDLE_NS };
+    const size_t frame_bytes = sizeof(SAMPLE) * m->channels;
+    meter_reading_t r;
+
+    meter_read(m, &r);
+    while (atomic_load_explicit(&m->running, memory_order_acquire)){
+        if (atomic_exchange(&m->reset_req, 0)){
+            reset_state(m);
+            meter_read(m, &r);
+        }
+
+        size_t frames = ringbuf_read_space(&m->tap) / frame_bytes;
+        if (frames == 0){
+            nanosleep(&idle, NULL);
+            continue;
+        }
+
+        // never across a 100 ms boundary, the loudness steps stay exact
+        size_t left = m->sub_len - m->sub_frames;
+        if (frames > left) frames = left;
+        if (frames > m->block_frames) frames = m->block_frames;
+        ringbuf_pop(&m->tap, m->block, frames * frame_bytes);
+        analyze(m, m->block, frames, &r);
+
+        r.overruns = atomic_load_explicit(&m->tap.overruns, memory_order_relaxed);
+        pthread_mutex_lock(&m->lock);
+        m->out = r;
+        pthread_mutex_unlock(&m->lock);
+    }
+    return NULL;
+}
+
+meter_t *meter_open(int sample_rate, int channels){
+    meter_t *m = calloc(1, sizeof(meter_t));
+    if (!m){
+        perror("meter_open");
+        return NULL;
+    }
+
+    m->sample_rate = sample_rate;
+    m->channels = channels;
+    m->sub_len = (size_t)(METER_SUBBLOCK_SEC * sample_rate);
+    m->block_frames = 1024;
+    m->rms_alpha = 1.0f - expf(-1.0f / (float)(METER_RMS_SEC * sample_rate));
+    design_k_weighting(m->kc, sample_rate);
+    design_true_peak(m->tp_coef);
+
+    // BS.1770: LFE is left out, surrounds count 1.41 in a 5.1 layout
+    for (int c = 0; c < channels; c++)
+        m->weight[c] = 1.0f;
+    if (channels == 6){
+        m->weight[3] = 0.0f;
+        m->weight[4] = m->weight[5] = 1.41f;
+    }
+
+    m->block = malloc(sizeof(float) * m->block_frames * channels);
+    m->kbuf = malloc(sizeof(float) * m->block_frames * channels);
+    if (!m->block || !m->kbuf){
+        perror("meter_open");
+        goto err;
+    }
+    if (ringbuf_init(&m->tap, (size_t)METER_TAP_SEC * sample_rate * channels * sizeof(SAMPLE)) < 0)
+        goto err;
+
+    pthread_mutex_init(&m->lock, NULL);
+    reset_state(m);
+    atomic_store(&m->running, 1);
+    if (pthread_create(&m->thread, NULL, meter_thread, m) != 0){
+        perror("meter_open: pthread_create");
+        pthread_mutex_destroy(&m->lock);
+        ringbuf_free(&m->tap);
+        goto err;
+    }
+    return m;
+
+err:
+    free(m->block);
+    free(m->kbuf);
+    free(m);
+    return NULL;
+}
+
+/* called from the audio callback: copy only, a full tap drops the block */
+int meter_push(meter_t *m, const SAMPLE *frames, unsigned long frameCount){
+    size_t bytes = (size_t)frameCount * m->channels * sizeof(SAMPLE);
+    return ringbuf_push(&m->tap, frames, bytes) == bytes ? 0 : -1;
+}
+
+void meter_read(meter_t *m, meter_reading_t *r){
+    pthread_mutex_lock(&m->lock);
+    *r = m->out;
+    pthread_mutex_unlock(&m->lock);
+}
+
+/* integrated loudness, true peak and holds start over */
+void meter_reset(meter_t *m){
+    atomic_store(&m->reset_req, 1);
+}
+
+void meter_close(meter_t *m){
+    if (!m)
+        return;
+    atomic_store_explicit(&m->running, 0, memory_order_release);
+    pthread_join(m->thread, NULL);
+    pthread_mutex_destroy(&m->lock);
+    ringbuf_free(&m->tap);
+    free(m->block);
+    free(m->kbuf);
+    free(m);
+}
+
+static void bar(FILE *out, float db, int width){
+    int filled = (int)((db + 60.0f) / 60.0f * width + 0.5f);
+    fputc('|', out);
+    for (int i = 0; i < width; i++)
+        fputc(i < filled ? '#' : ' ', out);
+    fputc('|', out);
+}
+
+void meter_render(const meter_reading_t *r, FILE *out, int *drawn){
+    if (*drawn)
+        fprintf(out, "\033[%dA", r->channels + 2);
+    *drawn = 1;
+
+    for (int c = 0; c < r->channels; c++){
+        fprintf(out, "ch%-2d ", c);
+        bar(out, meter_db(r->peak[c]), 30);
+        fprintf(out, " peak %6.1f hold %6.1f rms %6.1f tp %6.1f dB\033[K\n",
+                meter_db(r->peak[c]), meter_db(r->peak_hold[c]),
+                meter_db(r->rms[c]), meter_db(r->true_peak[c]));
+    }
+    fprintf(out, "M %6.1f  S %6.1f  I %6.1f LUFS   tap overruns %lu\033[K\n",
+            r->momentary, r->short_term, r->integrated, r->overruns);
+    fprintf(out, "meter reset: restart I and tp, cntrl + c to stop\033[K\n");
+    fflush(out);
+}
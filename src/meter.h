@@ -0,0 +1,85 @@
+#ifndef METER_H
+#define METER_H
+
+#include <stdio.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "audio_types.h"
+#include "ringbuf.h"
+
+#define METER_TAP_SEC        (1)
+#define METER_SUBBLOCK_SEC   (0.1)    // loudness bookkeeping step
+#define METER_MOMENTARY_SUBS (4)      // 400 ms
+#define METER_SHORT_SUBS     (30)     // 3 s
+#define METER_RMS_SEC        (0.3)
+#define METER_HOLD_SEC       (2.0)
+#define METER_FALL_DB_SEC    (20.0)   // peak meter release
+#define METER_TP_PHASES      (4)      // true peak oversampling
+#define METER_TP_TAPS        (12)     // per phase
+#define METER_FLOOR_DB       (-120.0f)
+#define METER_HIST_MIN_LUFS  (-70.0)  // absolute gate
+#define METER_HIST_STEP      (0.1)
+#define METER_HIST_BINS      (800)    // -70 .. +10 LUFS
+
+// what the UI sees, linear amplitudes and LUFS
+typedef struct meter_reading_t{
+    int channels;
+    float peak[MAX_CHANNELS];       // sample peak with release
+    float peak_hold[MAX_CHANNELS];  // held for METER_HOLD_SEC
+    float rms[MAX_CHANNELS];
+    float true_peak[MAX_CHANNELS];  // 4x oversampled, max since reset
+    float momentary;
+    float short_term;
+    float integrated;               // gated, since reset
+    unsigned long long frames;
+    unsigned long overruns;         // tap blocks lost
+} meter_reading_t;
+
+/* metering: the audio callback only copies into the tap ring, the meter
+ * thread computes peak, RMS, true peak and EBU R128 loudness per channel */
+typedef struct meter_t{
+    ringbuf_t tap;
+    int sample_rate;
+    int channels;
+    pthread_t thread;
+    _Atomic int running;
+    _Atomic int reset_req;
+
+    // meter thread only
+    float *block;                   // popped frames, interleaved
+    float *kbuf;                    // K-weighted copy
+    size_t block_frames;
+    float kc[2][5];                 // K-weighting: shelf, then high-pass
+    float kz1[2][MAX_CHANNELS];
+    float kz2[2][MAX_CHANNELS];
+    float weight[MAX_CHANNELS];     // BS.1770 channel weights
+    float tp_coef[METER_TP_PHASES][METER_TP_TAPS];
+    float tp_hist[MAX_CHANNELS][METER_TP_TAPS];
+    float ms[MAX_CHANNELS];         // RMS mean square
+    float rms_alpha;
+    int hold_age[MAX_CHANNELS];     // frames since the hold was set
+    double sub_energy;
+    size_t sub_frames;
+    size_t sub_len;
+    double subs[METER_SHORT_SUBS];
+    int sub_pos;
+    int sub_count;
+    unsigned long hist_count[METER_HIST_BINS];
+    double hist_energy[METER_HIST_BINS];
+
+    pthread_mutex_t lock;           // guards out
+    meter_reading_t out;
+} meter_t;
+
+meter_t *meter_open(int sample_rate, int channels);
+int meter_push(meter_t *m, const SAMPLE *frames, unsigned long frameCount);
+void meter_read(meter_t *m, meter_reading_t *r);
+void meter_reset(meter_t *m);
+void meter_close(meter_t *m);
+
+float meter_db(float amplitude);
+// multi-line live view, redraws in place after the first call
+void meter_render(const meter_reading_t *r, FILE *out, int *drawn);
+
+#endif
@@ -0,0 +1,429 @@
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdatomic.h>
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "offline.h"
+#include "effect.h"
+#include "chain.h"
+#include "wav.h"
+#include "utils.h"
+#include "overview.h"
+#include "resample.h"
+
+offline_opts_t offline_opts = { .dither = 1 };
+
+double offline_now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* a scratch buffer of at least need samples */
+static int offline_grow(SAMPLE **buf, size_t *samples, size_t need){
+    if (need <= *samples)
+        return 0;
+    SAMPLE *b = realloc(*buf, sizeof(SAMPLE) * need);
+    if (!b){
+        perror("offline: malloc");
+        return -1;
+    }
+    *buf = b;
+    *samples = need;
+    return 0;
+}
+
+#define OFFLINE_PART_SUFFIX ".part"
+
+/* outputs are written to PATH.part and renamed over PATH once complete,
+ * so a run that fails leaves an existing PATH (and its .peaks) alone */
+static char *offline_part_path(const char *path){
+    size_t n = strlen(path) + sizeof OFFLINE_PART_SUFFIX;
+    char *part = malloc(n);
+    if (!part){
+        perror("offline: malloc");
+        return NULL;
+    }
+    snprintf(part, n, "%s%s", path, OFFLINE_PART_SUFFIX);
+    return part;
+}
+
+static int offline_finish(const char *part, const char *path, int ok, int peaks){
+    char from[PATH_MAX], to[PATH_MAX];
+    snprintf(from, sizeof from, "%s%s", part, OVERVIEW_SUFFIX);
+    snprintf(to, sizeof to, "%s%s", path, OVERVIEW_SUFFIX);
+    if (ok && rename(part, path) < 0){
+        fprintf(stderr, "offline: %s: %s\n", path, strerror(errno));
+        ok = 0;
+    }
+    if (!ok){
+        unlink(part);
+        if (peaks)
+            unlink(from);
+        return -1;
+    }
+    if (peaks && rename(from, to) < 0){
+        fprintf(stderr, "offline: %s: %s\n", to, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static int offline_block(effect_chain_t *chain, const audio_params_t *p, overview_t *ov,
+        wav_writer *w, pcm_encoder_t *enc, SAMPLE *x, size_t frames, const char *out_path){
+    chain_process(chain, x, frames, p);
+    if (ov)
+        overview_push(ov, x, frames * (size_t)p->channels);
+
+    size_t bytes = sizeof(SAMPLE) * frames * (size_t)p->channels;
+    if (pcm_write(w, enc, x, bytes) != bytes){
+        fprintf(stderr, "offline: %s: write error\n", out_path);
+        return -1;
+    }
+    return 0;
+}
+
+/* one file through a fresh chain. the arena and block buffers in s are
+ * reused; the chain state starts from zero for every file. with o->rate
+ * the file is resampled first and the chain runs at o->rate. everything
+ * that can fail on the input or the chain spec does so before the output
+ * is opened, and the output only replaces out_path when it is complete */
+int offline_file(const offline_opts_t *o, const char *in_path, const char *out_path,
+        const audio_params_t *params, offline_scratch_t *s, offline_result_t *res){
+    double t0 = offline_now();
+    unsigned long block = o->block_frames ? o->block_frames : OFFLINE_BLOCK_FRAMES;
+
+    wav_reader *r = wav_reader_open(in_path);
+    if (!r)
+        return -1;
+
+    audio_params_t p = *params;
+    p.channels = r->num_channels;
+    p.sample_rate = o->rate > 0 ? o->rate : r->sample_rate;
+
+    effect_chain_t chain = {0};
+    resampler_t *rs = NULL;
+    pcm_encoder_t *enc = NULL;
+    wav_writer *w = NULL;
+    overview_t *ov = NULL;
+    char *part = NULL;
+    int rc = -1;
+
+    arena_reset(&s->arena);
+    if (o->chain_spec && chain_parse(&chain, o->chain_spec, &p, &s->arena) < 0)
+        goto out;
+    if (p.sample_rate != r->sample_rate
+            && !(rs = resampler_create(r->sample_rate, p.sample_rate, p.channels,
+                                       resample_quality)))
+        goto out;
+    if (offline_grow(&s->buf, &s->buf_samples, block * (size_t)p.channels) < 0)
+        goto out;
+    if (rs && offline_grow(&s->out, &s->out_samples,
+            resampler_out_max(rs, block > rs->taps ? block : rs->taps) * p.channels) < 0)
+        goto out;
+
+    if (!(enc = pcm_encoder_new(o->format, o->dither)) || !(part = offline_part_path(out_path)))
+        goto out;
+    if (!(w = pcm_wav_open(part, o->format, p.sample_rate, p.channels, 0)))
+        goto out;
+    if (o->peaks && !(ov = overview_open(part, p.sample_rate, p.channels)))
+        goto out;
+
+    rc = 0;
+    size_t frames;
+    while (rc == 0 && (frames = wav_reader_read(r, s->buf, block)) > 0){
+        SAMPLE *x = s->buf;
+        if (rs){
+            frames = resampler_process(rs, s->buf, frames, s->out);
+            x = s->out;
+        }
+        rc = offline_block(&chain, &p, ov, w, enc, x, frames, out_path);
+    }
+    if (rc == 0 && rs){
+        frames = resampler_flush(rs, s->out);
+        rc = offline_block(&chain, &p, ov, w, enc, s->out, frames, out_path);
+    }
+
+    res->frames = w->num_samples;
+    res->channels = p.channels;
+    res->sample_rate = p.sample_rate;
+    res->effects = chain.count;
+
+out:
+    pcm_encoder_free(enc);
+    resampler_free(rs);
+    wav_reader_close(r);
+    if (w && wav_close(w) < 0)
+        rc = -1;
+    if (overview_close(ov) < 0)
+        rc = -1;
+    if (w && offline_finish(part, out_path, rc == 0, ov != NULL) < 0)
+        rc = -1;
+    free(part);
+    res->seconds = offline_now() - t0;
+    return rc;
+}
+
+/* one input split into chunks that run on all cores. stages without
+ * state give identical results for any split; a stage with a short
+ * history (chain_history) is rebuilt for every chunk and fed that many
+ * frames before the chunk first, which leaves it in the exact state the
+ * sequential pass would have. every chunk lands with wav_pwrite at its
+ * own offset in a file sized up front */
+typedef struct offline_par_t{
+    wav_reader *r;
+    wav_writer *w;
+    const char *chain_spec;
+    audio_params_t p;
+    size_t chunk;       // frames per task
+    size_t history;     // warm-up frames in front of each chunk
+    size_t nchunks;
+    _Atomic size_t next;
+    _Atomic int failed;
+    // --peaks: chunk outputs go into the overview in file order
+    overview_t *ov;
+    pthread_mutex_t ov_lock;
+    pthread_cond_t ov_turn;
+    size_t ov_next;
+} offline_par_t;
+
+typedef struct offline_par_worker_t{
+    offline_par_t *job;
+    pthread_t thread;
+    offline_scratch_t scratch;
+    pcm_encoder_t *enc;
+} offline_par_worker_t;
+
+static void offline_par_fail(offline_par_t *job){
+    pthread_mutex_lock(&job->ov_lock);
+    atomic_store(&job->failed, 1);
+    pthread_cond_broadcast(&job->ov_turn);
+    pthread_mutex_unlock(&job->ov_lock);
+}
+
+/* the overview sees the same floats as in offline_file, before they are
+ * quantized. chunk i waits for i - 1; every lower chunk is already taken
+ * by a running worker, so the wait ends unless the job fails */
+static void offline_par_peaks(offline_par_t *job, size_t i, const SAMPLE *x,
+        size_t samples)
+{
+    pthread_mutex_lock(&job->ov_lock);
+    while (job->ov_next != i && !atomic_load(&job->failed))
+        pthread_cond_wait(&job->ov_turn, &job->ov_lock);
+    if (job->ov_next == i){
+        overview_push(job->ov, x, samples);
+        job->ov_next++;
+        pthread_cond_broadcast(&job->ov_turn);
+    }
+    pthread_mutex_unlock(&job->ov_lock);
+}
+
+static void *offline_par_main(void *arg){
+    offline_par_worker_t *wk = arg;
+    offline_par_t *job = wk->job;
+    offline_scratch_t *s = &wk->scratch;
+    const size_t ch = (size_t)job->p.channels;
+
+    effect_chain_t chain = {0};
+    int have_chain = 0;
+    size_t i;
+    while (!atomic_load_explicit(&job->failed, memory_order_relaxed)
+            && (i = atomic_fetch_add(&job->next, 1)) < job->nchunks){
+        size_t start = i * job->chunk;
+        size_t warm = start < job->history ? start : job->history;
+
+        // stateless chains are built once, the others start fresh per chunk
+        if (!have_chain || job->history){
+            memset(&chain, 0, sizeof chain);
+            arena_reset(&s->arena);
+            if (job->chain_spec && chain_parse(&chain, job->chain_spec, &job->p, &s->arena) < 0){
+                offline_par_fail(job);
+                break;
+            }
+            have_chain = 1;
+        }
+
+        size_t frames = wav_reader_read_at(job->r, start - warm, s->buf, warm + job->chunk);
+        chain_process(&chain, s->buf, frames, &job->p);
+
+        size_t bytes = sizeof(SAMPLE) * (frames - warm) * ch;
+        if (job->ov)
+            offline_par_peaks(job, i, s->buf + warm * ch, (frames - warm) * ch);
+        if (pcm_pwrite(job->w, wk->enc, s->buf + warm * ch, bytes, start) != bytes)
+            offline_par_fail(job);
+    }
+    return NULL;
+}
+
+/* -2 when the chunks cannot be set up, before the output is touched: the
+ * caller runs the file sequentially instead. state_bytes: arena one
+ * instance of the chain takes */
+static int offline_parallel(const offline_opts_t *o, wav_reader *r,
+        const audio_params_t *p, int jobs, long history, size_t state_bytes,
+        offline_result_t *res){
+    double t0 = offline_now();
+
+    offline_par_t job = {0};
+    job.r = r;
+    job.chain_spec = o->chain_spec;
+    job.p = *p;
+    job.history = (size_t)history;
+    job.chunk = OFFLINE_CHUNK_BYTES / (sizeof(SAMPLE) * (size_t)p->channels);
+    if (job.chunk < 4 * job.history)
+        job.chunk = 4 * job.history;
+    job.nchunks = (r->num_frames + job.chunk - 1) / job.chunk;
+    if ((size_t)jobs > job.nchunks)
+        jobs = (int)job.nchunks;
+
+    pthread_mutex_init(&job.ov_lock, NULL);
+    pthread_cond_init(&job.ov_turn, NULL);
+
+    int rc = -2;
+    char *part = NULL;
+    offline_par_worker_t *wk = calloc(jobs, sizeof *wk);
+    if (!wk){
+        perror("offline: malloc");
+        goto out;
+    }
+
+    size_t buf_samples = (job.history + job.chunk) * (size_t)p->channels;
+    for (int k = 0; k < jobs; k++){
+        wk[k].job = &job;
+        wk[k].scratch.buf = malloc(sizeof(SAMPLE) * buf_samples);
+        wk[k].scratch.buf_samples = buf_samples;
+        wk[k].enc = pcm_encoder_new(o->format, o->dither);
+        if (!wk[k].scratch.buf || !wk[k].enc){
+            perror("offline: malloc");
+            goto out;
+        }
+        // every chunk builds the same chain, it takes the same space
+        if (arena_init(&wk[k].scratch.arena, state_bytes ? state_bytes : ARENA_ALIGN) < 0)
+            goto out;
+    }
+
+    rc = -1;
+    if (!(part = offline_part_path(o->out_path)))
+        goto out;
+    job.w = pcm_wav_open(part, o->format, r->sample_rate, r->num_channels, 0);
+    if (!job.w)
+        goto out;
+    if (wav_reserve(job.w, r->num_frames) < 0)
+        goto out;
+    if (o->peaks && !(job.ov = overview_open(part, p->sample_rate, p->channels)))
+        goto out;
+
+    int started = 0;
+    for (; started < jobs; started++){
+        int err = pthread_create(&wk[started].thread, NULL, offline_par_main, &wk[started]);
+        if (err){
+            fprintf(stderr, "offline: pthread_create: %s\n", strerror(err));
+            break;
+        }
+    }
+    // the running threads pick up the chunks of any that failed to start
+    if (started == 0)
+        offline_par_main(&wk[0]);
+    for (int k = 0; k < started; k++)
+        pthread_join(wk[k].thread, NULL);
+    rc = atomic_load(&job.failed) ? -1 : 0;
+
+    res->frames = r->num_frames;
+    res->channels = p->channels;
+    res->sample_rate = p->sample_rate;
+    if (rc == 0)
+        printf("offline: %zu chunks of %zu frames (+%zu warm-up) on %d threads\n",
+               job.nchunks, job.chunk, job.history, started ? started : 1);
+out:
+    if (wk){
+        for (int k = 0; k < jobs; k++){
+            free(wk[k].scratch.buf);
+            arena_free(&wk[k].scratch.arena);
+            pcm_encoder_free(wk[k].enc);
+        }
+        free(wk);
+    }
+    if (job.w && wav_close(job.w) < 0)
+        rc = -1;
+    if (job.ov && overview_close(job.ov) < 0)
+        rc = -1;
+    if (job.w && offline_finish(part, o->out_path, rc == 0, job.ov != NULL) < 0)
+        rc = -1;
+    free(part);
+    pthread_mutex_destroy(&job.ov_lock);
+    pthread_cond_destroy(&job.ov_turn);
+    res->seconds = offline_now() - t0;
+    return rc;
+}
+
+/* -1 to run sequentially, -2 for a chain spec that does not parse,
+ * otherwise the warm-up for offline_parallel */
+static long offline_split_history(const offline_opts_t *o, const wav_reader *r,
+        const audio_params_t *p, arena_t *arena, size_t *effects, size_t *state_bytes){
+    effect_chain_t chain = {0};
+    arena_reset(arena);
+    if (o->chain_spec && chain_parse(&chain, o->chain_spec, p, arena) < 0)
+        return -2;
+    *effects = chain.count;
+    *state_bytes = arena->used;
+    size_t chunk = OFFLINE_CHUNK_BYTES / (sizeof(SAMPLE) * (size_t)p->channels);
+    if (r->num_frames < 2 * chunk)
+        return -1;
+    return chain_history(&chain);
+}
+
+int offline_run(const offline_opts_t *o, const audio_params_t *params){
+    if (!o->in_path || !o->out_path){
+        fprintf(stderr, "offline: both --in and --out are required\n");
+        return -1;
+    }
+
+    offline_scratch_t s = {0};
+    if (arena_init(&s.arena, OFFLINE_ARENA_SIZE) < 0)
+        return -1;
+
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int jobs = o->jobs > 0 ? o->jobs : (ncpu > 0 ? (int)ncpu : 1);
+    if (jobs > OFFLINE_MAX_JOBS)
+        jobs = OFFLINE_MAX_JOBS;
+
+    int rc = -2;
+    offline_result_t res = {0};
+    if (jobs > 1){
+        wav_reader *r = wav_reader_open(o->in_path);
+        if (!r){
+            arena_free(&s.arena);
+            return -1;
+        }
+        audio_params_t p = *params;
+        p.channels = r->num_channels;
+        p.sample_rate = r->sample_rate;
+        // chunks map 1:1 onto the output, a rate change runs sequentially
+        size_t state_bytes = 0;
+        long history = o->rate > 0 && o->rate != r->sample_rate ? -1
+                : offline_split_history(o, r, &p, &s.arena, &res.effects, &state_bytes);
+        if (history >= 0)
+            rc = offline_parallel(o, r, &p, jobs, history, state_bytes, &res);
+        else if (history == -2)
+            rc = -1;    // already reported, offline_file would say it again
+        wav_reader_close(r);
+    }
+    if (rc == -2)
+        rc = offline_file(o, o->in_path, o->out_path, params, &s, &res);
+    if (rc == 0 || res.sample_rate){
+        double audio_sec = (double)res.frames / res.sample_rate;
+        printf("%s -> %s: %zu frames, %d ch, %zu effects, %.3f s (%.1fx realtime)\n",
+               o->in_path, o->out_path, res.frames, res.channels, res.effects,
+               res.seconds, res.seconds > 0 ? audio_sec / res.seconds : 0.0);
+    }
+
+    free(s.buf);
+    free(s.out);
+    arena_free(&s.arena);
+    return rc;
+}
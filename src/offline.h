@@ -0,0 +1,53 @@
+#ifndef OFFLINE_H
+#define OFFLINE_H
+
+#include "audio_types.h"
+#include "effect.h"
+#include "chain.h"
+#include "arena.h"
+#include "pcm.h"
+
+#define OFFLINE_BLOCK_FRAMES (65536)
+#define OFFLINE_ARENA_SIZE (64u << 20)
+#define OFFLINE_CHUNK_BYTES (256u << 10)   // one parallel task, about an L2
+#define OFFLINE_MAX_JOBS (256)
+
+/* file-to-file processing, no PortAudio involved */
+typedef struct offline_opts_t{
+    const char *in_path;
+    const char *out_path;       // batch: output directory
+    const char *chain_spec;     // "soft,hard": names or ids
+    unsigned long block_frames;
+    int jobs;                   // worker threads, 0: one per core
+    const pcm_format_t *format; // output, NULL: float32
+    int dither;                 // TPDF dither for pcm16/pcm24
+    int peaks;                  // FILE.peaks overview next to every output
+    int rate;                   // resample to this before the chain, 0: keep
+} offline_opts_t;
+
+/* buffers reused from file to file by one thread */
+typedef struct offline_scratch_t{
+    arena_t arena;      // effect state, reset per file
+    SAMPLE *buf;
+    size_t buf_samples;
+    SAMPLE *out;        // resampled block
+    size_t out_samples;
+} offline_scratch_t;
+
+typedef struct offline_result_t{
+    size_t frames;
+    int channels;
+    int sample_rate;
+    size_t effects;
+    double seconds;     // read + process + write
+} offline_result_t;
+
+extern offline_opts_t offline_opts;
+
+int offline_file(const offline_opts_t *o, const char *in_path, const char *out_path,
+        const audio_params_t *params, offline_scratch_t *s, offline_result_t *res);
+int offline_run(const offline_opts_t *o, const audio_params_t *params);
+
+double offline_now(void);
+
+#endif
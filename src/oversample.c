@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "oversample.h"
+#include "kernels.h"
+
+// odd-phase taps per section, first (lowest rate) section first
+static const int stage_half[OS_MAX_STAGES] = { 16, 8, 4 };
+static const double stage_beta[OS_MAX_STAGES] = { 8.0, 7.0, 6.0 };
+
+static double bessel_i0(double x){
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; k++){
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+/* Kaiser-windowed half-band sinc. c[k] sits at odd offset 2 * half - 1 - 2k
+ * from the center; the filter is symmetric, so the order does not matter
+ * for the math, only for matching the FIR kernel's history layout */
+static void design(os_stage_t *s, int half, double beta){
+    s->half = half;
+    s->taps = 2 * half;
+    double sum = 0.0, c[OS_MAX_TAPS];
+    for (int k = 0; k < s->taps; k++){
+        double n = 2 * half - 1 - 2 * k;
+        double t = n / (2.0 * half);
+        double w = bessel_i0(beta * sqrt(1.0 - t * t)) / bessel_i0(beta);
+        c[k] = sin(M_PI * n / 2.0) / (M_PI * n / 2.0) * w;
+        sum += c[k];
+    }
+    for (int k = 0; k < s->taps; k++)
+        s->c[k] = (float)(c[k] / sum);
+}
+
+int oversample_factor_valid(int factor){
+    return factor == 1 || factor == 2 || factor == 4 || factor == 8;
+}
+
+oversampler_t *oversampler_create(int factor, int channels, arena_t *arena){
+    if (!oversample_factor_valid(factor) || factor == 1 || channels < 1)
+        return NULL;
+
+    oversampler_t *os = arena_alloc(arena, sizeof *os);
+    if (!os)
+        return NULL;
+    os->factor = factor;
+    os->channels = channels;
+    os->stages = factor == 2 ? 1 : factor == 4 ? 2 : 3;
+
+    const size_t high = (size_t)OS_CHUNK_FRAMES * factor;
+    for (int i = 0; i < os->stages; i++){
+        os_stage_t *s = &os->st[i];
+        design(s, stage_half[i], stage_beta[i]);
+        s->in = (size_t)OS_CHUNK_FRAMES << i;
+        size_t line = sizeof(float) * (s->taps - 1 + s->in) * channels;
+        s->up = arena_alloc(arena, line);
+        s->down_even = arena_alloc(arena, line);
+        s->down_odd = arena_alloc(arena, line);
+        // zeroed by the arena: the history starts silent
+        if (!s->up || !s->down_even || !s->down_odd)
+            return NULL;
+    }
+    os->a = arena_alloc(arena, sizeof(float) * high * channels);
+    os->b = arena_alloc(arena, sizeof(float) * high * channels);
+    os->odd = arena_alloc(arena, sizeof(float) * high / 2);
+    os->inter = arena_alloc(arena, sizeof(float) * high * channels);
+    if (!os->a || !os->b || !os->odd || !os->inter)
+        return NULL;
+    return os;
+}
+
+/* base rate frames from input to output. a section delays by half of its
+ * input samples on the way up and by half - 1 of its output samples on
+ * the way down */
+double oversampler_latency(const oversampler_t *os){
+    double frames = 0.0;
+    for (int i = 0; i < os->stages; i++)
+        frames += (2.0 * os->st[i].half - 1.0) / (1 << i);
+    return frames;
+}
+
+// base rate frames that fill every delay line, for chunked offline runs
+unsigned long oversampler_history(const oversampler_t *os){
+    unsigned long frames = 0;
+    for (int i = 0; i < os->stages; i++)
+        frames += 2 * (((unsigned long)os->st[i].taps + (1ul << i) - 1) >> i);
+    return frames;
+}
+
+static void up(const dsp_kernels_t *k, os_stage_t *s, float *odd, const float *in,
+        float *out, size_t n)
+{
+    const size_t hist = (size_t)s->taps - 1;
+    float *u = s->up;
+    memcpy(u + hist, in, sizeof(float) * n);
+    k->fir(u, odd, n, s->c, (size_t)s->taps);
+    const float *phases[2] = { u + s->half - 1, odd };
+    k->interleave(phases, out, n, 2);
+    memmove(u, u + n, sizeof(float) * hist);
+}
+
+static void down(const dsp_kernels_t *k, os_stage_t *s, float *odd, const float *in,
+        float *out, size_t n)
+{
+    const size_t hist = (size_t)s->taps - 1;
+    float *phases[2] = { s->down_even + hist, s->down_odd + hist };
+    k->deinterleave(in, phases, n, 2);
+    k->fir(s->down_odd, odd, n, s->c, (size_t)s->taps);
+    const float *even = s->down_even + s->half;
+    for (size_t j = 0; j < n; j++)
+        out[j] = 0.5f * (odd[j] + even[j]);
+    memmove(s->down_even, s->down_even + n, sizeof(float) * hist);
+    memmove(s->down_odd, s->down_odd + n, sizeof(float) * hist);
+}
+
+/* every stage keeps one history line per channel: the lines of channel c
+ * start at c * (taps - 1 + in) */
+static void select_channel(const oversampler_t *os, os_stage_t *view, int c){
+    for (int i = 0; i < os->stages; i++){
+        const os_stage_t *s = &os->st[i];
+        size_t line = (size_t)s->taps - 1 + s->in;
+        view[i] = *s;
+        view[i].up = s->up + c * line;
+        view[i].down_even = s->down_even + c * line;
+        view[i].down_odd = s->down_odd + c * line;
+    }
+}
+
+/* the effect sees factor times the frames and the rate; a ramping gain
+ * is spread over the high rate frames so it stays continuous */
+void oversampler_process(oversampler_t *os, const effect_t *e, void *state,
+        SAMPLE *x, unsigned long frames, const audio_params_t *p)
+{
+    const dsp_kernels_t *k = dsp_kernels();
+    const int ch = os->channels;
+    const size_t stride = (size_t)OS_CHUNK_FRAMES * os->factor;
+    if (p->channels != ch)
+        return;
+
+    audio_params_t hp = *p;
+    hp.sample_rate = p->sample_rate * os->factor;
+    hp.gain_step = p->gain_step / (float)os->factor;
+
+    float *pa[MAX_CHANNELS], *pb[MAX_CHANNELS];
+    os_stage_t view[OS_MAX_STAGES];
+    for (unsigned long off = 0; off < frames; off += OS_CHUNK_FRAMES){
+        size_t n = frames - off;
+        if (n > OS_CHUNK_FRAMES)
+            n = OS_CHUNK_FRAMES;
+        SAMPLE *xc = x + off * ch;
+        hp.gain = p->gain + p->gain_step * (float)off;
+
+        float *a = os->a, *b = os->b;
+        for (int c = 0; c < ch; c++)
+            pa[c] = a + c * stride;
+        k->deinterleave(xc, pa, n, ch);
+
+        for (int c = 0; c < ch; c++){
+            select_channel(os, view, c);
+            float *src = a + c * stride, *dst = b + c * stride;
+            for (int i = 0; i < os->stages; i++){
+                up(k, &view[i], os->odd, src, dst, n << i);
+                float *t = src; src = dst; dst = t;
+            }
+            // leave the result in a, the chain works from there
+            if (src != a + c * stride)
+                memcpy(a + c * stride, src, sizeof(float) * n * os->factor);
+        }
+
+        size_t hn = n * os->factor;
+        k->interleave((const float *const *)pa, os->inter, hn, ch);
+        e->func(os->inter, hn, &hp, state);
+        k->deinterleave(os->inter, pa, hn, ch);
+
+        for (int c = 0; c < ch; c++){
+            select_channel(os, view, c);
+            float *src = a + c * stride, *dst = b + c * stride;
+            for (int i = os->stages - 1; i >= 0; i--){
+                down(k, &view[i], os->odd, src, dst, n << i);
+                float *t = src; src = dst; dst = t;
+            }
+            pb[c] = src;
+        }
+        k->interleave((const float *const *)pb, xc, n, ch);
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef OVERSAMPLE_H
+#define OVERSAMPLE_H
+
+#include <stddef.h>
+
+#include "audio_types.h"
+#include "effect.h"
+#include "arena.h"
+
+#define OS_MAX_FACTOR   (8)
+#define OS_MAX_STAGES   (3)
+#define OS_CHUNK_FRAMES (256)   // base rate frames per pass
+#define OS_MAX_TAPS     (32)
+
+/* one 2x half-band section. only the odd phase has coefficients (2 * half
+ * of them, summing to 1), the even phase is a plain delay of half samples */
+typedef struct os_stage_t{
+    int half;
+    int taps;
+    float c[OS_MAX_TAPS];
+    size_t in;              // input samples per chunk at this stage
+    float *up;              // per channel: taps - 1 history, then in
+    float *down_even;       // same, even and odd phase of the way down
+    float *down_odd;
+} os_stage_t;
+
+/* runs one stage of the chain at 2, 4 or 8 times the rate: cascaded
+ * polyphase half-band FIRs up, the effect, the mirror cascade down.
+ * the first section is the longest, later ones only have to reject the
+ * images of already band-limited signal */
+typedef struct oversampler_t{
+    int factor;
+    int stages;
+    int channels;
+    os_stage_t st[OS_MAX_STAGES];
+    float *a;               // planar work buffers, channels * chunk * factor
+    float *b;
+    float *odd;             // one phase, chunk * factor / 2
+    float *inter;           // interleaved at the high rate
+} oversampler_t;
+
+int oversample_factor_valid(int factor);
+oversampler_t *oversampler_create(int factor, int channels, arena_t *arena);
+double oversampler_latency(const oversampler_t *os);
+unsigned long oversampler_history(const oversampler_t *os);
+void oversampler_process(oversampler_t *os, const effect_t *e, void *state,
+        SAMPLE *x, unsigned long frames, const audio_params_t *p);
+
+#endif
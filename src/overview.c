@@ -0,0 +1,236 @@
+#include <math.h>
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "overview.h"
+#include "wav.h"
+#include "utils.h"
+
+const unsigned overview_bucket_frames[OVERVIEW_LEVELS] = { 256, 4096, 65536 };
+
+#define RECORD_FLOATS (3)
+
+static void acc_reset(overview_acc_t *a, int channels){
+    for (int c = 0; c < channels; c++){
+        a[c].min = FLT_MAX;
+        a[c].max = -FLT_MAX;
+        a[c].sumsq = 0.0;
+    }
+}
+
+overview_t *overview_open(const char *wav_path, int sample_rate, int channels){
+    overview_t *o = calloc(1, sizeof *o);
+    if (!o){
+        perror("overview_open");
+        return NULL;
+    }
+    o->channels = channels;
+    o->sample_rate = sample_rate;
+
+    size_t n = strlen(wav_path) + sizeof OVERVIEW_SUFFIX;
+    o->path = malloc(n);
+    o->out = malloc(sizeof(float) * RECORD_FLOATS * (size_t)channels);
+    if (!o->path || !o->out)
+        goto err;
+    snprintf(o->path, n, "%s%s", wav_path, OVERVIEW_SUFFIX);
+
+    for (int l = 0; l < OVERVIEW_LEVELS; l++){
+        o->acc[l] = malloc(sizeof(overview_acc_t) * (size_t)channels);
+        if (!o->acc[l])
+            goto err;
+        acc_reset(o->acc[l], channels);
+    }
+
+    o->file = fopen(o->path, "wb");
+    if (!o->file)
+        goto err;
+    // placeholder, the real header goes in on close
+    unsigned char zero[OVERVIEW_HEADER_SIZE] = { 0 };
+    if (fwrite(zero, sizeof zero, 1, o->file) != 1)
+        goto err;
+    return o;
+
+err:
+    perror("overview_open");
+    if (o->file)
+        fclose(o->file);
+    for (int l = 0; l < OVERVIEW_LEVELS; l++)
+        free(o->acc[l]);
+    free(o->out);
+    free(o->path);
+    free(o);
+    return NULL;
+}
+
+static int append(overview_t *o, int l, const float *r){
+    size_t n = RECORD_FLOATS * (size_t)o->channels;
+    if (o->count[l] == o->cap[l]){
+        size_t cap = o->cap[l] ? o->cap[l] * 2 : 256;
+        float *p = realloc(o->rec[l], sizeof(float) * n * cap);
+        if (!p)
+            return -1;
+        o->rec[l] = p;
+        o->cap[l] = cap;
+    }
+    memcpy(o->rec[l] + o->count[l] * n, r, sizeof(float) * n);
+    o->count[l]++;
+    return 0;
+}
+
+/* close the running bucket of level l: write or keep its record and fold
+ * it into level l + 1 */
+static void finish_bucket(overview_t *o, int l){
+    overview_acc_t *a = o->acc[l];
+    size_t frames = o->fill[l];
+    for (int c = 0; c < o->channels; c++){
+        o->out[c * RECORD_FLOATS + 0] = a[c].min;
+        o->out[c * RECORD_FLOATS + 1] = a[c].max;
+        o->out[c * RECORD_FLOATS + 2] = (float)sqrt(a[c].sumsq / (double)frames);
+    }
+    if (l == 0){
+        if (fwrite(o->out, sizeof(float) * RECORD_FLOATS * (size_t)o->channels, 1, o->file) != 1)
+            o->error = 1;
+    } else if (append(o, l, o->out) < 0)
+        o->error = 1;
+
+    if (l + 1 < OVERVIEW_LEVELS){
+        overview_acc_t *up = o->acc[l + 1];
+        for (int c = 0; c < o->channels; c++){
+            if (a[c].min < up[c].min) up[c].min = a[c].min;
+            if (a[c].max > up[c].max) up[c].max = a[c].max;
+            up[c].sumsq += a[c].sumsq;
+        }
+        o->fill[l + 1] += frames;
+        if (o->fill[l + 1] == overview_bucket_frames[l + 1])
+            finish_bucket(o, l + 1);
+    }
+    acc_reset(a, o->channels);
+    o->fill[l] = 0;
+}
+
+// whole frames, bucket by bucket, channels in the inner loop
+static void push_frames(overview_t *o, const SAMPLE *x, size_t frames){
+    const int ch = o->channels;
+    overview_acc_t *a = o->acc[0];
+    while (frames){
+        size_t n = overview_bucket_frames[0] - o->fill[0];
+        if (n > frames)
+            n = frames;
+        for (size_t i = 0; i < n; i++, x += ch){
+            for (int c = 0; c < ch; c++){
+                float s = x[c];
+                if (s < a[c].min) a[c].min = s;
+                if (s > a[c].max) a[c].max = s;
+                a[c].sumsq += (double)s * s;
+            }
+        }
+        o->fill[0] += n;
+        o->frames += n;
+        frames -= n;
+        if (o->fill[0] == overview_bucket_frames[0])
+            finish_bucket(o, 0);
+    }
+}
+
+static void push_sample(overview_t *o, SAMPLE s){
+    overview_acc_t *a = &o->acc[0][o->cursor];
+    if (s < a->min) a->min = s;
+    if (s > a->max) a->max = s;
+    a->sumsq += (double)s * s;
+    if (++o->cursor == o->channels){
+        o->cursor = 0;
+        o->frames++;
+        if (++o->fill[0] == overview_bucket_frames[0])
+            finish_bucket(o, 0);
+    }
+}
+
+/* any number of samples: a frame may be split across calls (ring wrap) */
+void overview_push(overview_t *o, const SAMPLE *x, size_t samples){
+    while (samples && o->cursor){
+        push_sample(o, *x++);
+        samples--;
+    }
+    size_t frames = samples / (size_t)o->channels;
+    push_frames(o, x, frames);
+    x += frames * (size_t)o->channels;
+    samples -= frames * (size_t)o->channels;
+    while (samples--)
+        push_sample(o, *x++);
+}
+
+int overview_close(overview_t *o){
+    if (!o)
+        return 0;
+
+    // partial buckets, finest first so each one still reaches the next level
+    for (int l = 0; l < OVERVIEW_LEVELS; l++){
+        if (o->fill[l])
+            finish_bucket(o, l);
+    }
+
+    unsigned char h[OVERVIEW_HEADER_SIZE] = { 0 };
+    memcpy(h, OVERVIEW_MAGIC, 4);
+    write_u32_le(h + 4, OVERVIEW_VERSION);
+    write_u32_le(h + 8, (uint32_t)o->channels);
+    write_u32_le(h + 12, (uint32_t)o->sample_rate);
+    write_u64_le(h + 16, o->frames);
+    write_u32_le(h + 24, OVERVIEW_LEVELS);
+
+    size_t rec_bytes = sizeof(float) * RECORD_FLOATS * (size_t)o->channels;
+    uint64_t off = OVERVIEW_HEADER_SIZE;
+    for (int l = 0; l < OVERVIEW_LEVELS; l++){
+        unsigned char *e = h + 32 + 16 * l;
+        write_u32_le(e, overview_bucket_frames[l]);
+        write_u64_le(e + 8, off);
+        uint64_t buckets = (o->frames + overview_bucket_frames[l] - 1) / overview_bucket_frames[l];
+        off += buckets * rec_bytes;
+        if (l > 0 && o->count[l]
+                && fwrite(o->rec[l], rec_bytes, o->count[l], o->file) != o->count[l])
+            o->error = 1;
+    }
+
+    if (fseek(o->file, 0, SEEK_SET) != 0 || fwrite(h, sizeof h, 1, o->file) != 1)
+        o->error = 1;
+    if (fclose(o->file) != 0)
+        o->error = 1;
+
+    int rc = o->error ? -1 : 0;
+    if (rc < 0)
+        fprintf(stderr, "overview: write error on %s\n", o->path);
+    for (int l = 0; l < OVERVIEW_LEVELS; l++){
+        free(o->acc[l]);
+        free(o->rec[l]);
+    }
+    free(o->out);
+    free(o->path);
+    free(o);
+    return rc;
+}
+
+#define BUILD_BLOCK_FRAMES (65536)
+
+int overview_build(const char *wav_path){
+    wav_reader *r = wav_reader_open(wav_path);
+    if (!r)
+        return -1;
+
+    SAMPLE *scratch = malloc(sizeof(SAMPLE) * BUILD_BLOCK_FRAMES * (size_t)r->num_channels);
+    overview_t *o = scratch ? overview_open(wav_path, r->sample_rate, r->num_channels) : NULL;
+    if (!o){
+        free(scratch);
+        wav_reader_close(r);
+        return -1;
+    }
+
+    const SAMPLE *blk;
+    size_t n;
+    while ((n = wav_reader_next_block(r, scratch, BUILD_BLOCK_FRAMES, &blk)) > 0)
+        overview_push(o, blk, n * (size_t)r->num_channels);
+
+    free(scratch);
+    wav_reader_close(r);
+    return overview_close(o);
+}
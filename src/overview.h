@@ -0,0 +1,54 @@
+#ifndef OVERVIEW_H
+#define OVERVIEW_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "audio_types.h"
+
+#define OVERVIEW_SUFFIX ".peaks"
+#define OVERVIEW_LEVELS (3)
+#define OVERVIEW_MAGIC "WVPK"
+#define OVERVIEW_VERSION (1)
+#define OVERVIEW_HEADER_SIZE (32 + 16 * OVERVIEW_LEVELS)
+
+/* waveform overview sidecar (FILE.wav.peaks): a min/max/rms pyramid so a
+ * viewer can draw any window from the level that matches its zoom.
+ *
+ * little endian. header: "WVPK", u32 version, u32 channels, u32 rate,
+ * u64 frames, u32 levels, u32 0, then per level u32 frames per bucket,
+ * u32 0, u64 file offset. a level is ceil(frames / bucket) buckets of
+ * channels x { f32 min, f32 max, f32 rms }. level 0 streams right after
+ * the header while recording, the coarser levels are appended on close */
+extern const unsigned overview_bucket_frames[OVERVIEW_LEVELS];  // 256, 4096, 65536
+
+typedef struct overview_acc_t{
+    float min, max;
+    double sumsq;
+} overview_acc_t;
+
+typedef struct overview_t{
+    FILE *file;
+    char *path;
+    int channels;
+    int sample_rate;
+    uint64_t frames;
+    int cursor;                     // channel of the next sample
+    // per level: running bucket, frames in it, finished buckets (levels >= 1)
+    overview_acc_t *acc[OVERVIEW_LEVELS];
+    size_t fill[OVERVIEW_LEVELS];
+    float *rec[OVERVIEW_LEVELS];
+    size_t count[OVERVIEW_LEVELS];
+    size_t cap[OVERVIEW_LEVELS];
+    float *out;                     // one level 0 record
+    int error;
+} overview_t;
+
+overview_t *overview_open(const char *wav_path, int sample_rate, int channels);
+void overview_push(overview_t *o, const SAMPLE *x, size_t samples);  // interleaved
+int overview_close(overview_t *o);
+
+int overview_build(const char *wav_path);   // sidecar for an existing WAV
+
+#endif
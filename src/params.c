@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "params.h"
+
+int params_init(params_t *ps){
+    memset(ps->ramp, 0, sizeof ps->ramp);
+    return ringbuf_init_mem(&ps->queue, ps->queue_mem, PARAM_QUEUE_BYTES);
+}
+
+/* stream stopped: start the ramps from the values in *p */
+void params_reset(params_t *ps, const audio_params_t *p){
+    const float start[PARAM_COUNT] = { [PARAM_GAIN] = p->gain };
+    for (int i = 0; i < PARAM_COUNT; i++){
+        ps->ramp[i] = (param_ramp_t){ .value = start[i], .target = start[i] };
+        atomic_store_explicit(&ps->value[i], start[i], memory_order_relaxed);
+    }
+}
+
+int params_set(params_t *ps, param_id_t id, float target, float ramp_sec,
+        param_shape_t shape)
+{
+    if (id >= PARAM_COUNT || !isfinite(target) || !(ramp_sec >= 0.0f))
+        return -1;
+    param_msg_t msg = { id, shape, target, ramp_sec };
+    if (ringbuf_push(&ps->queue, &msg, sizeof msg) != sizeof msg){
+        fprintf(stderr, "params: update queue full, is the stream running?\n");
+        return -1;
+    }
+    return 0;
+}
+
+float params_get(const params_t *ps, param_id_t id){
+    return atomic_load_explicit(&((params_t *)ps)->value[id], memory_order_relaxed);
+}
+
+static void start_ramp(param_ramp_t *r, const param_msg_t *m, int sample_rate){
+    unsigned long frames = (unsigned long)lround(m->ramp_sec * sample_rate);
+    r->target = m->target;
+    r->shape = m->shape;
+    r->left = frames;
+    if (frames == 0){
+        r->value = m->target;
+        return;
+    }
+    // a newer change ramps from wherever the last one got to
+    if (m->shape == PARAM_EXP && r->value > 0.0f && m->target > 0.0f){
+        r->step = pow((double)m->target / r->value, 1.0 / frames);
+    } else {
+        r->shape = PARAM_LINEAR;
+        r->step = ((double)m->target - r->value) / frames;
+    }
+}
+
+/* advance one block: the segment is linear inside the block, exponential
+ * ramps are exact at block edges. a ramp ending mid block finishes at the
+ * end of it, so changes land within one block of their nominal time */
+static void advance(param_ramp_t *r, unsigned long frames, float *start, float *slope){
+    *start = r->value;
+    if (r->left == 0){
+        *slope = 0.0f;
+        return;
+    }
+    float end;
+    if (r->left <= frames){
+        end = r->target;
+        r->left = 0;
+    } else if (r->shape == PARAM_EXP){
+        end = (float)(r->value * pow(r->step, (double)frames));
+        r->left -= frames;
+    } else {
+        end = (float)(r->value + r->step * (double)frames);
+        r->left -= frames;
+    }
+    *slope = (end - r->value) / (float)frames;
+    r->value = end;
+}
+
+void params_begin_block(params_t *ps, audio_params_t *p, unsigned long frames){
+    param_msg_t msg;
+    while (ringbuf_pop(&ps->queue, &msg, sizeof msg) == sizeof msg){
+        if (msg.id < PARAM_COUNT)
+            start_ramp(&ps->ramp[msg.id], &msg, p->sample_rate);
+    }
+    if (frames == 0)
+        return;
+
+    advance(&ps->ramp[PARAM_GAIN], frames, &p->gain, &p->gain_step);
+    for (int i = 0; i < PARAM_COUNT; i++)
+        atomic_store_explicit(&ps->value[i], ps->ramp[i].value, memory_order_relaxed);
+}
@@ -0,0 +1,60 @@
+#ifndef PARAMS_H
+#define PARAMS_H
+
+#include <stdatomic.h>
+
+#include "audio_types.h"
+#include "ringbuf.h"
+
+#define PARAM_QUEUE_BYTES     (4096)    // 256 pending changes
+#define PARAM_DEFAULT_RAMP_SEC (0.02)   // short enough to feel instant
+
+typedef enum param_id_t{
+    PARAM_GAIN,
+    PARAM_COUNT,
+} param_id_t;
+
+typedef enum param_shape_t{
+    PARAM_LINEAR,
+    PARAM_EXP,      // constant dB per second, linear when an end is <= 0
+} param_shape_t;
+
+typedef struct param_msg_t{
+    unsigned int id;
+    unsigned int shape;
+    float target;
+    float ramp_sec;
+} param_msg_t;
+
+// one smoothed parameter, audio thread only
+typedef struct param_ramp_t{
+    float value;            // at the start of the next block
+    float target;
+    double step;            // per frame: added (linear) or multiplied (exp)
+    unsigned long left;     // frames until target
+    int shape;
+} param_ramp_t;
+
+/* block-rate parameters of the live stream. one producer thread (the TUI,
+ * or whatever drives automation) queues changes, the callback drains the
+ * queue at the top of every block and hands effects a linear per-frame
+ * segment of each ramp. readers on other threads see value[] */
+typedef struct params_t{
+    ringbuf_t queue;
+    _Alignas(64) unsigned char queue_mem[PARAM_QUEUE_BYTES];
+    param_ramp_t ramp[PARAM_COUNT];
+    _Atomic float value[PARAM_COUNT];   // end of the last block
+} params_t;
+
+int params_init(params_t *ps);
+void params_reset(params_t *ps, const audio_params_t *p);
+
+// producer side
+int params_set(params_t *ps, param_id_t id, float target, float ramp_sec,
+        param_shape_t shape);
+float params_get(const params_t *ps, param_id_t id);
+
+// audio thread: drain the queue, write this block's segment into *p
+void params_begin_block(params_t *ps, audio_params_t *p, unsigned long frames);
+
+#endif
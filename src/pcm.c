@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "pcm.h"
+#include "kernels.h"
+
+const pcm_format_t pcm_formats[] = {
+    { "float32", WAVE_FORMAT_IEEE_FLOAT, 32 },
+    { "pcm16",   WAVE_FORMAT_PCM,        16 },
+    { "pcm24",   WAVE_FORMAT_PCM,        24 },
+    { "pcm32",   WAVE_FORMAT_PCM,        32 },
+};
+
+const size_t pcm_formats_count = sizeof(pcm_formats) / sizeof(pcm_formats[0]);
+
+const pcm_format_t *pcm_format_find(const char *name){
+    for (size_t i = 0; i < pcm_formats_count; i++){
+        if (strcasecmp(pcm_formats[i].name, name) == 0)
+            return &pcm_formats[i];
+    }
+    if (strcasecmp(name, "float") == 0 || strcasecmp(name, "f32") == 0)
+        return &pcm_formats[0];
+    if (strcasecmp(name, "s16") == 0)
+        return &pcm_formats[1];
+    if (strcasecmp(name, "s24") == 0)
+        return &pcm_formats[2];
+    if (strcasecmp(name, "s32") == 0)
+        return &pcm_formats[3];
+    return NULL;
+}
+
+const pcm_format_t *pcm_format_float32(void){
+    return &pcm_formats[0];
+}
+
+pcm_encoder_t *pcm_encoder_new(const pcm_format_t *f, int dither){
+    pcm_encoder_t *e = malloc(sizeof *e);
+    if (!e){
+        perror("pcm_encoder_new");
+        return NULL;
+    }
+    e->format = f ? f : pcm_format_float32();
+    // below 32 bits the rounding error is audible on quiet material
+    e->dither = dither && e->format->audio_format == WAVE_FORMAT_PCM && e->format->bits < 32;
+    e->pos = 0;
+    return e;
+}
+
+void pcm_encoder_free(pcm_encoder_t *e){
+    free(e);
+}
+
+void pcm_encoder_seek(pcm_encoder_t *e, uint64_t sample){
+    e->pos = sample;
+}
+
+// splitmix64 finalizer: 64 independent bits per sample index
+static inline uint64_t mix64(uint64_t z){
+    z = (z + 0x9E3779B97F4A7C15ull) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// two uniform [0,1) from one hash, their difference is triangular in (-1,1)
+static void tpdf_fill(float *noise, uint64_t pos, size_t n){
+    const float k = 1.0f / 16777216.0f;
+    for (size_t i = 0; i < n; i++){
+        uint64_t h = mix64(pos + i);
+        noise[i] = (float)(uint32_t)(h >> 40) * k - (float)((uint32_t)h >> 8) * k;
+    }
+}
+
+/* n <= PCM_CHUNK samples into e->out, returns bytes */
+static size_t encode(pcm_encoder_t *e, const SAMPLE *x, size_t n){
+    const int bits = e->format->bits;
+    float scale = bits == 16 ? 32768.0f : bits == 24 ? 8388608.0f : 2147483648.0f;
+    // largest float that still converts into range
+    float max = bits == 16 ? 32767.0f : bits == 24 ? 8388607.0f : 2147483520.0f;
+
+    if (e->dither)
+        tpdf_fill(e->noise, e->pos, n);
+    dsp_kernels()->quantize(x, e->dither ? e->noise : NULL, e->q, n, scale, max);
+    e->pos += n;
+
+    unsigned char *o = e->out;
+    switch (bits){
+    case 16: {
+        int16_t *d = (int16_t *)o;
+        for (size_t i = 0; i < n; i++)
+            d[i] = (int16_t)e->q[i];
+        return n * 2;
+    }
+    case 24:
+        for (size_t i = 0; i < n; i++, o += 3){
+            uint32_t v = (uint32_t)e->q[i];
+            o[0] = (unsigned char)v;
+            o[1] = (unsigned char)(v >> 8);
+            o[2] = (unsigned char)(v >> 16);
+        }
+        return n * 3;
+    default:
+        memcpy(o, e->q, n * 4);
+        return n * 4;
+    }
+}
+
+wav_writer *pcm_wav_open(const char *path, const pcm_format_t *f, int sample_rate,
+        int channels, int flags)
+{
+    if (!f)
+        f = pcm_format_float32();
+    return wav_open_ex(path, f->audio_format, sample_rate, channels, f->bits, flags);
+}
+
+size_t pcm_write(wav_writer *w, pcm_encoder_t *e, const SAMPLE *x, size_t bytes){
+    if (e->format->audio_format == WAVE_FORMAT_IEEE_FLOAT)
+        return wav_write(w, x, bytes);
+
+    size_t n = bytes / sizeof(SAMPLE);
+    size_t done = 0;
+    while (done < n){
+        size_t k = n - done < PCM_CHUNK ? n - done : PCM_CHUNK;
+        size_t ob = encode(e, x + done, k);
+        if (wav_write(w, e->out, ob) != ob)
+            break;
+        done += k;
+    }
+    return done * sizeof(SAMPLE);
+}
+
+/* positional variant for chunked writers: seeks the dither sequence to
+ * the frame first */
+size_t pcm_pwrite(wav_writer *w, pcm_encoder_t *e, const SAMPLE *x, size_t bytes,
+        size_t frame)
+{
+    if (e->format->audio_format == WAVE_FORMAT_IEEE_FLOAT)
+        return wav_pwrite(w, x, bytes, frame);
+
+    const size_t ch = (size_t)w->num_channels;
+    size_t n = bytes / sizeof(SAMPLE);
+    // whole frames per step so the file offset stays frame based
+    size_t step = PCM_CHUNK / ch * ch;
+    size_t done = 0;
+    pcm_encoder_seek(e, (uint64_t)frame * ch);
+    while (done < n){
+        size_t k = n - done < step ? n - done : step;
+        size_t ob = encode(e, x + done, k);
+        if (wav_pwrite(w, e->out, ob, frame + done / ch) != ob)
+            break;
+        done += k;
+    }
+    return done * sizeof(SAMPLE);
+}
@@ -0,0 +1,49 @@
+#ifndef PCM_H
+#define PCM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "audio_types.h"
+#include "wav.h"
+
+#define PCM_CHUNK (4096)    // samples converted per step
+
+/* sample format of a written file */
+typedef struct pcm_format_t{
+    const char *name;
+    int audio_format;   // WAVE_FORMAT_PCM or WAVE_FORMAT_IEEE_FLOAT
+    int bits;
+} pcm_format_t;
+
+extern const pcm_format_t pcm_formats[];
+extern const size_t pcm_formats_count;
+
+const pcm_format_t *pcm_format_find(const char *name);  // NULL if unknown
+const pcm_format_t *pcm_format_float32(void);
+
+/* float -> integer PCM on the writer side: clip, optional TPDF dither
+ * (+-1 LSB triangular) and round with the quantize kernel. the dither
+ * noise is a hash of the sample position, so a file encoded in chunks in
+ * any order comes out identical to a sequential pass */
+typedef struct pcm_encoder_t{
+    const pcm_format_t *format;
+    int dither;
+    uint64_t pos;       // samples encoded so far
+    float noise[PCM_CHUNK];
+    int32_t q[PCM_CHUNK];
+    unsigned char out[PCM_CHUNK * 4];
+} pcm_encoder_t;
+
+pcm_encoder_t *pcm_encoder_new(const pcm_format_t *f, int dither);
+void pcm_encoder_free(pcm_encoder_t *e);
+void pcm_encoder_seek(pcm_encoder_t *e, uint64_t sample);
+
+wav_writer *pcm_wav_open(const char *path, const pcm_format_t *f, int sample_rate,
+        int channels, int flags);
+// float input, bytes a multiple of sizeof(SAMPLE). return input bytes taken
+size_t pcm_write(wav_writer *w, pcm_encoder_t *e, const SAMPLE *x, size_t bytes);
+size_t pcm_pwrite(wav_writer *w, pcm_encoder_t *e, const SAMPLE *x, size_t bytes,
+        size_t frame);
+
+#endif
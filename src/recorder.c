@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "recorder.h"
+#include "ringbuf.h"
+#include "wav.h"
+#include "utils.h"
+
+// how long the writer sleeps when the ring is empty
+#define RECORDER_IDLE_NS (5 * 1000 * 1000)
+
+static void put(recorder_t *r, const SAMPLE *x, size_t frames){
+    size_t bytes = frames * r->frame_bytes;
+    if (r->overview)
+        overview_push(r->overview, x, frames * (size_t)r->channels);
+    if (bytes && pcm_write(r->ww, r->enc, x, bytes) != bytes)
+        atomic_store(&r->write_error, 1);
+}
+
+// the resampler wants whole frames, pop them instead of peeking
+static int drain_resampled(recorder_t *r){
+    size_t frames = ringbuf_read_space(&r->rb) / r->frame_bytes;
+    if (frames == 0)
+        return 0;
+    if (frames > RESAMPLE_CHUNK_FRAMES)
+        frames = RESAMPLE_CHUNK_FRAMES;
+
+    ringbuf_pop(&r->rb, r->rs_in, frames * r->frame_bytes);
+    put(r, r->rs_out, resampler_process(r->rs, r->rs_in, frames, r->rs_out));
+    atomic_store_explicit(&r->frames_written, r->ww->num_samples,
+            memory_order_relaxed);
+    return 1;
+}
+
+static int drain(recorder_t *r){
+    if (r->rs)
+        return drain_resampled(r);
+
+    const void *p1, *p2;
+    size_t n1, n2;
+    size_t avail = ringbuf_peek_regions(&r->rb, &p1, &n1, &p2, &n2);
+    if (avail == 0)
+        return 0;
+
+    // a frame may straddle the wrap point (a sample never does), the
+    // writer and the overview count samples
+    if (r->overview){
+        overview_push(r->overview, p1, n1 / sizeof(SAMPLE));
+        if (n2)
+            overview_push(r->overview, p2, n2 / sizeof(SAMPLE));
+    }
+    if (n1 && pcm_write(r->ww, r->enc, p1, n1) != n1)
+        atomic_store(&r->write_error, 1);
+    if (n2 && pcm_write(r->ww, r->enc, p2, n2) != n2)
+        atomic_store(&r->write_error, 1);
+
+    ringbuf_consume(&r->rb, avail);
+    atomic_store_explicit(&r->frames_written, r->ww->num_samples,
+            memory_order_relaxed);
+    return 1;
+}
+
+static double now_sec(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void *writer_thread(void *arg){
+    recorder_t *r = arg;
+    const struct timespec idle = { 0, RECORDER_IDLE_NS };
+    double last_commit = now_sec();
+
+    while (atomic_load_explicit(&r->running, memory_order_acquire)){
+        if (!drain(r))
+            nanosleep(&idle, NULL);
+
+        // a crash loses at most the last RECORDER_COMMIT_SEC
+        double now = now_sec();
+        if (now - last_commit >= RECORDER_COMMIT_SEC){
+            if (wav_commit(r->ww) < 0)
+                atomic_store(&r->write_error, 1);
+            last_commit = now;
+        }
+    }
+
+    // flush whatever the producer pushed before it was stopped
+    while (drain(r))
+        ;
+    return NULL;
+}
+
+recorder_t *recorder_open(const char *path, int sample_rate, int channels,
+        double buffer_sec, const recorder_opts_t *o)
+{
+    static const recorder_opts_t defaults = { NULL, 1, 0, 0, 0 };
+    if (!o)
+        o = &defaults;
+
+    recorder_t *r = calloc(1, sizeof(recorder_t));
+    if (!r){
+        perror("recorder_open");
+        return NULL;
+    }
+
+    r->sample_rate = sample_rate;
+    r->channels = channels;
+    r->frame_bytes = sizeof(SAMPLE) * (size_t)channels;
+
+    if (buffer_sec <= 0)
+        buffer_sec = RECORDER_DEFAULT_BUFFER_SEC;
+    size_t bytes = (size_t)(buffer_sec * sample_rate) * r->frame_bytes;
+    if (ringbuf_init(&r->rb, bytes) < 0)
+        goto err;
+
+    int file_rate = sample_rate;
+    if (o->rate > 0 && o->rate != sample_rate){
+        file_rate = o->rate;
+        r->rs = resampler_create(sample_rate, file_rate, channels, resample_quality);
+        size_t out = r->rs ? resampler_out_max(r->rs, RESAMPLE_CHUNK_FRAMES > r->rs->taps
+                ? RESAMPLE_CHUNK_FRAMES : r->rs->taps) : 0;
+        r->rs_in = malloc(RESAMPLE_CHUNK_FRAMES * r->frame_bytes);
+        r->rs_out = malloc(out * r->frame_bytes);
+        if (!r->rs || !r->rs_in || !r->rs_out){
+            perror("recorder_open: resampler");
+            goto err;
+        }
+    }
+
+    r->enc = pcm_encoder_new(o->format, o->dither);
+    if (!r->enc)
+        goto err;
+    r->ww = pcm_wav_open(path, o->format, file_rate, channels,
+            WAV_PREALLOC | (o->direct ? WAV_DIRECT : 0));
+    if (!r->ww)
+        goto err;
+    if (o->peaks && !(r->overview = overview_open(path, file_rate, channels))){
+        wav_close(r->ww);
+        goto err;
+    }
+
+    atomic_store(&r->running, 1);
+    if (pthread_create(&r->thread, NULL, writer_thread, r) != 0){
+        perror("recorder_open: pthread_create");
+        wav_close(r->ww);
+        overview_close(r->overview);
+        goto err;
+    }
+    return r;
+
+err:
+    pcm_encoder_free(r->enc);
+    resampler_free(r->rs);
+    free(r->rs_in);
+    free(r->rs_out);
+    ringbuf_free(&r->rb);
+    free(r);
+    return NULL;
+}
+
+/* called from the audio callback: copy only, never blocks */
+int recorder_push(recorder_t *r, const SAMPLE *frames, unsigned long frameCount){
+    size_t bytes = (size_t)frameCount * r->frame_bytes;
+    return ringbuf_push(&r->rb, frames, bytes) == bytes ? 0 : -1;
+}
+
+void recorder_get_stats(recorder_t *r, recorder_stats_t *st){
+    const size_t fb = r->frame_bytes;
+    st->capacity_frames = r->rb.size / fb;
+    st->fill_frames = ringbuf_read_space(&r->rb) / fb;
+    st->high_water_frames = atomic_load(&r->rb.high_water) / fb;
+    st->overruns = atomic_load(&r->rb.overruns);
+    st->dropped_frames = atomic_load(&r->rb.dropped) / fb;
+    st->frames_written = atomic_load(&r->frames_written);
+    st->write_error = atomic_load(&r->write_error);
+}
+
+int recorder_close(recorder_t *r){
+    if (!r)
+        return 0;
+
+    int rc = 0;
+    atomic_store_explicit(&r->running, 0, memory_order_release);
+    pthread_join(r->thread, NULL);
+    // the writer is gone, the tail of the filter is ours to write
+    if (r->rs)
+        put(r, r->rs_out, resampler_flush(r->rs, r->rs_out));
+
+    if (atomic_load(&r->write_error))
+        rc = -1;
+    if (wav_close(r->ww) < 0)
+        rc = -1;
+    if (overview_close(r->overview) < 0)
+        rc = -1;
+
+    pcm_encoder_free(r->enc);
+    resampler_free(r->rs);
+    free(r->rs_in);
+    free(r->rs_out);
+    ringbuf_free(&r->rb);
+    free(r);
+    return rc;
+}
@@ -0,0 +1,62 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "audio_types.h"
+#include "ringbuf.h"
+#include "wav.h"
+#include "pcm.h"
+#include "overview.h"
+#include "resample.h"
+
+#define RECORDER_DEFAULT_BUFFER_SEC (10)
+#define RECORDER_COMMIT_SEC (2)     // header sizes + fdatasync this often
+
+typedef struct recorder_opts_t{
+    const pcm_format_t *format; // NULL: float32
+    int dither;                 // TPDF for pcm16/pcm24
+    int direct;                 // O_DIRECT, keeps long captures out of the page cache
+    int peaks;                  // write the FILE.peaks overview alongside
+    int rate;                   // file rate, 0: the stream's
+} recorder_opts_t;
+
+/* recording pipeline: the audio callback pushes frames into a preallocated
+ * SPSC ring, a writer thread drains it into the wav_writer. a file at
+ * another rate than the stream is resampled on the writer thread */
+typedef struct recorder_t{
+    ringbuf_t rb;
+    wav_writer *ww;
+    pcm_encoder_t *enc;     // float ring -> file format, writer thread only
+    overview_t *overview;   // NULL unless opts.peaks
+    resampler_t *rs;        // NULL unless opts.rate differs
+    SAMPLE *rs_in;          // whole frames popped from the ring
+    SAMPLE *rs_out;
+    pthread_t thread;
+    _Atomic int running;
+    _Atomic int write_error;
+    size_t frame_bytes;
+    int sample_rate;        // of the stream
+    int channels;
+    _Atomic unsigned long long frames_written;
+} recorder_t;
+
+typedef struct recorder_stats_t{
+    size_t capacity_frames;
+    size_t fill_frames;
+    size_t high_water_frames;
+    unsigned long overruns;
+    unsigned long long dropped_frames;
+    unsigned long long frames_written;
+    int write_error;
+} recorder_stats_t;
+
+recorder_t *recorder_open(const char *path, int sample_rate, int channels,
+        double buffer_sec, const recorder_opts_t *o);
+int recorder_push(recorder_t *r, const SAMPLE *frames, unsigned long frameCount);
+void recorder_get_stats(recorder_t *r, recorder_stats_t *st);
+int recorder_close(recorder_t *r);
+
+#endif
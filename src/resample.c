@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "resample.h"
+#include "kernels.h"
+
+int resample_quality = RESAMPLE_BEST;
+
+/* taps at 1:1 and the Kaiser beta; cutoff is the middle of the transition
+ * band as a fraction of the lower Nyquist. best keeps 0..19.5 kHz flat at
+ * 44.1 kHz with about 100 dB of stop band */
+static const struct {
+    const char *name;
+    size_t taps;
+    double beta;
+    double cutoff;
+} qualities[RESAMPLE_QUALITIES] = {
+    { "fast",    16,  5.0, 0.80  },
+    { "medium",  48,  8.0, 0.89  },
+    { "best",   128, 11.0, 0.945 },
+};
+
+int resample_quality_find(const char *name){
+    for (int i = 0; i < RESAMPLE_QUALITIES; i++)
+        if (strcmp(name, qualities[i].name) == 0)
+            return i;
+    return -1;
+}
+
+const char *resample_quality_name(int quality){
+    return quality >= 0 && quality < RESAMPLE_QUALITIES ? qualities[quality].name : "?";
+}
+
+static unsigned long gcd(unsigned long a, unsigned long b){
+    while (b){
+        unsigned long t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static double bessel_i0(double x){
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; k++){
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+/* row p is the sinc centered p / rows of a frame past tap half - 1, each
+ * row scaled to a DC gain of exactly 1 */
+static void design(resampler_t *r, double cutoff, double beta){
+    const double half = (double)(r->taps / 2);
+    for (size_t p = 0; p <= r->rows; p++){
+        float *row = r->coef + p * r->taps;
+        double f = (double)p / (double)r->rows, sum = 0.0;
+        double c[r->taps];
+        for (size_t k = 0; k < r->taps; k++){
+            double d = (double)k - (half - 1.0) - f;
+            double t = d / half;
+            double w = bessel_i0(beta * sqrt(fmax(0.0, 1.0 - t * t))) / bessel_i0(beta);
+            double x = M_PI * cutoff * d;
+            c[k] = (fabs(x) < 1e-12 ? 1.0 : sin(x) / x) * w;
+            sum += c[k];
+        }
+        for (size_t k = 0; k < r->taps; k++)
+            row[k] = (float)(c[k] / sum);
+    }
+}
+
+void resampler_reset(resampler_t *r){
+    memset(r->line, 0, sizeof(float) * r->line_len * r->channels);
+    // taps / 2 - 1 frames of silence before the first input frame
+    r->fill = r->taps / 2 - 1;
+    r->start = 0;
+    r->frac = 0;
+    r->frames_in = 0;
+    r->frames_out = 0;
+}
+
+resampler_t *resampler_create(int in_rate, int out_rate, int channels, int quality){
+    if (in_rate <= 0 || out_rate <= 0 || channels < 1 || channels > MAX_CHANNELS
+            || quality < 0 || quality >= RESAMPLE_QUALITIES
+            || in_rate > RESAMPLE_MAX_RATIO * out_rate
+            || out_rate > RESAMPLE_MAX_RATIO * in_rate){
+        fprintf(stderr, "resample: cannot convert %d Hz to %d Hz\n", in_rate, out_rate);
+        return NULL;
+    }
+
+    resampler_t *r = calloc(1, sizeof *r);
+    if (!r){
+        perror("resample: malloc");
+        return NULL;
+    }
+    unsigned long g = gcd((unsigned long)in_rate, (unsigned long)out_rate);
+    r->in_rate = in_rate;
+    r->out_rate = out_rate;
+    r->channels = channels;
+    r->quality = quality;
+    r->up = (unsigned long)out_rate / g;
+    r->down = (unsigned long)in_rate / g;
+
+    // going down the filter narrows, the same stop band takes more taps
+    double scale = r->down > r->up ? (double)r->down / r->up : 1.0;
+    r->taps = ((size_t)ceil(qualities[quality].taps * scale) + 7) & ~(size_t)7;
+    r->blend = r->up > RESAMPLE_MAX_PHASES;
+    r->rows = r->blend ? RESAMPLE_MAX_PHASES : r->up;
+
+    // a pass leaves less than one output step of input behind
+    r->line_len = 2 * r->taps + (size_t)ceil(scale) + RESAMPLE_CHUNK_FRAMES;
+    r->out_chunk = (size_t)(RESAMPLE_CHUNK_FRAMES * r->up / r->down) + 2;
+
+    r->coef = malloc(sizeof(float) * (r->rows + 1) * r->taps);
+    r->line = malloc(sizeof(float) * r->line_len * channels);
+    r->at = malloc(sizeof(size_t) * r->out_chunk);
+    r->c0 = malloc(sizeof(float *) * r->out_chunk);
+    r->c1 = malloc(sizeof(float *) * r->out_chunk);
+    r->w = malloc(sizeof(float) * r->out_chunk);
+    r->y0 = malloc(sizeof(float) * r->out_chunk * channels);
+    r->y1 = malloc(sizeof(float) * r->out_chunk * channels);
+    if (!r->coef || !r->line || !r->at || !r->c0 || !r->c1 || !r->w || !r->y0 || !r->y1){
+        perror("resample: malloc");
+        resampler_free(r);
+        return NULL;
+    }
+
+    double cutoff = qualities[quality].cutoff / scale;
+    design(r, cutoff, qualities[quality].beta);
+    resampler_reset(r);
+    return r;
+}
+
+void resampler_free(resampler_t *r){
+    if (!r)
+        return;
+    free(r->coef);
+    free(r->line);
+    free(r->at);
+    free(r->c0);
+    free(r->c1);
+    free(r->w);
+    free(r->y0);
+    free(r->y1);
+    free(r);
+}
+
+size_t resampler_out_max(const resampler_t *r, size_t frames){
+    return (size_t)((unsigned long long)frames * r->up / r->down) + 2;
+}
+
+double resampler_latency(const resampler_t *r){
+    return (double)(r->taps / 2);
+}
+
+/* up to RESAMPLE_CHUNK_FRAMES new frames (silence for in == NULL), then
+ * every output whose taps are all in the lines */
+static size_t pass(resampler_t *r, const SAMPLE *in, size_t frames, SAMPLE *out){
+    const dsp_kernels_t *k = dsp_kernels();
+    const int ch = r->channels;
+    float *lines[MAX_CHANNELS], *ys[MAX_CHANNELS];
+
+    for (int c = 0; c < ch; c++)
+        lines[c] = r->line + c * r->line_len + r->fill;
+    if (in){
+        k->deinterleave(in, lines, frames, ch);
+    } else {
+        for (int c = 0; c < ch; c++)
+            memset(lines[c], 0, sizeof(float) * frames);
+    }
+    r->fill += frames;
+
+    size_t n = 0;
+    while (r->start + r->taps <= r->fill){
+        if (r->blend){
+            unsigned long long pos = (unsigned long long)r->frac * r->rows;
+            size_t row = (size_t)(pos / r->up);
+            r->c0[n] = r->coef + row * r->taps;
+            r->c1[n] = r->c0[n] + r->taps;
+            r->w[n] = (float)(pos % r->up) / (float)r->up;
+        } else {
+            r->c0[n] = r->coef + r->frac * r->taps;
+        }
+        r->at[n++] = r->start;
+        r->frac += r->down;
+        r->start += r->frac / r->up;
+        r->frac %= r->up;
+    }
+
+    for (int c = 0; c < ch; c++){
+        const float *x = r->line + c * r->line_len;
+        float *y = ys[c] = r->y0 + c * r->out_chunk;
+        k->poly_fir(x, r->at, r->c0, y, n, r->taps);
+        if (r->blend){
+            float *y1 = r->y1 + c * r->out_chunk;
+            k->poly_fir(x, r->at, r->c1, y1, n, r->taps);
+            for (size_t j = 0; j < n; j++)
+                y[j] = y[j] + r->w[j] * (y1[j] - y[j]);
+        }
+    }
+    k->interleave((const float *const *)ys, out, n, ch);
+
+    // keep what the next output still needs
+    size_t drop = r->start < r->fill ? r->start : r->fill;
+    for (int c = 0; c < ch; c++){
+        float *x = r->line + c * r->line_len;
+        memmove(x, x + drop, sizeof(float) * (r->fill - drop));
+    }
+    r->fill -= drop;
+    r->start -= drop;
+    r->frames_out += n;
+    return n;
+}
+
+size_t resampler_process(resampler_t *r, const SAMPLE *in, size_t frames, SAMPLE *out){
+    size_t done = 0;
+    for (size_t off = 0; off < frames; off += RESAMPLE_CHUNK_FRAMES){
+        size_t n = frames - off < RESAMPLE_CHUNK_FRAMES ? frames - off : RESAMPLE_CHUNK_FRAMES;
+        done += pass(r, in + off * r->channels, n, out + done * r->channels);
+    }
+    r->frames_in += frames;
+    return done;
+}
+
+size_t resampler_flush(resampler_t *r, SAMPLE *out){
+    size_t done = 0;
+    for (size_t left = r->taps / 2; left > 0; ){
+        size_t n = left < RESAMPLE_CHUNK_FRAMES ? left : RESAMPLE_CHUNK_FRAMES;
+        done += pass(r, NULL, n, out + done * r->channels);
+        left -= n;
+    }
+    return done;
+}
@@ -0,0 +1,73 @@
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include <stddef.h>
+
+#include "audio_types.h"
+
+#define RESAMPLE_CHUNK_FRAMES (1024)    // input frames per pass
+#define RESAMPLE_MAX_PHASES   (512)     // above: blend the two nearest rows
+#define RESAMPLE_MAX_RATIO    (16)
+
+typedef enum resample_quality_t{
+    RESAMPLE_FAST,
+    RESAMPLE_MEDIUM,
+    RESAMPLE_BEST,
+    RESAMPLE_QUALITIES,
+} resample_quality_t;
+
+/* streaming windowed-sinc rate converter, out / in = up / down in lowest
+ * terms. output j sits at input time j * down / up and takes its taps from
+ * the row of the table for that fraction: one row per phase when up is
+ * small (44.1 <-> 48 kHz is 147 / 160), otherwise RESAMPLE_MAX_PHASES rows
+ * and a linear blend of the two around it. the output is not delayed:
+ * input frame i and output frame i * up / down are the same instant, the
+ * last taps / 2 input frames only come out of resampler_flush */
+typedef struct resampler_t{
+    int in_rate;
+    int out_rate;
+    int channels;
+    int quality;
+    unsigned long up;
+    unsigned long down;
+    size_t taps;            // per row, a multiple of 8
+    size_t rows;            // phases in the table, + 1 row for the blend
+    int blend;
+    float *coef;            // (rows + 1) * taps
+    float *line;            // per channel: history, then the new input
+    size_t line_len;
+    size_t fill;            // samples in each line
+    size_t start;           // first tap of the next output in the line
+    unsigned long frac;     // and how far past it, in 1 / up input frames
+    size_t out_chunk;       // outputs of one pass at most
+    size_t *at;
+    const float **c0;
+    const float **c1;
+    float *w;
+    float *y0;              // planar outputs, channels * out_chunk
+    float *y1;
+    unsigned long long frames_in;
+    unsigned long long frames_out;
+} resampler_t;
+
+extern int resample_quality;    // --src-quality, for every conversion
+
+int resample_quality_find(const char *name);
+const char *resample_quality_name(int quality);
+
+resampler_t *resampler_create(int in_rate, int out_rate, int channels, int quality);
+void resampler_free(resampler_t *r);
+void resampler_reset(resampler_t *r);
+
+// output frames one call with this much input can make at most
+size_t resampler_out_max(const resampler_t *r, size_t frames);
+// input frames still inside the filter when streaming
+double resampler_latency(const resampler_t *r);
+
+// returns output frames written to out
+size_t resampler_process(resampler_t *r, const SAMPLE *in, size_t frames, SAMPLE *out);
+// the tail: the total output is then ceil(frames in * up / down). out
+// holds resampler_out_max(r, r->taps / 2) frames
+size_t resampler_flush(resampler_t *r, SAMPLE *out);
+
+#endif
@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "ringbuf.h"
+
+static size_t next_pow2(size_t v){
+    size_t p = 1;
+    while (p < v)
+        p <<= 1;
+    return p;
+}
+
+int ringbuf_init(ringbuf_t *rb, size_t size){
+    memset(rb, 0, sizeof *rb);
+    if (size == 0)
+        return -1;
+
+    size = next_pow2(size);
+    rb->buf = aligned_alloc(RINGBUF_CACHELINE, size < RINGBUF_CACHELINE ? RINGBUF_CACHELINE : size);
+    if (!rb->buf){
+        perror("ringbuf_init");
+        return -1;
+    }
+    // touch every page now so the producer never faults on first use
+    memset(rb->buf, 0, size);
+
+    rb->size = size;
+    rb->mask = size - 1;
+    ringbuf_reset(rb);
+    return 0;
+}
+
+/* over caller memory, size a power of two. do not ringbuf_free it */
+int ringbuf_init_mem(ringbuf_t *rb, void *mem, size_t size){
+    memset(rb, 0, sizeof *rb);
+    if (size == 0 || (size & (size - 1)) != 0)
+        return -1;
+
+    rb->buf = mem;
+    rb->size = size;
+    rb->mask = size - 1;
+    ringbuf_reset(rb);
+    return 0;
+}
+
+void ringbuf_free(ringbuf_t *rb){
+    free(rb->buf);
+    rb->buf = NULL;
+    rb->size = rb->mask = 0;
+}
+
+void ringbuf_reset(ringbuf_t *rb){
+    atomic_store(&rb->head, 0);
+    atomic_store(&rb->tail, 0);
+    atomic_store(&rb->high_water, 0);
+    atomic_store(&rb->overruns, 0);
+    atomic_store(&rb->dropped, 0);
+}
+
+size_t ringbuf_read_space(const ringbuf_t *rb){
+    size_t head = atomic_load_explicit(&((ringbuf_t *)rb)->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&((ringbuf_t *)rb)->tail, memory_order_relaxed);
+    return head - tail;
+}
+
+size_t ringbuf_write_space(const ringbuf_t *rb){
+    size_t head = atomic_load_explicit(&((ringbuf_t *)rb)->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&((ringbuf_t *)rb)->tail, memory_order_acquire);
+    return rb->size - (head - tail);
+}
+
+size_t ringbuf_push(ringbuf_t *rb, const void *data, size_t bytes){
+    size_t head = atomic_load_explicit(&rb->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&rb->tail, memory_order_acquire);
+    size_t used = head - tail;
+
+    if (bytes > rb->size - used){
+        atomic_fetch_add_explicit(&rb->overruns, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&rb->dropped, bytes, memory_order_relaxed);
+        return 0;
+    }
+
+    size_t off = head & rb->mask;
+    size_t first = rb->size - off;
+    if (first > bytes)
+        first = bytes;
+    memcpy(rb->buf + off, data, first);
+    memcpy(rb->buf, (const unsigned char *)data + first, bytes - first);
+
+    atomic_store_explicit(&rb->head, head + bytes, memory_order_release);
+
+    used += bytes;
+    if (used > atomic_load_explicit(&rb->high_water, memory_order_relaxed))
+        atomic_store_explicit(&rb->high_water, used, memory_order_relaxed);
+    return bytes;
+}
+
+size_t ringbuf_peek_regions(ringbuf_t *rb, const void **p1, size_t *n1,
+        const void **p2, size_t *n2){
+    size_t avail = ringbuf_read_space(rb);
+    size_t tail = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+    size_t off = tail & rb->mask;
+    size_t first = rb->size - off;
+    if (first > avail)
+        first = avail;
+
+    *p1 = rb->buf + off;
+    *n1 = first;
+    *p2 = rb->buf;
+    *n2 = avail - first;
+    return avail;
+}
+
+void ringbuf_consume(ringbuf_t *rb, size_t bytes){
+    size_t tail = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+    atomic_store_explicit(&rb->tail, tail + bytes, memory_order_release);
+}
+
+size_t ringbuf_pop(ringbuf_t *rb, void *dst, size_t bytes){
+    const void *p1, *p2;
+    size_t n1, n2;
+    size_t avail = ringbuf_peek_regions(rb, &p1, &n1, &p2, &n2);
+    if (bytes > avail)
+        bytes = avail;
+
+    size_t first = bytes < n1 ? bytes : n1;
+    memcpy(dst, p1, first);
+    memcpy((unsigned char *)dst + first, p2, bytes - first);
+
+    ringbuf_consume(rb, bytes);
+    return bytes;
+}
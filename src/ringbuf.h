@@ -0,0 +1,42 @@
+#ifndef RINGBUF_H
+#define RINGBUF_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+#define RINGBUF_CACHELINE (64)
+
+/* single-producer/single-consumer lock-free byte ring.
+ * size is rounded up to a power of two, memory is allocated once in
+ * ringbuf_init, push/pop never allocate or block. */
+typedef struct ringbuf_t{
+    unsigned char *buf;
+    size_t size;
+    size_t mask;
+
+    _Alignas(RINGBUF_CACHELINE) _Atomic size_t head; // producer position
+    _Alignas(RINGBUF_CACHELINE) _Atomic size_t tail; // consumer position
+
+    _Alignas(RINGBUF_CACHELINE) _Atomic size_t high_water; // max fill seen, bytes
+    _Atomic unsigned long overruns;     // pushes rejected for lack of space
+    _Atomic unsigned long long dropped; // bytes lost to overruns
+} ringbuf_t;
+
+int ringbuf_init(ringbuf_t *rb, size_t size);
+int ringbuf_init_mem(ringbuf_t *rb, void *mem, size_t size);
+void ringbuf_free(ringbuf_t *rb);
+void ringbuf_reset(ringbuf_t *rb);
+
+size_t ringbuf_read_space(const ringbuf_t *rb);
+size_t ringbuf_write_space(const ringbuf_t *rb);
+
+// producer side. all or nothing: returns bytes or 0 on overrun
+size_t ringbuf_push(ringbuf_t *rb, const void *data, size_t bytes);
+
+// consumer side
+size_t ringbuf_pop(ringbuf_t *rb, void *dst, size_t bytes);
+size_t ringbuf_peek_regions(ringbuf_t *rb, const void **p1, size_t *n1,
+        const void **p2, size_t *n2);
+void ringbuf_consume(ringbuf_t *rb, size_t bytes);
+
+#endif
@@ -0,0 +1,246 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "spectrum.h"
+#include "ringbuf.h"
+#include "cbstats.h"
+#include "fft.h"
+
+#define SPECTRUM_IDLE_NS  (5 * 1000 * 1000)
+#define SPECTRUM_MIN_HZ   (20.0f)
+
+// dark to hot, xterm 256-color indices
+static const unsigned char heat[] = {
+    16, 17, 18, 19, 20, 56, 92, 128, 164, 200, 199, 203, 208, 214, 220, 226, 229, 231,
+};
+static const int heat_count = sizeof(heat) / sizeof(heat[0]);
+
+static void analyze(spectrum_t *s){
+    const size_t n = s->size, hop = s->hop, bins = s->bins;
+    const int ch = s->channels;
+
+    memset(s->power, 0, sizeof(float) * bins);
+    for (int c = 0; c < ch; c++){
+        float *h = s->hist + (size_t)c * n;
+        memmove(h, h + hop, sizeof(float) * (n - hop));
+        for (size_t i = 0; i < hop; i++)
+            h[n - hop + i] = s->block[i * ch + c];
+
+        for (size_t i = 0; i < n; i++)
+            s->frame[i] = h[i] * s->window[i];
+        fft_forward(&s->fft, s->frame, s->re, s->im);
+        for (size_t k = 0; k < bins; k++)
+            s->power[k] += s->re[k] * s->re[k] + s->im[k] * s->im[k];
+    }
+
+    // full scale sine -> 0 dB: |X| = A * sum(w) / 2 = A * n / 4 for Hann
+    const float norm = 16.0f / ((float)n * (float)n * (float)ch);
+    pthread_mutex_lock(&s->lock);
+    for (size_t k = 0; k < bins; k++){
+        float p = s->power[k] * norm;
+        float d = p > 1e-20f ? 10.0f * log10f(p) : SPECTRUM_FLOOR_DB;
+        s->db[k] = d < SPECTRUM_FLOOR_DB ? SPECTRUM_FLOOR_DB : d;
+    }
+    s->seq++;
+    pthread_mutex_unlock(&s->lock);
+}
+
+static void *analysis_thread(void *arg){
+    spectrum_t *s = arg;
+    const struct timespec idle = { 0, SPECTRUM_IDLE_NS };
+    const size_t hop_bytes = s->hop * (size_t)s->channels * sizeof(SAMPLE);
+
+    while (atomic_load_explicit(&s->running, memory_order_acquire)){
+        if (ringbuf_read_space(&s->tap) < hop_bytes){
+            nanosleep(&idle, NULL);
+            continue;
+        }
+        ringbuf_pop(&s->tap, s->block, hop_bytes);
+
+        uint64_t t0 = cbstats_now_ns();
+        analyze(s);
+        atomic_fetch_add_explicit(&s->fft_ns, cbstats_now_ns() - t0, memory_order_relaxed);
+        atomic_fetch_add_explicit(&s->fft_count, 1, memory_order_relaxed);
+    }
+    return NULL;
+}
+
+static float *alloc_floats(size_t n){
+    return calloc(n, sizeof(float));
+}
+
+spectrum_t *spectrum_open(size_t size, int sample_rate, int channels){
+    if (size == 0)
+        size = SPECTRUM_DEFAULT_SIZE;
+
+    spectrum_t *s = calloc(1, sizeof(spectrum_t));
+    if (!s){
+        perror("spectrum_open");
+        return NULL;
+    }
+    if (fft_init(&s->fft, size) < 0){
+        free(s);
+        return NULL;
+    }
+
+    s->sample_rate = sample_rate;
+    s->channels = channels;
+    s->size = size;
+    s->hop = size / SPECTRUM_OVERLAP;
+    s->bins = size / 2 + 1;
+
+    s->window = alloc_floats(size);
+    s->hist = alloc_floats(size * (size_t)channels);
+    s->block = alloc_floats(s->hop * (size_t)channels);
+    s->frame = alloc_floats(size);
+    s->re = alloc_floats(s->bins);
+    s->im = alloc_floats(s->bins);
+    s->power = alloc_floats(s->bins);
+    s->db = alloc_floats(s->bins);
+    if (!s->window || !s->hist || !s->block || !s->frame || !s->re || !s->im
+            || !s->power || !s->db){
+        perror("spectrum_open");
+        goto err;
+    }
+    fft_window_hann(s->window, size);
+    for (size_t k = 0; k < s->bins; k++)
+        s->db[k] = SPECTRUM_FLOOR_DB;
+
+    size_t tap_bytes = (size_t)SPECTRUM_TAP_SEC * sample_rate * channels * sizeof(SAMPLE);
+    if (tap_bytes < 4 * s->hop * channels * sizeof(SAMPLE))
+        tap_bytes = 4 * s->hop * channels * sizeof(SAMPLE);
+    if (ringbuf_init(&s->tap, tap_bytes) < 0)
+        goto err;
+
+    pthread_mutex_init(&s->lock, NULL);
+    atomic_store(&s->running, 1);
+    if (pthread_create(&s->thread, NULL, analysis_thread, s) != 0){
+        perror("spectrum_open: pthread_create");
+        pthread_mutex_destroy(&s->lock);
+        ringbuf_free(&s->tap);
+        goto err;
+    }
+    return s;
+
+err:
+    free(s->window); free(s->hist); free(s->block); free(s->frame);
+    free(s->re); free(s->im); free(s->power); free(s->db);
+    fft_free(&s->fft);
+    free(s);
+    return NULL;
+}
+
+/* called from the audio callback: copy only, a full tap drops the block */
+int spectrum_push(spectrum_t *s, const SAMPLE *frames, unsigned long frameCount){
+    size_t bytes = (size_t)frameCount * s->channels * sizeof(SAMPLE);
+    return ringbuf_push(&s->tap, frames, bytes) == bytes ? 0 : -1;
+}
+
+/* copies the latest bins into db, returns the analysis sequence number */
+unsigned long spectrum_snapshot(spectrum_t *s, float *db){
+    pthread_mutex_lock(&s->lock);
+    memcpy(db, s->db, sizeof(float) * s->bins);
+    unsigned long seq = s->seq;
+    pthread_mutex_unlock(&s->lock);
+    return seq;
+}
+
+void spectrum_close(spectrum_t *s){
+    if (!s)
+        return;
+    atomic_store_explicit(&s->running, 0, memory_order_release);
+    pthread_join(s->thread, NULL);
+    pthread_mutex_destroy(&s->lock);
+
+    ringbuf_free(&s->tap);
+    free(s->window); free(s->hist); free(s->block); free(s->frame);
+    free(s->re); free(s->im); free(s->power); free(s->db);
+    fft_free(&s->fft);
+    free(s);
+}
+
+/* log-spaced columns from 20 Hz to nyquist, each the max of its bins */
+static void columns(const spectrum_t *s, const float *db, float *col, int width){
+    const float nyq = 0.5f * (float)s->sample_rate;
+    const float hz_per_bin = (float)s->sample_rate / (float)s->size;
+    const float ratio = logf(nyq / SPECTRUM_MIN_HZ);
+
+    for (int x = 0; x < width; x++){
+        float f0 = SPECTRUM_MIN_HZ * expf(ratio * (float)x / (float)width);
+        float f1 = SPECTRUM_MIN_HZ * expf(ratio * (float)(x + 1) / (float)width);
+        size_t k0 = (size_t)(f0 / hz_per_bin);
+        size_t k1 = (size_t)(f1 / hz_per_bin);
+        if (k0 >= s->bins) k0 = s->bins - 1;
+        if (k1 >= s->bins) k1 = s->bins - 1;
+
+        float m = db[k0];
+        for (size_t k = k0 + 1; k <= k1; k++)
+            if (db[k] > m) m = db[k];
+        col[x] = m;
+    }
+}
+
+static float level01(float db){
+    float v = (db - SPECTRUM_FLOOR_DB) / -SPECTRUM_FLOOR_DB;
+    if (v < 0.0f) return 0.0f;
+    if (v > 1.0f) return 1.0f;
+    return v;
+}
+
+void spectrum_render_bars(spectrum_t *s, FILE *out, int width, int height){
+    float db[s->bins];
+    float col[width];
+    spectrum_snapshot(s, db);
+    columns(s, db, col, width);
+
+    // the cursor is left below the graph, go back to its top
+    if (s->drawn)
+        fprintf(out, "\033[%dA", height + 1);
+    s->drawn = 1;
+
+    for (int y = height; y > 0; y--){
+        fputc('|', out);
+        for (int x = 0; x < width; x++){
+            float v = level01(col[x]) * (float)height;
+            fputc(v >= (float)y ? '#' : (v > (float)y - 0.5f ? '.' : ' '), out);
+        }
+        fprintf(out, "| %4.0f dB\n", SPECTRUM_FLOOR_DB * (1.0f - (float)y / (float)height) + 0.0f);
+    }
+    fprintf(out, " 20 Hz%*s%.1f kHz  cntrl + c to stop\n", width - 10, "",
+            0.0005f * (float)s->sample_rate);
+    fflush(out);
+}
+
+/* prints a row for a new analysis if there is one, returns 1 if printed */
+int spectrum_render_gram(spectrum_t *s, FILE *out, int width, unsigned long *last_seq){
+    float db[s->bins];
+    float col[width];
+    unsigned long seq = spectrum_snapshot(s, db);
+    if (seq == *last_seq)
+        return 0;
+    *last_seq = seq;
+    columns(s, db, col, width);
+
+    for (int x = 0; x < width; x++){
+        int i = (int)(level01(col[x]) * (float)(heat_count - 1) + 0.5f);
+        fprintf(out, "\033[48;5;%dm ", heat[i]);
+    }
+    fprintf(out, "\033[0m\n");
+    fflush(out);
+    return 1;
+}
+
+void spectrum_fprint_cost(spectrum_t *s, FILE *out){
+    unsigned long n = atomic_load(&s->fft_count);
+    if (n == 0)
+        return;
+    double us = (double)atomic_load(&s->fft_ns) / (double)n / 1000.0;
+    double per_sec = (double)s->sample_rate / (double)s->hop;
+    fprintf(out, "spectrum: %zu points x %d ch, %lu analyses, %.1f us each, "
+            "%.2f%% of one core\n", s->size, s->channels, n, us, us * per_sec / 1e4);
+}
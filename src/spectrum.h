@@ -0,0 +1,60 @@
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include <stdio.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "audio_types.h"
+#include "ringbuf.h"
+#include "fft.h"
+
+#define SPECTRUM_DEFAULT_SIZE (4096)
+#define SPECTRUM_OVERLAP      (4)      // hop = size / 4, 75% overlap
+#define SPECTRUM_TAP_SEC      (1)
+#define SPECTRUM_FLOOR_DB     (-96.0f)
+
+/* live spectrum analyzer: the audio callback copies frames into the tap
+ * ring, an analysis thread runs a Hann-windowed FFT per channel every hop
+ * and publishes the power-averaged magnitude in dBFS */
+typedef struct spectrum_t{
+    ringbuf_t tap;
+    fft_t fft;
+    int sample_rate;
+    int channels;
+    size_t size;        // FFT points
+    size_t hop;         // frames between analyses
+    size_t bins;        // size / 2 + 1
+
+    // analysis thread only
+    float *window;
+    float *hist;        // channels * size, per-channel sliding input
+    float *block;       // hop * channels interleaved, popped from the tap
+    float *frame;       // size, windowed
+    float *re, *im;     // bins
+    float *power;       // bins
+
+    pthread_t thread;
+    _Atomic int running;
+
+    pthread_mutex_t lock;   // guards db and seq
+    float *db;              // bins, latest analysis
+    unsigned long seq;      // analyses published
+
+    int drawn;              // TUI: bars already on screen
+
+    _Atomic unsigned long long fft_ns;     // total analysis time
+    _Atomic unsigned long fft_count;
+} spectrum_t;
+
+spectrum_t *spectrum_open(size_t size, int sample_rate, int channels);
+int spectrum_push(spectrum_t *s, const SAMPLE *frames, unsigned long frameCount);
+unsigned long spectrum_snapshot(spectrum_t *s, float *db);
+void spectrum_close(spectrum_t *s);
+
+// ANSI rendering: bars redraws in place, gram prints one row per analysis
+void spectrum_render_bars(spectrum_t *s, FILE *out, int width, int height);
+int spectrum_render_gram(spectrum_t *s, FILE *out, int width, unsigned long *last_seq);
+void spectrum_fprint_cost(spectrum_t *s, FILE *out);
+
+#endif
@@ -0,0 +1,243 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "tap.h"
+#include "chain.h"
+#include "utils.h"
+
+#define TAP_HEADER_SIZE (4096)  // the ring starts page aligned
+
+static size_t block_bytes(unsigned long frames, int channels){
+    size_t n = sizeof(tap_block_t) + sizeof(float) * frames * (size_t)channels;
+    return (n + TAP_ALIGN - 1) & ~(size_t)(TAP_ALIGN - 1);
+}
+
+/* create (or take over) the shared memory ring. everything is mapped,
+ * faulted in and locked here so the callback never touches the kernel */
+tap_t *tap_open(const char *name, size_t size){
+    size_t ring = TAP_ALIGN * 4;
+    while (ring < size)
+        ring <<= 1;
+
+    tap_t *t = calloc(1, sizeof *t);
+    if (!t){
+        perror("malloc");
+        return NULL;
+    }
+    snprintf(t->name, sizeof t->name, "%s", name);
+    t->map_size = TAP_HEADER_SIZE + ring;
+
+    int fd = shm_open(name, O_RDWR | O_CREAT, 0600);
+    if (fd < 0){
+        fprintf(stderr, "tap: %s: %s\n", name, strerror(errno));
+        free(t);
+        return NULL;
+    }
+    if (ftruncate(fd, (off_t)t->map_size) < 0){
+        perror("tap: ftruncate");
+        close(fd);
+        shm_unlink(name);
+        free(t);
+        return NULL;
+    }
+    void *mem = mmap(NULL, t->map_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED){
+        perror("tap: mmap");
+        shm_unlink(name);
+        free(t);
+        return NULL;
+    }
+    if (mlock(mem, t->map_size) < 0)
+        DEBUG_PRINTF("tap: mlock: %s\n", strerror(errno));
+
+    memset(mem, 0, t->map_size);
+    t->shm = mem;
+    t->ring = (unsigned char *)mem + TAP_HEADER_SIZE;
+    t->shm->version = TAP_VERSION;
+    t->shm->header_size = TAP_HEADER_SIZE;
+    t->shm->block_header_size = sizeof(tap_block_t);
+    t->shm->size = ring;
+    atomic_store(&t->shm->head, 0);
+    atomic_store(&t->shm->reserve, 0);
+    // readers check the magic last
+    atomic_thread_fence(memory_order_release);
+    t->shm->magic = TAP_MAGIC;
+    return t;
+}
+
+void tap_close(tap_t *t){
+    if (!t)
+        return;
+    munmap(t->shm, t->map_size);
+    shm_unlink(t->name);
+    free(t);
+}
+
+/* audio callback only: one header and one memcpy into the mapping.
+ * the reserve counter moves first, a reader that sees it pass its block
+ * drops what it read (seqlock style), so the writer never waits */
+void tap_write(tap_t *t, int point, const SAMPLE *x, unsigned long frames,
+        int channels, int sample_rate, uint64_t time_ns)
+{
+    const uint64_t size = t->shm->size;
+    size_t bytes = block_bytes(frames, channels);
+    if (bytes > size / 2)
+        return;
+
+    uint64_t head = atomic_load_explicit(&t->shm->head, memory_order_relaxed);
+    size_t off = head & (size - 1);
+    size_t room = size - off;
+    uint64_t need = room < bytes ? room + bytes : bytes;
+
+    atomic_store_explicit(&t->shm->reserve, head + need, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    if (room < bytes){
+        // the block would wrap, mark the tail unused and start over
+        uint32_t pad[2] = { TAP_PAD_MAGIC, (uint32_t)room };
+        memcpy(t->ring + off, pad, sizeof pad);
+        head += room;
+        off = 0;
+    }
+
+    tap_block_t h = {
+        .magic = TAP_BLOCK_MAGIC,
+        .bytes = (uint32_t)bytes,
+        .seq = t->seq++,
+        .frame = t->frame,
+        .time_ns = time_ns,
+        .point = (uint16_t)point,
+        .channels = (uint16_t)channels,
+        .frames = (uint32_t)frames,
+        .sample_rate = (uint32_t)sample_rate,
+    };
+    memcpy(t->ring + off, &h, sizeof h);
+    memcpy(t->ring + off + sizeof h, x, sizeof(float) * frames * (size_t)channels);
+
+    atomic_store_explicit(&t->shm->head, head + bytes, memory_order_release);
+}
+
+int tap_reader_open(tap_reader_t *r, const char *name){
+    memset(r, 0, sizeof *r);
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0){
+        fprintf(stderr, "tap: %s: %s (is \"tap\" on in wavecli?)\n", name, strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < TAP_HEADER_SIZE){
+        fprintf(stderr, "tap: %s: not a tap ring\n", name);
+        close(fd);
+        return -1;
+    }
+    void *mem = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED){
+        perror("tap: mmap");
+        return -1;
+    }
+
+    const tap_shm_t *shm = mem;
+    if (shm->magic != TAP_MAGIC || shm->version != TAP_VERSION
+            || shm->header_size + shm->size > (uint64_t)st.st_size){
+        fprintf(stderr, "tap: %s: bad header\n", name);
+        munmap(mem, (size_t)st.st_size);
+        return -1;
+    }
+    r->shm = shm;
+    r->ring = (const unsigned char *)mem + shm->header_size;
+    r->map_size = (size_t)st.st_size;
+    // start live, history in the ring may already be half overwritten
+    r->pos = atomic_load_explicit(&((tap_shm_t *)shm)->head, memory_order_acquire);
+    return 0;
+}
+
+void tap_reader_close(tap_reader_t *r){
+    if (r->shm)
+        munmap((void *)r->shm, r->map_size);
+    memset(r, 0, sizeof *r);
+}
+
+/* 1 if the writer has not started to overwrite the last returned block */
+int tap_reader_valid(const tap_reader_t *r){
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t reserve = atomic_load_explicit(&((tap_shm_t *)r->shm)->reserve,
+            memory_order_relaxed);
+    return reserve - r->cur <= r->shm->size;
+}
+
+static void resync(tap_reader_t *r, uint64_t head){
+    r->lost += head - r->pos;
+    r->pos = head;
+}
+
+/* next committed block or NULL when caught up. a reader that fell a lap
+ * behind skips to the newest data and counts the bytes in lost */
+const tap_block_t *tap_reader_next(tap_reader_t *r){
+    const uint64_t size = r->shm->size;
+    for (;;){
+        uint64_t head = atomic_load_explicit(&((tap_shm_t *)r->shm)->head,
+                memory_order_acquire);
+        if (head == r->pos)
+            return NULL;
+        if (head - r->pos > size){
+            resync(r, head);
+            return NULL;
+        }
+
+        size_t off = r->pos & (size - 1);
+        const tap_block_t *b = (const tap_block_t *)(r->ring + off);
+        uint32_t magic = b->magic, bytes = b->bytes;
+        r->cur = r->pos;
+        if (!tap_reader_valid(r)){
+            resync(r, head);
+            continue;
+        }
+
+        if (magic == TAP_PAD_MAGIC){
+            r->pos += size - off;
+            continue;
+        }
+        if (magic != TAP_BLOCK_MAGIC || bytes < sizeof *b || bytes > size - off){
+            resync(r, head);
+            return NULL;
+        }
+        r->pos += bytes;
+        return b;
+    }
+}
+
+/* in|out|all|STAGE, added to *mask */
+int tap_point_parse(const char *s, uint32_t *mask){
+    int stage;
+    if (strcmp(s, "in") == 0 || strcmp(s, "input") == 0)
+        *mask |= TAP_POINT_BIT(TAP_POINT_INPUT);
+    else if (strcmp(s, "out") == 0 || strcmp(s, "output") == 0)
+        *mask |= TAP_POINT_BIT(TAP_POINT_OUTPUT);
+    else if (strcmp(s, "all") == 0)
+        *mask |= TAP_POINT_BIT(TAP_POINT_INPUT) | TAP_POINT_BIT(TAP_POINT_OUTPUT)
+            | (((1u << CHAIN_MAX_STAGES) - 1) << TAP_POINT_STAGE(0));
+    else if (parse_int(s, &stage) == 0 && stage >= 0 && stage < CHAIN_MAX_STAGES)
+        *mask |= TAP_POINT_BIT(TAP_POINT_STAGE(stage));
+    else
+        return -1;
+    return 0;
+}
+
+const char *tap_point_name(int point, char *buf, size_t n){
+    if (point == TAP_POINT_INPUT)
+        snprintf(buf, n, "in");
+    else if (point == TAP_POINT_OUTPUT)
+        snprintf(buf, n, "out");
+    else
+        snprintf(buf, n, "%d", point - TAP_POINT_STAGE(0));
+    return buf;
+}
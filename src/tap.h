@@ -0,0 +1,88 @@
+#ifndef TAP_H
+#define TAP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#include "audio_types.h"
+
+#define TAP_SHM_NAME      "/wavecli-tap"
+#define TAP_DEFAULT_SIZE  (4u << 20)    // ~5 s of stereo 48 kHz, all points
+#define TAP_MAGIC         (0x50545657u) // "WVTP"
+#define TAP_VERSION       (1)
+#define TAP_BLOCK_MAGIC   (0x4b4c4257u) // "WBLK"
+#define TAP_PAD_MAGIC     (0x44415057u) // "WPAD", rest of the ring is unused
+#define TAP_ALIGN         (16)
+
+// tap points: input, after each chain stage, output
+#define TAP_POINT_INPUT   (0)
+#define TAP_POINT_STAGE(i) ((i) + 1)
+#define TAP_POINT_OUTPUT  (31)
+#define TAP_POINT_BIT(p)  (1u << (p))
+
+/* shared memory layout, what an analyzer maps read-only:
+ * tap_shm_t, then `size` bytes of blocks. a block never wraps; a pad
+ * marker sends the reader back to the start of the ring */
+typedef struct tap_shm_t{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_size;       // offset of the ring
+    uint32_t block_header_size;
+    uint64_t size;              // ring bytes, power of two
+    _Alignas(64) _Atomic uint64_t head;     // bytes committed, ever
+    _Alignas(64) _Atomic uint64_t reserve;  // bytes being written, ever
+} tap_shm_t;
+
+// one callback's worth of one tap point, float32 interleaved frames follow
+typedef struct tap_block_t{
+    uint32_t magic;
+    uint32_t bytes;             // header + data + padding to TAP_ALIGN
+    uint64_t seq;               // per ring, gaps mean overwritten blocks
+    uint64_t frame;             // stream position of the first frame
+    uint64_t time_ns;           // CLOCK_MONOTONIC at callback start
+    uint16_t point;
+    uint16_t channels;
+    uint32_t frames;
+    uint32_t sample_rate;
+    uint32_t reserved;
+} tap_block_t;
+
+/* producer: only the audio callback writes. it never waits for readers,
+ * the ring is overwritten and slow readers notice by the reserve counter */
+typedef struct tap_t{
+    tap_shm_t *shm;
+    unsigned char *ring;
+    size_t map_size;
+    char name[64];
+    _Atomic uint32_t mask;      // TAP_POINT_BIT()s, 0 = off
+    uint64_t seq;               // callback only
+    uint64_t frame;
+} tap_t;
+
+tap_t *tap_open(const char *name, size_t size);
+void tap_close(tap_t *t);
+void tap_write(tap_t *t, int point, const SAMPLE *x, unsigned long frames,
+        int channels, int sample_rate, uint64_t time_ns);
+
+/* consumer: zero copy, blocks are read in place in the mapping. the
+ * pointer stays valid until tap_reader_next is called again, check with
+ * tap_reader_valid after using the data */
+typedef struct tap_reader_t{
+    const tap_shm_t *shm;
+    const unsigned char *ring;
+    size_t map_size;
+    uint64_t pos;               // bytes, same scale as head
+    uint64_t cur;               // start of the block last returned
+    uint64_t lost;              // bytes skipped after being lapped
+} tap_reader_t;
+
+int tap_reader_open(tap_reader_t *r, const char *name);
+void tap_reader_close(tap_reader_t *r);
+const tap_block_t *tap_reader_next(tap_reader_t *r);
+int tap_reader_valid(const tap_reader_t *r);
+
+int tap_point_parse(const char *s, uint32_t *mask);
+const char *tap_point_name(int point, char *buf, size_t n);
+
+#endif
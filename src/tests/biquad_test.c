@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+
+#include "../biquad.h"
+#include "../kernels.h"
+
+#define FS (48000.0)
+
+static int fail(const char *msg) {
+    fprintf(stderr, "FAIL: %s\n", msg);
+    return 1;
+}
+
+static double response_db(const float c[5], double freq) {
+    double complex z = cexp(-I * 2.0 * M_PI * freq / FS);
+    double complex h = (c[0] + c[1] * z + c[2] * z * z) / (1.0 + c[3] * z + c[4] * z * z);
+    return 20.0 * log10(cabs(h));
+}
+
+static int expect(const char *name, biquad_type_t type, double f0, double q, double gain,
+                  double at, double want_db) {
+    float c[5];
+    if (biquad_design(c, type, FS, f0, q, gain) < 0) return fail(name);
+    double got = response_db(c, at);
+    if (fabs(got - want_db) > 0.05) {
+        fprintf(stderr, "FAIL %s: %.1f Hz is %.2f dB, want %.2f\n", name, at, got, want_db);
+        return 1;
+    }
+    return 0;
+}
+
+static int test_design(void) {
+    int failed = 0;
+    failed |= expect("lowpass dc", BIQUAD_LOWPASS, 1000, M_SQRT1_2, 0, 0.0, 0.0);
+    failed |= expect("lowpass f0", BIQUAD_LOWPASS, 1000, M_SQRT1_2, 0, 1000, -3.01);
+    failed |= expect("highpass f0", BIQUAD_HIGHPASS, 1000, M_SQRT1_2, 0, 1000, -3.01);
+    failed |= expect("bandpass f0", BIQUAD_BANDPASS, 1000, 2.0, 0, 1000, 0.0);
+    failed |= expect("peak f0", BIQUAD_PEAK, 2500, 1.4, -6, 2500, -6.0);
+    failed |= expect("peak far", BIQUAD_PEAK, 2500, 1.4, -6, 20, 0.0);
+    failed |= expect("lowshelf dc", BIQUAD_LOWSHELF, 200, M_SQRT1_2, 4, 0.0, 4.0);
+    failed |= expect("highshelf top", BIQUAD_HIGHSHELF, 5000, M_SQRT1_2, -3, 23999, -3.0);
+    float c[5];
+    if (expect("notch far", BIQUAD_NOTCH, 1000, 4.0, 0, 100, 0.0)
+            || response_db((biquad_design(c, BIQUAD_NOTCH, FS, 1000, 4.0, 0), c), 1000) > -60)
+        failed |= fail("notch");
+    if (biquad_design(c, BIQUAD_LOWPASS, FS, 30000, 1, 0) == 0)
+        failed |= fail("accepted freq above nyquist");
+    if (!failed) printf("OK: design\n");
+    return failed;
+}
+
+/* after the glide the eq must run exactly the designed section */
+static int test_eq_glide(void) {
+    const int ch = 3;
+    audio_params_t p = { .channels = ch, .sample_rate = (int)FS, .frames_per_buffer = 256 };
+    eq_state_t *st = aligned_alloc(64, (eq_state_size(&p) + 63) & ~(size_t)63);
+    memset(st, 0, eq_state_size(&p));
+    if (eq_init(st, &p) < 0) return fail("eq_init");
+    if (eq_set_band(st, 2, BIQUAD_PEAK, 1000, 1, 6) < 0) return fail("eq_set_band");
+
+    static float buf[4096 * 3];
+    for (int i = 0; i < 100; i++)
+        eq_process(buf, 4096, &p, st);          // silence while the glide settles
+
+    float c[5], z1[3] = { 0 }, z2[3] = { 0 };
+    biquad_design(c, BIQUAD_PEAK, FS, 1000, 1, 6);
+    if (st->gliding[2] || memcmp(st->cur[2], c, sizeof c) != 0)
+        return fail("eq did not settle on the target");
+
+    static float ref[4096 * 3];
+    for (size_t i = 0; i < 4096 * 3; i++)
+        buf[i] = ref[i] = sinf((float)i * 0.05f);
+    eq_process(buf, 4096, &p, st);
+    kernels_scalar.biquad(ref, 4096, ch, c, z1, z2);
+    for (size_t i = 0; i < 4096 * 3; i++)
+        if (fabsf(buf[i] - ref[i]) > 1e-6f)
+            return fail("eq output differs from the section");
+
+    if (eq_band_off(st, 2) < 0) return fail("eq_band_off");
+    for (int i = 0; i < 100; i++)
+        eq_process(buf, 4096, &p, st);
+    if (st->active[2])
+        return fail("band still active after off");
+
+    printf("OK: eq glide\n");
+    free(st);
+    return 0;
+}
+
+int main(void) {
+    int failed = 0;
+    failed |= test_design();
+    failed |= test_eq_glide();
+    return failed;
+}
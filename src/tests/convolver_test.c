@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "../convolver.h"
+#include "../wav.h"
+
+static const char ir_path[] = "./test_convolver_ir.wav";
+
+#define IR_FRAMES  (1500)   // not a multiple of the partition
+#define IN_FRAMES  (6000)
+#define CHANNELS   (2)
+
+static int fail(const char *msg) {
+    fprintf(stderr, "FAIL: %s\n", msg);
+    return 1;
+}
+
+static float ir_sample(size_t i, int c) {
+    return expf(-(float)i / 300.0f) * sinf((float)i * (0.3f + 0.2f * c));
+}
+
+static float in_sample(size_t i, int c) {
+    return (float)((i * 7919 + c * 104729) % 2001) / 1000.0f - 1.0f;
+}
+
+/* against a direct FIR, delayed by one partition, with callbacks of uneven
+ * sizes so partitions straddle them */
+static int test_against_fir(unsigned long frames_per_buffer) {
+    audio_params_t p = {
+        .channels = CHANNELS, .sample_rate = 48000,
+        .frames_per_buffer = frames_per_buffer,
+    };
+    void *state = aligned_alloc(64, (convolver_state_size(&p) + 63) & ~(size_t)63);
+    memset(state, 0, convolver_state_size(&p));
+    if (convolver_init(state, &p) < 0) return fail("convolver_init");
+    const size_t latency = ((convolver_state_t *)state)->block;
+
+    float *buf = malloc(sizeof(float) * IN_FRAMES * CHANNELS);
+    for (size_t i = 0; i < IN_FRAMES; i++)
+        for (int c = 0; c < CHANNELS; c++)
+            buf[i * CHANNELS + c] = in_sample(i, c);
+
+    const unsigned long sizes[] = { 1, 77, 256, 13, 500, 3 };
+    size_t done = 0;
+    for (int k = 0; done < IN_FRAMES; k = (k + 1) % 6) {
+        unsigned long n = sizes[k];
+        if (n > IN_FRAMES - done) n = IN_FRAMES - done;
+        convolver_process(buf + done * CHANNELS, n, &p, state);
+        done += n;
+    }
+
+    double max_err = 0.0;
+    for (size_t i = latency; i < IN_FRAMES; i++) {
+        for (int c = 0; c < CHANNELS; c++) {
+            double y = 0.0;
+            size_t t = i - latency;
+            for (size_t j = 0; j < IR_FRAMES && j <= t; j++)
+                y += (double)ir_sample(j, c) * in_sample(t - j, c);
+            double e = fabs(y - buf[i * CHANNELS + c]);
+            if (e > max_err) max_err = e;
+        }
+    }
+
+    int failed = max_err > 1e-3;
+    if (failed)
+        fprintf(stderr, "FAIL: block %lu, max error %g\n", frames_per_buffer, max_err);
+    else
+        printf("OK: block %lu, latency %zu, max error %.2e\n", frames_per_buffer, latency, max_err);
+
+    free(buf);
+    free(state);
+    return failed;
+}
+
+int main(void) {
+    wav_writer *w = wav_open(ir_path, WAVE_FORMAT_IEEE_FLOAT, 48000, CHANNELS, 32);
+    if (!w) return fail("wav_open");
+    for (size_t i = 0; i < IR_FRAMES; i++) {
+        float f[CHANNELS];
+        for (int c = 0; c < CHANNELS; c++)
+            f[c] = ir_sample(i, c);
+        wav_write(w, f, sizeof f);
+    }
+    wav_close(w);
+
+    if (convolver_ir_load(ir_path) < 0) return fail("convolver_ir_load");
+    remove(ir_path);
+
+    int failed = 0;
+    failed |= test_against_fir(64);
+    failed |= test_against_fir(256);
+    failed |= test_against_fir(4096);
+    convolver_ir_free();
+    return failed;
+}
@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "../fft.h"
+
+static int fail(const char *msg) {
+    fprintf(stderr, "FAIL: %s\n", msg);
+    return 1;
+}
+
+/* against a direct DFT in double precision */
+static int test_forward(size_t n) {
+    fft_t f;
+    if (fft_init(&f, n) < 0) return fail("fft_init");
+
+    float *x = malloc(sizeof(float) * n);
+    float *re = malloc(sizeof(float) * (n / 2 + 1));
+    float *im = malloc(sizeof(float) * (n / 2 + 1));
+    srand((unsigned)n);
+    for (size_t i = 0; i < n; i++)
+        x[i] = (float)rand() / (float)RAND_MAX * 2.0f - 1.0f;
+
+    fft_forward(&f, x, re, im);
+
+    double max_err = 0.0;
+    for (size_t k = 0; k <= n / 2; k++) {
+        double sr = 0.0, si = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            double a = -2.0 * M_PI * (double)(k * i % n) / (double)n;
+            sr += x[i] * cos(a);
+            si += x[i] * sin(a);
+        }
+        double e = hypot(re[k] - sr, im[k] - si);
+        if (e > max_err) max_err = e;
+    }
+
+    // error of a float FFT grows ~ log2(n) * eps * sqrt(n)
+    double tol = 1e-5 * sqrt((double)n) * log2((double)n);
+    int failed = max_err > tol;
+    if (failed)
+        fprintf(stderr, "FAIL forward %zu: max error %g > %g\n", n, max_err, tol);
+    else
+        printf("OK: forward %zu (max error %.2e)\n", n, max_err);
+
+    free(x); free(re); free(im);
+    fft_free(&f);
+    return failed;
+}
+
+static int test_roundtrip(size_t n) {
+    fft_t f;
+    if (fft_init(&f, n) < 0) return fail("fft_init");
+
+    float *x = malloc(sizeof(float) * n);
+    float *y = malloc(sizeof(float) * n);
+    float *re = malloc(sizeof(float) * (n / 2 + 1));
+    float *im = malloc(sizeof(float) * (n / 2 + 1));
+    for (size_t i = 0; i < n; i++)
+        x[i] = sinf((float)i * 0.37f) + 0.25f * cosf((float)i * 1.9f);
+
+    fft_forward(&f, x, re, im);
+    fft_inverse(&f, re, im, y);
+
+    double max_err = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        double e = fabs((double)x[i] - y[i]);
+        if (e > max_err) max_err = e;
+    }
+
+    int failed = max_err > 1e-5;
+    if (failed)
+        fprintf(stderr, "FAIL roundtrip %zu: max error %g\n", n, max_err);
+    else
+        printf("OK: roundtrip %zu\n", n);
+
+    free(x); free(y); free(re); free(im);
+    fft_free(&f);
+    return failed;
+}
+
+int main(void) {
+    int failed = 0;
+    for (size_t n = 4; n <= 2048; n *= 2)
+        failed |= test_forward(n);
+    for (size_t n = 4; n <= 65536; n *= 4)
+        failed |= test_roundtrip(n);
+    return failed;
+}
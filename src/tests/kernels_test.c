@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+
+#include "../kernels.h"
+
+#define N (4099)    // odd length, exercises the scalar tails
+
+static float input[N];
+
+static void fill_input(void) {
+    // edges first: exact borders, signed zeros, denormals, huge values
+    const float edges[] = {
+        0.0f, -0.0f, 1.0f, -1.0f, 0.1f, -0.1f, 0.10000001f, -0.09999999f,
+        FLT_MIN, -FLT_MIN, FLT_MIN / 4, -FLT_MIN / 4, 1e30f, -1e30f,
+    };
+    size_t ne = sizeof(edges) / sizeof(edges[0]);
+    memcpy(input, edges, sizeof edges);
+
+    srand(1234);
+    for (size_t i = ne; i < N; i++)
+        input[i] = ((float)rand() / (float)RAND_MAX * 2.0f - 1.0f) * 0.3f;
+}
+
+typedef void (*gain_kernel)(SAMPLE *x, size_t n, float g);
+
+static int compare(const char *set, const char *kernel, const float *ref, const float *got) {
+    if (memcmp(ref, got, sizeof(float) * N) == 0)
+        return 0;
+    for (size_t i = 0; i < N; i++) {
+        if (memcmp(&ref[i], &got[i], sizeof(float)) != 0) {
+            fprintf(stderr, "FAIL %s/%s: [%zu] in=%a ref=%a got=%a\n",
+                    set, kernel, i, input[i], ref[i], got[i]);
+            break;
+        }
+    }
+    return 1;
+}
+
+/* run at every start offset 0..7 so unaligned heads are covered too.
+ * every case runs even after a failure, each one is reported */
+static int check_gain_kernel(const char *set, const char *kernel,
+                             gain_kernel ref_fn, gain_kernel fn, float g) {
+    static float ref[N], got[N];
+    char what[64];
+    int failed = 0;
+    for (size_t off = 0; off < 8; off++) {
+        memcpy(ref, input, sizeof ref);
+        memcpy(got, input, sizeof got);
+        ref_fn(ref + off, N - off, g);
+        fn(got + off, N - off, g);
+        snprintf(what, sizeof what, "%s g=%g off=%zu", kernel, g, off);
+        failed |= compare(set, what, ref, got);
+    }
+    return failed;
+}
+
+static int check_set(const dsp_kernels_t *k) {
+    const dsp_kernels_t *s = &kernels_scalar;
+    const float gains[] = { 1.0f, 3.3f, 10.0f };
+    char what[64];
+    int failed = 0;
+
+    for (size_t g = 0; g < sizeof(gains) / sizeof(gains[0]); g++) {
+        failed |= check_gain_kernel(k->name, "gain", s->gain, k->gain, gains[g]);
+        failed |= check_gain_kernel(k->name, "hard_clip", s->hard_clip, k->hard_clip, gains[g]);
+        failed |= check_gain_kernel(k->name, "soft_clip", s->soft_clip, k->soft_clip, gains[g]);
+    }
+
+    static float ref[N], got[N];
+    memcpy(ref, input, sizeof ref);
+    memcpy(got, input, sizeof got);
+    s->invert(ref, N);
+    k->invert(got, N);
+    failed |= compare(k->name, "invert", ref, got);
+
+    // lowpass-ish section, every channel count up to two AVX widths + tail
+    const float c[5] = { 0.2f, 0.4f, 0.2f, -0.6f, 0.3f };
+    for (int ch = 1; ch <= 19; ch++) {
+        size_t frames = N / ch;
+        float z[4][19] = { { 0 } };
+        memcpy(ref, input, sizeof ref);
+        memcpy(got, input, sizeof got);
+        s->biquad(ref, frames, ch, c, z[0], z[1]);
+        k->biquad(got, frames, ch, c, z[2], z[3]);
+        snprintf(what, sizeof what, "biquad %dch", ch);
+        failed |= compare(k->name, what, ref, got);
+        if (memcmp(z[0], z[2], sizeof z[0]) || memcmp(z[1], z[3], sizeof z[1])) {
+            fprintf(stderr, "FAIL %s/biquad: state differs at %d channels\n", k->name, ch);
+            failed = 1;
+        }
+    }
+
+    // planar round trip against the scalar reference, 1..16 channels
+    static float planes[N], back[N];
+    for (int ch = 1; ch <= 16; ch++) {
+        size_t frames = N / ch;
+        float *rp[16], *gp[16];
+        for (int c = 0; c < ch; c++) {
+            rp[c] = ref + c * frames;
+            gp[c] = planes + c * frames;
+        }
+        memset(ref, 0, sizeof ref);
+        memset(planes, 0, sizeof planes);
+        s->deinterleave(input, rp, frames, ch);
+        k->deinterleave(input, gp, frames, ch);
+        snprintf(what, sizeof what, "deinterleave %dch", ch);
+        failed |= compare(k->name, what, ref, planes);
+
+        memcpy(back, input, sizeof back);
+        memset(got, 0, sizeof got);
+        memcpy(got + frames * ch, input + frames * ch, sizeof(float) * (N - frames * ch));
+        k->interleave((const float *const *)gp, got, frames, ch);
+        snprintf(what, sizeof what, "interleave %dch", ch);
+        failed |= compare(k->name, what, back, got);
+    }
+
+    // pcm16/24/32 scaling, with and without dither; the edges hit clipping
+    const float scales[3][2] = {
+        { 32768.0f, 32767.0f }, { 8388608.0f, 8388607.0f }, { 2147483648.0f, 2147483520.0f },
+    };
+    static float dither[N];
+    static int32_t qref[N], qgot[N];
+    for (size_t i = 0; i < N; i++)
+        dither[i] = ((float)rand() / (float)RAND_MAX - (float)rand() / (float)RAND_MAX);
+    for (int f = 0; f < 3; f++) {
+        for (int d = 0; d < 2; d++) {
+            const float *dp = d ? dither : NULL;
+            s->quantize(input, dp, qref, N, scales[f][0], scales[f][1]);
+            k->quantize(input, dp, qgot, N, scales[f][0], scales[f][1]);
+            if (memcmp(qref, qgot, sizeof qref)) {
+                fprintf(stderr, "FAIL %s/quantize: scale %g dither %d\n", k->name, scales[f][0], d);
+                failed = 1;
+            }
+        }
+    }
+
+    // gain ramps up and down, every channel count and ragged frame counts
+    const float ramps[2][2] = { { 0.5f, 0.001f }, { 3.0f, -0.0007f } };
+    for (int ch = 1; ch <= 19; ch++) {
+        for (int r = 0; r < 2; r++) {
+            size_t frames = N / ch - (size_t)r;
+            memcpy(ref, input, sizeof ref);
+            memcpy(got, input, sizeof got);
+            s->gain_ramp(ref, frames, ch, ramps[r][0], ramps[r][1]);
+            k->gain_ramp(got, frames, ch, ramps[r][0], ramps[r][1]);
+            snprintf(what, sizeof what, "gain_ramp %dch ramp %d", ch, r);
+            failed |= compare(k->name, what, ref, got);
+        }
+    }
+
+    // FIR lengths of the half-band filters and odd ones, ragged outputs
+    const float *coef = input + 100;
+    for (size_t taps = 1; taps <= 33; taps += 4) {
+        size_t n = N - taps - (taps & 3);
+        memset(ref, 0, sizeof ref);
+        memset(got, 0, sizeof got);
+        s->fir(input, ref, n, coef, taps);
+        k->fir(input, got, n, coef, taps);
+        snprintf(what, sizeof what, "fir %zu taps", taps);
+        failed |= compare(k->name, what, ref, got);
+    }
+
+    // polyphase rows: a fresh row and start for every output
+    static const float *rows[N / 64];
+    static size_t at[N / 64];
+    for (size_t taps = 8; taps <= 64; taps += 8) {
+        size_t n = N / 64 - (taps >> 3);
+        for (size_t j = 0; j < n; j++) {
+            at[j] = (j * 37) % (N - 2 * taps);
+            rows[j] = input + (j * 11) % (N - taps);
+        }
+        memset(ref, 0, sizeof ref);
+        memset(got, 0, sizeof got);
+        s->poly_fir(input, at, rows, ref, n, taps);
+        k->poly_fir(input, at, rows, got, n, taps);
+        snprintf(what, sizeof what, "poly_fir %zu taps", taps);
+        failed |= compare(k->name, what, ref, got);
+    }
+
+    if (!failed) printf("OK: %s bit-exact with scalar\n", k->name);
+    return failed;
+}
+
+int main(void) {
+    fill_input();
+
+    const dsp_kernels_t *sets[8];
+    size_t n = dsp_kernels_available(sets, 8);
+    int failed = 0;
+    for (size_t i = 1; i < n; i++)
+        failed |= check_set(sets[i]);
+
+    printf("selected: %s\n", dsp_kernels()->name);
+    return failed;
+}
@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "../meter.h"
+
+#define RATE (48000)
+
+static int fail(const char *msg) {
+    fprintf(stderr, "FAIL: %s\n", msg);
+    return 1;
+}
+
+static void wait_frames(meter_t *m, unsigned long long frames, meter_reading_t *r) {
+    const struct timespec tick = { 0, 2 * 1000 * 1000 };
+    for (int i = 0; i < 5000; i++) {
+        meter_read(m, r);
+        if (r->frames >= frames) return;
+        nanosleep(&tick, NULL);
+    }
+}
+
+/* feeds sec seconds of a sine on every channel, in callback-sized pushes */
+static void feed_sine(meter_t *m, int ch, double freq, double amp, double phase, double sec) {
+    float buf[256 * 8];
+    size_t total = (size_t)(sec * RATE);
+    const struct timespec tick = { 0, 1000 * 1000 };
+    for (size_t done = 0; done < total; done += 256) {
+        for (int i = 0; i < 256; i++)
+            for (int c = 0; c < ch; c++)
+                buf[i * ch + c] = (float)(amp * sin(2.0 * M_PI * freq * (done + i) / RATE + phase));
+        while (meter_push(m, buf, 256) < 0)
+            nanosleep(&tick, NULL);
+    }
+}
+
+/* EBU Tech 3341: a 997 Hz stereo sine at -20 dBFS reads -20 LUFS */
+static int test_loudness(void) {
+    meter_t *m = meter_open(RATE, 2);
+    if (!m) return fail("meter_open");
+    double amp = pow(10.0, -20.0 / 20.0);
+    feed_sine(m, 2, 997.0, amp, 0.0, 10.0);
+
+    meter_reading_t r;
+    wait_frames(m, 10ull * RATE - 256, &r);
+    int failed = 0;
+    if (fabsf(r.momentary + 20.0f) > 0.1f || fabsf(r.short_term + 20.0f) > 0.1f
+            || fabsf(r.integrated + 20.0f) > 0.1f) {
+        fprintf(stderr, "FAIL: loudness M %.2f S %.2f I %.2f, want -20\n",
+                r.momentary, r.short_term, r.integrated);
+        failed = 1;
+    }
+    if (fabsf(meter_db(r.rms[0]) - (-23.01f)) > 0.1f)
+        failed |= fail("rms of a sine is 3 dB under its peak");
+    if (fabsf(meter_db(r.peak_hold[1]) + 20.0f) > 0.05f)
+        failed |= fail("peak hold");
+    if (!failed)
+        printf("OK: loudness M %.2f S %.2f I %.2f LUFS\n", r.momentary, r.short_term, r.integrated);
+    meter_close(m);
+    return failed;
+}
+
+/* fs/4 sine sampled 45 degrees off its crests: samples peak at -3 dB, the
+ * true peak is 0 dB */
+static int test_true_peak(void) {
+    meter_t *m = meter_open(RATE, 1);
+    if (!m) return fail("meter_open");
+    feed_sine(m, 1, RATE / 4.0, 0.5, M_PI / 4.0, 1.0);
+
+    meter_reading_t r;
+    wait_frames(m, RATE - 256, &r);
+    float sample_db = meter_db(r.peak_hold[0]), tp_db = meter_db(r.true_peak[0]);
+    int failed = fabsf(sample_db - (-9.03f)) > 0.1f || fabsf(tp_db - (-6.02f)) > 0.3f;
+    if (failed)
+        fprintf(stderr, "FAIL: true peak: sample %.2f dB, true %.2f dB\n", sample_db, tp_db);
+    else
+        printf("OK: true peak %.2f dB (sample peak %.2f dB)\n", tp_db, sample_db);
+    meter_close(m);
+    return failed;
+}
+
+int main(void) {
+    int failed = 0;
+    failed |= test_loudness();
+    failed |= test_true_peak();
+    return failed;
+}
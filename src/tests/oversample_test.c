@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "../oversample.h"
+#include "../kernels.h"
+
+#define RATE   (48000)
+#define FRAMES (48000)
+#define CH     (2)
+
+static float in[FRAMES * CH], out[FRAMES * CH], out2[FRAMES * CH];
+
+static int fail(const char *msg) {
+    fprintf(stderr, "FAIL: %s\n", msg);
+    return 1;
+}
+
+static void pass(SAMPLE *x, unsigned long n, const audio_params_t *p, void *state) {
+    (void)x; (void)n; (void)p; (void)state;
+}
+
+static void clip(SAMPLE *x, unsigned long n, const audio_params_t *p, void *state) {
+    (void)state;
+    dsp_kernels()->soft_clip(x, n * p->channels, p->gain);
+}
+
+static const effect_t through = { .name = "none", .description = "", .func = pass };
+static const effect_t soft = { .name = "soft", .description = "", .func = clip };
+
+static void sine(float hz) {
+    for (size_t i = 0; i < FRAMES; i++)
+        for (int c = 0; c < CH; c++)
+            in[i * CH + c] = 0.5f * (float)sin(2.0 * M_PI * hz * (double)i / RATE);
+}
+
+static void run(const effect_t *e, int factor, float *dst, unsigned long block) {
+    arena_t arena;
+    arena_init(&arena, 8u << 20);
+    oversampler_t *os = oversampler_create(factor, CH, &arena);
+    audio_params_t p = { .channels = CH, .sample_rate = RATE, .gain = 4.0f };
+    memcpy(dst, in, sizeof in);
+    for (unsigned long off = 0; off < FRAMES; off += block) {
+        unsigned long n = FRAMES - off < block ? FRAMES - off : block;
+        if (os)
+            oversampler_process(os, e, NULL, dst + off * CH, n, &p);
+        else
+            e->func(dst + off * CH, n, &p, NULL);
+    }
+    arena_free(&arena);
+}
+
+// magnitude of one frequency over the second half (past any start-up)
+static double level(const float *x, double hz) {
+    double re = 0.0, im = 0.0;
+    size_t n = FRAMES / 2;
+    for (size_t i = 0; i < n; i++) {
+        double ph = 2.0 * M_PI * hz * (double)i / RATE;
+        re += x[(n + i) * CH] * cos(ph);
+        im += x[(n + i) * CH] * sin(ph);
+    }
+    return 2.0 * sqrt(re * re + im * im) / (double)n;
+}
+
+/* passband: a 1 kHz tone comes out as the same tone, delayed by the
+ * reported latency */
+static int test_passband(void) {
+    int failed = 0;
+    sine(1000.0f);
+    for (int f = 2; f <= OS_MAX_FACTOR && !failed; f *= 2) {
+        arena_t arena;
+        arena_init(&arena, 8u << 20);
+        double lat = oversampler_latency(oversampler_create(f, CH, &arena));
+        arena_free(&arena);
+
+        run(&through, f, out, 256);
+        double err = 0.0;
+        for (size_t i = 1000; i < FRAMES; i++) {
+            double want = 0.5 * sin(2.0 * M_PI * 1000.0 * ((double)i - lat) / RATE);
+            err = fmax(err, fabs(out[i * CH + 1] - want));
+        }
+        if (err > 1e-3) {
+            fprintf(stderr, "FAIL passband x%d: error %g, latency %.1f\n", f, err, lat);
+            failed = 1;
+        }
+    }
+    if (!failed) printf("OK: passband\n");
+    return failed;
+}
+
+/* soft clipping a 7 kHz tone at gain 4 makes harmonics at 35 and 49 kHz,
+ * which land on 13 and 1 kHz at the base rate. oversampled they are
+ * filtered before going back down */
+static int test_alias(void) {
+    int failed = 0;
+    sine(7000.0f);
+    run(&soft, 1, out, 256);
+    double base = level(out, 13000.0) + level(out, 1000.0);
+    for (int f = 2; f <= OS_MAX_FACTOR; f *= 2) {
+        run(&soft, f, out, 256);
+        double os = level(out, 13000.0) + level(out, 1000.0);
+        double db = 20.0 * log10(os / base);
+        printf("   x%d: aliases %.1f dB vs. base rate, 21 kHz harmonic %.1f dB\n", f, db,
+               20.0 * log10(level(out, 21000.0) / 0.5));
+        if (f >= 4 && db > -40.0)
+            failed = fail("alias: less than 40 dB suppression");
+    }
+    if (!failed) printf("OK: alias\n");
+    return failed;
+}
+
+// the filters only see samples: the block size does not change a bit
+static int test_blocks(void) {
+    sine(3000.0f);
+    run(&soft, 8, out, 64);
+    run(&soft, 8, out2, 1000);
+    if (memcmp(out, out2, sizeof out))
+        return fail("blocks: output depends on the block size");
+    printf("OK: blocks\n");
+    return 0;
+}
+
+int main(void) {
+    int failed = 0;
+    failed |= test_passband();
+    failed |= test_alias();
+    failed |= test_blocks();
+    return failed;
+}
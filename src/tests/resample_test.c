@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "../resample.h"
+
+#define FRAMES (48000)
+#define CH     (2)
+
+static float in[FRAMES * CH];
+static float out[FRAMES * CH * 4], out2[FRAMES * CH * 4];
+
+static int fail(const char *msg) {
+    fprintf(stderr, "FAIL: %s\n", msg);
+    return 1;
+}
+
+// channel 1 is channel 0 negated, a mixed-up lane shows
+static void sine(double hz, int rate, size_t frames) {
+    for (size_t i = 0; i < frames; i++) {
+        float v = 0.5f * (float)sin(2.0 * M_PI * hz * (double)i / rate);
+        in[i * CH] = v;
+        in[i * CH + 1] = -v;
+    }
+}
+
+// whole input in blocks of block frames, then the tail
+static size_t convert(int from, int to, int q, size_t frames, size_t block, float *dst) {
+    resampler_t *r = resampler_create(from, to, CH, q);
+    if (!r)
+        return 0;
+    size_t n = 0;
+    for (size_t off = 0; off < frames; off += block) {
+        size_t b = frames - off < block ? frames - off : block;
+        n += resampler_process(r, in + off * CH, b, dst + n * CH);
+    }
+    n += resampler_flush(r, dst + n * CH);
+    resampler_free(r);
+    return n;
+}
+
+/* a 1 kHz tone comes out as the same tone at the new rate, in time with
+ * the input. the ends see the silence around the file, skip them */
+static int test_tone(void) {
+    static const int rates[][2] = {
+        { 44100, 48000 }, { 48000, 44100 }, { 48000, 96000 }, { 96000, 44100 },
+        { 44100, 47999 }, { 8000, 44100 },
+    };
+    static const double limit[RESAMPLE_QUALITIES] = { 3e-3, 1e-4, 2e-6 };
+    int failed = 0;
+    for (size_t i = 0; i < sizeof rates / sizeof rates[0]; i++) {
+        int from = rates[i][0], to = rates[i][1];
+        size_t frames = (size_t)from / 2;
+        sine(1000.0, from, frames);
+        for (int q = 0; q < RESAMPLE_QUALITIES; q++) {
+            size_t n = convert(from, to, q, frames, 4096, out);
+            double err = 0.0;
+            for (size_t j = n / 10; j < n - n / 10; j++) {
+                double want = 0.5 * sin(2.0 * M_PI * 1000.0 * (double)j / to);
+                err = fmax(err, fabs(out[j * CH] - want));
+                err = fmax(err, fabs(out[j * CH + 1] + want));
+            }
+            if (err > limit[q]) {
+                fprintf(stderr, "FAIL tone %d -> %d %s: error %g\n", from, to,
+                        resample_quality_name(q), err);
+                failed = 1;
+            }
+        }
+    }
+    if (!failed) printf("OK: tone\n");
+    return failed;
+}
+
+// every input frame makes up / down output frames, rounded up
+static int test_length(void) {
+    static const int rates[][2] = { { 44100, 48000 }, { 48000, 44100 }, { 22050, 48000 },
+                                    { 44100, 47999 }, { 48000, 8000 } };
+    sine(440.0, 48000, FRAMES);
+    for (size_t i = 0; i < sizeof rates / sizeof rates[0]; i++) {
+        for (size_t frames = 1; frames < FRAMES; frames = frames * 7 + 3) {
+            size_t n = convert(rates[i][0], rates[i][1], RESAMPLE_MEDIUM, frames, 1000, out);
+            size_t want = (size_t)(((unsigned long long)frames * rates[i][1]
+                                    + rates[i][0] - 1) / rates[i][0]);
+            if (n != want) {
+                fprintf(stderr, "FAIL length %d -> %d: %zu frames in, %zu out, want %zu\n",
+                        rates[i][0], rates[i][1], frames, n, want);
+                return 1;
+            }
+        }
+    }
+    printf("OK: length\n");
+    return 0;
+}
+
+// tones just above the new Nyquist do not come back as aliases
+static int test_alias(void) {
+    sine(23000.0, 48000, FRAMES);
+    size_t n = convert(48000, 44100, RESAMPLE_BEST, FRAMES, 4096, out);
+    double peak = 0.0;
+    for (size_t j = n / 10; j < n - n / 10; j++)
+        peak = fmax(peak, fabs(out[j * CH]));
+    double db = 20.0 * log10(peak / 0.5 + 1e-30);
+    printf("   23 kHz into 44.1 kHz: %.1f dB\n", db);
+    if (db > -80.0)
+        return fail("alias: less than 80 dB rejection");
+    printf("OK: alias\n");
+    return 0;
+}
+
+// the block size does not change a bit, blended phases included
+static int test_blocks(void) {
+    static const int rates[][2] = { { 44100, 48000 }, { 44100, 47999 }, { 48000, 22050 } };
+    sine(3000.0, 48000, FRAMES);
+    for (size_t i = 0; i < sizeof rates / sizeof rates[0]; i++) {
+        size_t n1 = convert(rates[i][0], rates[i][1], RESAMPLE_BEST, FRAMES, 1, out);
+        size_t n2 = convert(rates[i][0], rates[i][1], RESAMPLE_BEST, FRAMES, 3001, out2);
+        if (n1 != n2 || memcmp(out, out2, sizeof(float) * n1 * CH))
+            return fail("blocks: output depends on the block size");
+    }
+    printf("OK: blocks\n");
+    return 0;
+}
+
+int main(void) {
+    int failed = 0;
+    failed |= test_tone();
+    failed |= test_length();
+    failed |= test_alias();
+    failed |= test_blocks();
+    return failed;
+}
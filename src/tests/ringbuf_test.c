@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "../ringbuf.h"
+
+#define RING_SIZE   (4096)
+#define CHUNK       (12)        // not a divisor of RING_SIZE, exercises wrap
+#define TOTAL       (2000000u)
+
+static ringbuf_t rb;
+static atomic_int stop;     // consumer gave up, the ring will stay full
+
+static int fail(const char *msg) {
+    fprintf(stderr, "FAIL: %s\n", msg);
+    return 1;
+}
+
+static void *producer(void *arg) {
+    (void)arg;
+    uint32_t next = 0;
+    uint32_t chunk[CHUNK / sizeof(uint32_t)];
+
+    while (next < TOTAL && !atomic_load(&stop)) {
+        for (size_t i = 0; i < CHUNK / sizeof(uint32_t); i++)
+            chunk[i] = next + (uint32_t)i;
+        if (ringbuf_push(&rb, chunk, sizeof chunk) == sizeof chunk)
+            next += CHUNK / sizeof(uint32_t);
+    }
+    return NULL;
+}
+
+static int test_spsc(void) {
+    if (ringbuf_init(&rb, RING_SIZE) < 0)
+        return fail("ringbuf_init");
+
+    pthread_t t;
+    atomic_store(&stop, 0);
+    pthread_create(&t, NULL, producer, NULL);
+
+    uint32_t expect = 0;
+    uint32_t v;
+    int failed = 0;
+    while (expect < TOTAL) {
+        if (ringbuf_pop(&rb, &v, sizeof v) != sizeof v)
+            continue;
+        if (v != expect) {
+            fprintf(stderr, "FAIL spsc: got %u, expected %u\n", v, expect);
+            failed = 1;
+            break;
+        }
+        expect++;
+    }
+    atomic_store(&stop, 1);
+    pthread_join(t, NULL);
+
+    if (!failed && atomic_load(&rb.high_water) > RING_SIZE)
+        failed = fail("spsc: high water above capacity");
+
+    ringbuf_free(&rb);
+    if (!failed) printf("OK: spsc\n");
+    return failed;
+}
+
+static int test_overrun(void) {
+    if (ringbuf_init(&rb, 64) < 0)
+        return fail("ringbuf_init");
+
+    unsigned char buf[48] = {0};
+    int failed = 0;
+    if (ringbuf_push(&rb, buf, sizeof buf) != sizeof buf)
+        failed = fail("overrun: first push rejected");
+    if (ringbuf_push(&rb, buf, sizeof buf) != 0)
+        failed = fail("overrun: second push accepted");
+    if (atomic_load(&rb.overruns) != 1 || atomic_load(&rb.dropped) != sizeof buf)
+        failed = fail("overrun: counters");
+    if (atomic_load(&rb.high_water) != sizeof buf)
+        failed = fail("overrun: high water");
+
+    ringbuf_free(&rb);
+    if (!failed) printf("OK: overrun\n");
+    return failed;
+}
+
+int main(void) {
+    int failed = 0;
+    failed |= test_overrun();
+    failed |= test_spsc();
+    return failed;
+}
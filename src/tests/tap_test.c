@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "../tap.h"
+
+#define NAME     "/wavecli-tap-test"
+#define RING     (64 * 1024)
+#define FRAMES   (250)      // blocks do not divide the ring, exercises pads
+#define CHANNELS (2)
+#define BLOCKS   (200000u)
+
+static tap_t *tap;
+static _Atomic int done;
+
+static int fail(const char *msg) {
+    fprintf(stderr, "FAIL: %s\n", msg);
+    return 1;
+}
+
+// every sample holds its frame number, two points per block like a callback
+static void *producer(void *arg) {
+    (void)arg;
+    static float x[FRAMES * CHANNELS];
+    for (unsigned b = 0; b < BLOCKS; b++) {
+        for (size_t i = 0; i < FRAMES * CHANNELS; i++)
+            x[i] = (float)((tap->frame + i / CHANNELS) & 0xffff);
+        tap_write(tap, TAP_POINT_INPUT, x, FRAMES, CHANNELS, 48000, b);
+        tap_write(tap, TAP_POINT_OUTPUT, x, FRAMES, CHANNELS, 48000, b);
+        tap->frame += FRAMES;
+        if (b % 8 == 0)
+            sched_yield();  // give a reader on the same core a chance
+    }
+    atomic_store(&done, 1);
+    return NULL;
+}
+
+/* a reader that keeps up sees every block, one that is lapped resyncs:
+ * whatever it accepts must be intact */
+static int test_stream(void) {
+    tap = tap_open(NAME, RING);
+    if (!tap)
+        return fail("tap_open");
+    tap_reader_t r;
+    if (tap_reader_open(&r, NAME) < 0)
+        return fail("tap_reader_open");
+
+    pthread_t t;
+    pthread_create(&t, NULL, producer, NULL);
+
+    unsigned long long seen = 0, bad = 0, torn = 0, last_seq = 0;
+    int failed = 0;
+    for (;;) {
+        int finished = atomic_load(&done);
+        const tap_block_t *b = tap_reader_next(&r);
+        if (!b) {
+            if (finished)
+                break;
+            continue;
+        }
+        if (seen && b->seq <= last_seq)
+            failed = fail("stream: seq went backwards");
+        last_seq = b->seq;
+
+        // read first, trust after: a block overwritten meanwhile is dropped
+        const float *x = (const float *)(b + 1);
+        uint64_t frame = b->frame;
+        int ok = b->frames == FRAMES && b->channels == CHANNELS;
+        for (size_t i = 0; ok && i < FRAMES * CHANNELS; i++)
+            ok = x[i] == (float)((frame + i / CHANNELS) & 0xffff);
+        if (!tap_reader_valid(&r)) {
+            torn++;
+            continue;
+        }
+        if (!ok)
+            bad++;
+        seen++;
+    }
+    pthread_join(t, NULL);
+
+    if (bad)
+        failed = fail("stream: a block that passed validation was corrupt");
+    if (seen == 0)
+        failed = fail("stream: nothing read");
+    if (seen + torn < 2 * BLOCKS && r.lost == 0)
+        failed = fail("stream: blocks missing without being counted as lost");
+
+    unsigned long long lost = r.lost;
+    tap_reader_close(&r);
+    tap_close(tap);
+    if (!failed)
+        printf("OK: stream (%llu of %u blocks, %llu torn, %llu bytes lost)\n",
+               seen, 2 * BLOCKS, torn, lost);
+    return failed;
+}
+
+// single threaded: in step, then lapped, then in step again
+static int test_lap(void) {
+    static float x[FRAMES * CHANNELS];
+    tap = tap_open(NAME, RING);
+    if (!tap)
+        return fail("tap_open");
+    tap_reader_t r;
+    if (tap_reader_open(&r, NAME) < 0)
+        return fail("tap_reader_open");
+
+    int failed = 0;
+    const tap_block_t *b;
+    for (int i = 0; i < 100 && !failed; i++) {
+        tap_write(tap, i % 3, x, FRAMES, CHANNELS, 48000, 0);
+        b = tap_reader_next(&r);
+        if (!b || b->seq != (uint64_t)i || b->point != i % 3 || !tap_reader_valid(&r))
+            failed = fail("lap: in step");
+        if (tap_reader_next(&r))
+            failed = fail("lap: read past head");
+    }
+
+    for (int i = 0; i < 100; i++)
+        tap_write(tap, 0, x, FRAMES, CHANNELS, 48000, 0);
+    if (tap_reader_next(&r) || r.lost == 0)
+        failed = fail("lap: lapped reader not resynced");
+    tap_write(tap, 0, x, FRAMES, CHANNELS, 48000, 0);
+    b = tap_reader_next(&r);
+    if (!b || b->seq != 200)
+        failed = fail("lap: no block after resync");
+
+    tap_reader_close(&r);
+    tap_close(tap);
+    if (!failed) printf("OK: lap\n");
+    return failed;
+}
+
+static int test_points(void) {
+    uint32_t mask = 0;
+    int failed = 0;
+    if (tap_point_parse("in", &mask) < 0 || tap_point_parse("3", &mask) < 0
+            || mask != (TAP_POINT_BIT(TAP_POINT_INPUT) | TAP_POINT_BIT(TAP_POINT_STAGE(3))))
+        failed = fail("points: in 3");
+    if (tap_point_parse("16", &mask) == 0 || tap_point_parse("x", &mask) == 0)
+        failed = fail("points: accepted a bad point");
+    if (!failed) printf("OK: points\n");
+    return failed;
+}
+
+int main(void) {
+    int failed = 0;
+    failed |= test_points();
+    failed |= test_lap();
+    failed |= test_stream();
+    return failed;
+}
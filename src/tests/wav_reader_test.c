@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "../wav.h"
+#include "../utils.h"
+
+static const char float_path[] = "./test_reader_f32.wav";
+static const char pcm_path[] = "./test_reader_pcm.wav";
+static const char rf64_path[] = "./test_reader_rf64.wav";
+
+#define FRAMES   (1000)
+#define CHANNELS (2)
+
+static int fail(const char *msg) {
+    fprintf(stderr, "FAIL: %s\n", msg);
+    return 1;
+}
+
+static float ref(size_t i) {
+    return 0.9f * sinf((float)i * 0.01f);
+}
+
+static int test_float_view(void) {
+    wav_writer *w = wav_open(float_path, WAVE_FORMAT_IEEE_FLOAT, 44100, CHANNELS, 32);
+    if (!w) return fail("wav_open");
+    float buf[FRAMES * CHANNELS];
+    for (size_t i = 0; i < FRAMES * CHANNELS; i++)
+        buf[i] = ref(i);
+    wav_write(w, buf, sizeof buf);
+    wav_close(w);
+
+    wav_reader *r = wav_reader_open(float_path);
+    if (!r) return fail("float: wav_reader_open");
+
+    int failed = 0;
+    const SAMPLE *view = wav_reader_float_data(r);
+    if (!view || r->num_frames != FRAMES || r->num_channels != CHANNELS)
+        failed = fail("float: header or view");
+    else if (memcmp(view, buf, sizeof buf) != 0)
+        failed = fail("float: view differs");
+
+    // the iterator hands out the mapping itself
+    const SAMPLE *blk;
+    SAMPLE scratch[64 * CHANNELS];
+    if (!failed && (wav_reader_next_block(r, scratch, 64, &blk) != 64 || blk != view))
+        failed = fail("float: iterator is not zero-copy");
+
+    wav_reader_close(r);
+    remove(float_path);
+    if (!failed) printf("OK: float view\n");
+    return failed;
+}
+
+static void put_chunk(FILE *f, const char *id, uint32_t size) {
+    unsigned char b[4];
+    fwrite(id, 1, 4, f);
+    write_u32_le(b, size);
+    fwrite(b, 1, 4, f);
+}
+
+/* extensible PCM with a LIST chunk before fmt and an odd-sized chunk before data */
+static int write_pcm(int bits) {
+    FILE *f = fopen(pcm_path, "wb");
+    if (!f) return -1;
+
+    const int bytes = bits / 8;
+    const uint32_t data_size = FRAMES * CHANNELS * bytes;
+    unsigned char b[4];
+
+    put_chunk(f, "RIFF", 0);
+    fwrite("WAVE", 1, 4, f);
+    put_chunk(f, "LIST", 4);
+    fwrite("INFO", 1, 4, f);
+
+    put_chunk(f, "fmt ", 40);
+    write_u16_le(b, WAVE_FORMAT_EXTENSIBLE); fwrite(b, 1, 2, f);
+    write_u16_le(b, CHANNELS);               fwrite(b, 1, 2, f);
+    write_u32_le(b, 48000);                  fwrite(b, 1, 4, f);
+    write_u32_le(b, 48000 * CHANNELS * bytes); fwrite(b, 1, 4, f);
+    write_u16_le(b, CHANNELS * bytes);       fwrite(b, 1, 2, f);
+    write_u16_le(b, bits);                   fwrite(b, 1, 2, f);
+    write_u16_le(b, 22);                     fwrite(b, 1, 2, f);   // cbSize
+    write_u16_le(b, bits);                   fwrite(b, 1, 2, f);   // valid bits
+    write_u32_le(b, 0x3);                    fwrite(b, 1, 4, f);   // channel mask
+    write_u16_le(b, WAVE_FORMAT_PCM);        fwrite(b, 1, 2, f);   // subformat GUID
+    fwrite("\x00\x00\x00\x00\x10\x00\x80\x00\x00\xAA\x00\x38\x9B\x71", 1, 14, f);
+
+    put_chunk(f, "junk", 3);
+    fwrite("abc\0", 1, 4, f);   // 3 bytes + pad
+
+    put_chunk(f, "data", data_size);
+    for (size_t i = 0; i < FRAMES * CHANNELS; i++) {
+        int64_t v = (int64_t)lrintf(ref(i) * (float)(1u << (bits - 1)));
+        for (int k = 0; k < bytes; k++)
+            fputc((int)((v >> (8 * k)) & 0xFF), f);
+    }
+    return fclose(f);
+}
+
+static int test_pcm(int bits) {
+    char name[32];
+    snprintf(name, sizeof name, "pcm%d", bits);
+
+    if (write_pcm(bits) < 0) return fail("write_pcm");
+    wav_reader *r = wav_reader_open(pcm_path);
+    if (!r) return fail(name);
+
+    int failed = 0;
+    if (r->num_frames != FRAMES || r->sample_rate != 48000 || wav_reader_float_data(r))
+        failed = fail(name);
+
+    // tolerance: one LSB of the smaller of 24 bit and the format
+    const float tol = 1.0f / (float)(1u << ((bits > 24 ? 24 : bits) - 1));
+    SAMPLE scratch[100 * CHANNELS];
+    const SAMPLE *blk;
+    size_t n, frame = 0;
+    while (!failed && (n = wav_reader_next_block(r, scratch, 100, &blk)) > 0) {
+        for (size_t i = 0; i < n * CHANNELS; i++) {
+            if (fabsf(blk[i] - ref(frame * CHANNELS + i)) > tol) {
+                fprintf(stderr, "FAIL %s: sample %zu\n", name, frame * CHANNELS + i);
+                failed = 1;
+                break;
+            }
+        }
+        frame += n;
+    }
+    if (!failed && frame != FRAMES)
+        failed = fail(name);
+
+    wav_reader_close(r);
+    remove(pcm_path);
+    if (!failed) printf("OK: %s\n", name);
+    return failed;
+}
+
+/* data past 4 GiB: the writer must switch to RF64 and the reader must
+ * follow ds64. the file is sparse, only the first frames hold data */
+static int test_rf64(void) {
+    const uint64_t data = (5ull << 30) + 8 * 3;
+    wav_writer *w = wav_open(rf64_path, WAVE_FORMAT_IEEE_FLOAT, 48000, CHANNELS, 32);
+    if (!w) return fail("rf64: wav_open");
+    float buf[FRAMES * CHANNELS];
+    for (size_t i = 0; i < FRAMES * CHANNELS; i++)
+        buf[i] = ref(i);
+    wav_write(w, buf, sizeof buf);
+    fflush(w->file);
+    if (ftruncate(fileno(w->file), (off_t)(WAV_HEADER_SIZE + data)) < 0) {
+        wav_close(w);
+        remove(rf64_path);
+        return fail("rf64: ftruncate");
+    }
+    w->data_bytes = data;
+    w->num_samples = data / (4 * CHANNELS);
+    if (wav_close(w) < 0) return fail("rf64: wav_close");
+
+    int failed = 0;
+    unsigned char head[WAV_HEADER_SIZE];
+    FILE *f = fopen(rf64_path, "rb");
+    if (!f || fread(head, 1, sizeof head, f) != sizeof head)
+        failed = fail("rf64: read header");
+    if (f) fclose(f);
+    if (!failed && (memcmp(head, "RF64", 4) || memcmp(head + 12, "ds64", 4)))
+        failed = fail("rf64: not promoted");
+
+    wav_reader *r = failed ? NULL : wav_reader_open(rf64_path);
+    if (!failed && !r)
+        failed = fail("rf64: wav_reader_open");
+    if (r) {
+        if (r->data_bytes != data || r->num_frames != data / (4 * CHANNELS))
+            failed = fail("rf64: data size");
+        else if (memcmp(wav_reader_float_data(r), buf, sizeof buf))
+            failed = fail("rf64: data");
+        wav_reader_close(r);
+    }
+    remove(rf64_path);
+    if (!failed) printf("OK: rf64\n");
+    return failed;
+}
+
+/* writer killed before wav_close: sizes still 0, a torn frame at the end */
+static int test_repair(void) {
+    wav_writer *w = wav_open(float_path, WAVE_FORMAT_IEEE_FLOAT, 44100, CHANNELS, 32);
+    if (!w) return fail("repair: wav_open");
+    float buf[FRAMES * CHANNELS];
+    for (size_t i = 0; i < FRAMES * CHANNELS; i++)
+        buf[i] = ref(i);
+    wav_write(w, buf, sizeof buf);
+    wav_write(w, buf, 5);
+    fclose(w->file);
+    free(w);
+
+    int failed = 0;
+    size_t frames = 0, old_frames = 1;
+    if (wav_repair(float_path, &frames, &old_frames) < 0 || frames != FRAMES || old_frames != 0)
+        failed = fail("repair: sizes");
+
+    wav_reader *r = failed ? NULL : wav_reader_open(float_path);
+    if (!failed && (!r || r->num_frames != FRAMES
+                || memcmp(wav_reader_float_data(r), buf, sizeof buf)))
+        failed = fail("repair: reread");
+    wav_reader_close(r);
+    remove(float_path);
+    if (!failed) printf("OK: repair\n");
+    return failed;
+}
+
+int main(void) {
+    int failed = 0;
+    failed |= test_float_view();
+    failed |= test_pcm(16);
+    failed |= test_pcm(24);
+    failed |= test_pcm(32);
+    failed |= test_rf64();
+    failed |= test_repair();
+    return failed;
+}
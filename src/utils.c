@@ -28,10 +28,10 @@ int parse_int(const char *s, int *out) {
 
 int parse_float(const char *s, float *out) {
     char *end;
-    long v = strtof(s, &end);
+    float v = strtof(s, &end);
     if (end == s || *end != '\0') 
         return -1; 
-    *out = (int)v;
+    *out = v;
     return 0;
 }
 
@@ -61,6 +61,8 @@ int stdin_readline(const char *prompt, void *line){
     }
 
     *p_line = '\0';
+    if (c == EOF && cnt == 0)
+        return -1;
     return 0;
 } 
 
@@ -147,6 +149,12 @@ void write_u32_le(unsigned char *out, uint32_t v){
     out[3] = (unsigned char)((v >> 24) & 0xFFu);
 }
 
+//out >= 8
+void write_u64_le(unsigned char *out, uint64_t v){
+    write_u32_le(out, (uint32_t)v);
+    write_u32_le(out + 4, (uint32_t)(v >> 32));
+}
+
 //out >= 2
 void write_u16_le(unsigned char *out, uint16_t v){
     out[0] = (unsigned char)( v        & 0xFFu);
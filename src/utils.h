@@ -25,6 +25,7 @@ int parse_float(const char *s, float *out);
 char **split(char *s, size_t *n);
 void split_free(char **v, size_t n);
 int stdin_readline(const char *prompt, void *line);
+void write_u64_le(unsigned char *out, uint64_t v);
 void write_u32_le(unsigned char *out, uint32_t v);
 void write_u16_le(unsigned char *out, uint32_t v);
 #endif
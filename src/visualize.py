@@ -2,16 +2,93 @@ import numpy as np
 import matplotlib.pyplot as plt
 from matplotlib.widgets import Slider, RectangleSelector
 import os
+import struct
 import argparse
 
 # --- Constants ---
 INITIAL_WINDOW_SEC = 2.0
 DTYPE = np.float32
 BYTES_PER_SAMPLE = np.dtype(DTYPE).itemsize
-MAX_WIDTH_SEC = 2.0  # Max zoom out (increase if you want)
+MAX_WIDTH_SEC = 2.0  # Max zoom out without a .peaks overview
+PEAKS_SUFFIX = ".peaks"
+
+
+class Pcm24:
+    """one channel of packed 3-byte little-endian samples, decoded per slice to int32"""
+    def __init__(self, raw):
+        self.raw = raw          # (frames, 3) uint8 view of the memmap
+        self.size = raw.shape[0]
+
+    def __getitem__(self, key):
+        b = self.raw[key].astype(np.int32)
+        v = b[..., 0] | (b[..., 1] << 8) | (b[..., 2] << 16)
+        return (v << 8) >> 8    # sign-extend bit 23
+
+
+def open_wav(path, channel):
+    """memmap one channel of a float32/PCM16/24/32 WAV (RIFF or RF64), returns (samples, rate, scale)"""
+    with open(path, 'rb') as fh:
+        head = fh.read(1 << 20)
+    if head[8:12] != b'WAVE' or head[:4] not in (b'RIFF', b'RF64', b'BW64'):
+        return None
+    pos, fmt, ds64_data = 12, None, None
+    while pos + 8 <= len(head):
+        cid = head[pos:pos + 4]
+        size = struct.unpack_from('<I', head, pos + 4)[0]
+        if cid == b'ds64':
+            ds64_data = struct.unpack_from('<Q', head, pos + 16)[0]
+        elif cid == b'fmt ':
+            fmt = list(struct.unpack_from('<HHIIHH', head, pos + 8))
+            if fmt[0] == 0xFFFE and size >= 26:     # WAVE_FORMAT_EXTENSIBLE: subformat tag
+                fmt[0] = struct.unpack_from('<H', head, pos + 8 + 24)[0]
+        elif cid == b'data':
+            tag, channels, rate, _, _, bits = fmt
+            if size == 0xFFFFFFFF and ds64_data is not None:
+                size = ds64_data
+            offset = pos + 8
+            size = min(size or os.path.getsize(path), os.path.getsize(path) - offset)
+            if tag == 3 and bits == 32:
+                dtype, scale = np.float32, 1.0
+            elif tag == 1 and bits == 16:
+                dtype, scale = np.int16, 1.0 / 32768
+            elif tag == 1 and bits == 24:
+                frames = size // (channels * 3)
+                mm = np.memmap(path, dtype=np.uint8, mode='r', offset=offset, shape=(frames, channels, 3))
+                return Pcm24(mm[:, min(channel, channels - 1), :]), rate, 1.0 / 8388608
+            elif tag == 1 and bits == 32:
+                dtype, scale = np.int32, 1.0 / 2147483648
+            else:
+                raise RuntimeError(f"only float32 and PCM16/24/32 WAV, got format {tag}/{bits} bit")
+            frames = size // (channels * np.dtype(dtype).itemsize)
+            mm = np.memmap(path, dtype=dtype, mode='r', offset=offset, shape=(frames, channels))
+            return mm[:, min(channel, channels - 1)], rate, scale
+        pos += 8 + size + (size & 1)
+    raise RuntimeError("no data chunk")
+
+
+def open_peaks(path, channel):
+    """levels of FILE.peaks as [(frames per bucket, (buckets, 3) min/max/rms view)], coarsest last"""
+    if not os.path.exists(path + PEAKS_SUFFIX):
+        return []
+    p = path + PEAKS_SUFFIX
+    with open(p, 'rb') as fh:
+        head = fh.read(32)
+        if head[:4] != b'WVPK':
+            return []
+        _, channels, _, frames, nlevels = struct.unpack_from('<IIIQI', head, 4)
+        table = fh.read(16 * nlevels)
+    if frames == 0:     # still recording, header not written yet
+        return []
+    levels = []
+    for l in range(nlevels):
+        bucket, _, offset = struct.unpack_from('<IIQ', table, 16 * l)
+        buckets = -(-frames // bucket)
+        mm = np.memmap(p, dtype=np.float32, mode='r', offset=offset, shape=(buckets, channels, 3))
+        levels.append((bucket, mm[:, min(channel, channels - 1), :]))
+    return levels
 
 class WaveformVisualizer:
-    def __init__(self, filenames, rate, min_zoom_samples=100):
+    def __init__(self, filenames, rate, min_zoom_samples=100, channel=0):
         self.rate = rate
         self.navigating = False
         self.filenames = filenames
@@ -22,24 +99,35 @@ class WaveformVisualizer:
         self.lines = []
         self.max_samples = 0
 
-        # Load files (raw float32)
+        # Load files: WAV (float32/PCM16/24/32, one channel) or raw float32,
+        # plus the FILE.peaks overview when there is one
+        self.peaks = []
+        self.scales = []
         for f in filenames:
             try:
-                fsize = os.path.getsize(f)
-                samples = fsize // BYTES_PER_SAMPLE
-                if samples <= 0:
+                wav = open_wav(f, channel) if f.lower().endswith('.wav') else None
+                if wav:
+                    mm, self.rate, scale = wav
+                else:
+                    fsize = os.path.getsize(f)
+                    mm, scale = np.memmap(f, dtype=DTYPE, mode='r', shape=(fsize // BYTES_PER_SAMPLE,)), 1.0
+                if mm.size <= 0:
                     raise RuntimeError("file too small / empty")
 
-                mm = np.memmap(f, dtype=DTYPE, mode='r', shape=(samples,))
                 self.mapped_files.append((mm, os.path.basename(f)))
-                self.max_samples = max(self.max_samples, samples)
+                self.scales.append(scale)
+                self.peaks.append(open_peaks(f, channel))
+                self.max_samples = max(self.max_samples, mm.size)
             except Exception as e:
                 print(f"Error opening {f}: {e}")
 
         if not self.mapped_files:
             raise SystemExit("No files loaded.")
+        self.min_width_sec = min_zoom_samples / self.rate
 
         self.duration_sec = self.max_samples / self.rate
+        global MAX_WIDTH_SEC
+        MAX_WIDTH_SEC = min(MAX_WIDTH_SEC, self.duration_sec)
         self.setup_ui()
 
     def setup_ui(self):
@@ -75,6 +163,30 @@ class WaveformVisualizer:
         self.update_view(0, INITIAL_WINDOW_SEC)
         plt.show()
 
+    def pick_level(self, levels, samples):
+        """coarsest level that still has a bucket or more per pixel, None for raw samples"""
+        pixels = max(100, int(self.ax.get_window_extent().width))
+        per_pixel = samples / pixels
+        best = None
+        for bucket, view in levels:
+            if bucket <= per_pixel:
+                best = (bucket, view)
+        return best
+
+    def draw_peaks(self, line, level, start_sample, end_sample):
+        # one vertical min..max stroke per bucket: O(pixels) whatever the zoom
+        bucket, view = level
+        b0 = start_sample // bucket
+        b1 = min(-(-end_sample // bucket), view.shape[0])
+        if b1 <= b0:
+            line.set_data([], [])
+            return None
+        rec = np.asarray(view[b0:b1])
+        t = (np.arange(b0, b1, dtype=np.float64) * bucket) / self.rate
+        line.set_data(np.repeat(t, 2), rec[:, :2].ravel())
+        line.set_marker("")
+        return float(rec[:, 0].min()), float(rec[:, 1].max())
+
     def get_chunk(self, start_time, window_duration):
         start_sample = max(0, int(start_time * self.rate))
         end_sample = int((start_time + window_duration) * self.rate)
@@ -82,7 +194,7 @@ class WaveformVisualizer:
         global_min_y, global_max_y = 1e9, -1e9
         has_data = False
 
-        for line, (mm, _) in zip(self.lines, self.mapped_files):
+        for line, (mm, _), levels, scale in zip(self.lines, self.mapped_files, self.peaks, self.scales):
             if start_sample >= mm.size:
                 line.set_data([], [])
                 continue
@@ -92,7 +204,18 @@ class WaveformVisualizer:
                 line.set_data([], [])
                 continue
 
+            level = self.pick_level(levels, safe_end - start_sample)
+            if level:
+                span = self.draw_peaks(line, level, start_sample, safe_end)
+                if span:
+                    global_min_y = min(global_min_y, span[0])
+                    global_max_y = max(global_max_y, span[1])
+                    has_data = True
+                continue
+
             chunk = mm[start_sample:safe_end]
+            if scale != 1.0:
+                chunk = chunk.astype(np.float32) * scale
 
             if chunk.size > 0:
                 t_origin = start_sample / self.rate
@@ -288,14 +411,20 @@ class WaveformVisualizer:
 
 
 if __name__ == "__main__":
-    parser = argparse.ArgumentParser(description="Raw float32 audio waveform visualizer (mmap)")
-    parser.add_argument('files', nargs='+', help="Input .raw files (float32)")
-    parser.add_argument('--rate', type=int, default=44100, help="Sample rate (Hz)")
+    parser = argparse.ArgumentParser(description="Waveform visualizer (mmap) for WAV or raw float32")
+    parser.add_argument('files', nargs='+', help="Input .wav (float32/PCM16/24/32) or raw float32 files; "
+                        "FILE.peaks from `wavecli peaks` is used when present")
+    parser.add_argument('--rate', type=int, default=44100, help="Sample rate of raw files (Hz)")
+    parser.add_argument('--channel', type=int, default=0, help="Channel of multichannel WAVs")
     parser.add_argument('--min-zoom-samples', type=int, default=100, help="Minimum samples when zoomed in")
-    parser.add_argument('--max-width-sec', type=float, default=2.0, help="Max zoom-out window (sec)")
+    parser.add_argument('--max-width-sec', type=float, default=None,
+                        help="Max zoom-out window (sec, def: 2, whole file with .peaks)")
     args = parser.parse_args()
 
-    # allow override of MAX_WIDTH_SEC from CLI
-    MAX_WIDTH_SEC = max(0.001, float(args.max_width_sec))
+    # with an overview for every file any zoom is cheap
+    if args.max_width_sec is not None:
+        MAX_WIDTH_SEC = max(0.001, float(args.max_width_sec))
+    elif all(os.path.exists(f + PEAKS_SUFFIX) for f in args.files):
+        MAX_WIDTH_SEC = float('inf')
 
-    WaveformVisualizer(args.files, args.rate, args.min_zoom_samples)
+    WaveformVisualizer(args.files, args.rate, args.min_zoom_samples, args.channel)
@@ -1,7 +1,15 @@
+#define _GNU_SOURCE    // O_DIRECT, fallocate
+
+#include <errno.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/falloc.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "wav.h"
 #include "utils.h"
@@ -11,6 +19,16 @@ static const char FORMAT[]   = { 'W','A','V','E' };
 static const char SUBCHUNK1_ID[] = { 'f','m','t',' ' };
 static const uint32_t SUBCHUNK1_SIZE = 16;
 static const char SUBCHUNK2_ID[] = { 'd','a','t','a' };
+static const char JUNK_ID[] = { 'J','U','N','K' };
+static const char RF64_ID[] = { 'R','F','6','4' };
+static const char BW64_ID[] = { 'B','W','6','4' };
+static const char DS64_ID[] = { 'd','s','6','4' };
+
+// header offsets, see WAV_HEADER_SIZE
+#define OFF_RIFF_SIZE (4)
+#define OFF_DS64 (12)
+#define OFF_DS64_BODY (20)
+#define OFF_DATA_SIZE (76)
 
 const char MODES[] = "wb";
 
@@ -21,6 +39,18 @@ wav_writer *wav_open(
     int channels, 
     int bits_per_sample
 )
+{
+    return wav_open_ex(path, audio_format, sample_rate, channels, bits_per_sample, 0);
+}
+
+wav_writer *wav_open_ex(
+    const char *path,
+    int audio_format,
+    int sample_rate,
+    int channels,
+    int bits_per_sample,
+    int flags
+)
 {   
     wav_writer *w = calloc(1, sizeof(wav_writer));
     if (!w)
@@ -29,10 +59,27 @@ wav_writer *wav_open(
     w->bits_per_sample = bits_per_sample; 
     w->sample_rate = sample_rate;
     w->num_channels = channels;
+    w->flags = flags;
+    w->dfd = -1;
     w->file = fopen(path, MODES);
     if (!w->file)
         goto criterro;
 
+    // O_DIRECT on a second descriptor: the FILE one patches the header
+    if (flags & WAV_DIRECT){
+        w->dfd = open(path, O_WRONLY | O_DIRECT);
+        w->dbuf = aligned_alloc(WAV_DIRECT_ALIGN, WAV_DIRECT_BUFFER);
+        if (w->dfd < 0 || !w->dbuf){
+            fprintf(stderr, "wav_open: %s: no O_DIRECT here, using the page cache\n", path);
+            if (w->dfd >= 0)
+                close(w->dfd);
+            free(w->dbuf);
+            w->dfd = -1;
+            w->dbuf = NULL;
+            w->flags &= ~WAV_DIRECT;
+        }
+    }
+
     char header[WAV_HEADER_SIZE];
     memset(header, 0, WAV_HEADER_SIZE);    
     char *header_p = header; 
@@ -51,6 +98,13 @@ wav_writer *wav_open(
     memcpy(header_p, FORMAT, sizeof FORMAT);
     header_p += sizeof FORMAT;
 
+    //JUNK, zeroed: placeholder for a ds64 chunk
+    memcpy(header_p, JUNK_ID, sizeof JUNK_ID);
+    header_p += sizeof JUNK_ID;
+    write_u32_le(b32, WAV_DS64_SIZE);
+    memcpy(header_p, b32, 4);
+    header_p += 4 + WAV_DS64_SIZE;
+
     //Subchunk1ID: "fmt "
     memcpy(header_p, SUBCHUNK1_ID, sizeof SUBCHUNK1_ID);
     header_p += sizeof SUBCHUNK1_ID;
@@ -97,7 +151,10 @@ wav_writer *wav_open(
     header_p += sizeof SUBCHUNK2_ID;
 
 
-    if (fwrite(header, WAV_HEADER_SIZE, 1, w->file) != 1)
+    if (w->flags & WAV_DIRECT){
+        memcpy(w->dbuf, header, WAV_HEADER_SIZE);
+        w->dfill = WAV_HEADER_SIZE;
+    } else if (fwrite(header, WAV_HEADER_SIZE, 1, w->file) != 1)
         goto criterro;
 
     return w;
@@ -106,45 +163,528 @@ criterro:
     perror("wav_open");
     if (w) {
         if (w->file) fclose(w->file);
+        if (w->dfd >= 0) close(w->dfd);
+        free(w->dbuf);
         free(w);
     }
     return NULL;
 }
 
+static int pwrite_all(int fd, const void *data, size_t n, off_t off){
+    const unsigned char *p = data;
+    size_t done = 0;
+    while (done < n){
+        ssize_t k = pwrite(fd, p + done, n - done, off + (off_t)done);
+        if (k < 0){
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        done += (size_t)k;
+    }
+    return 0;
+}
+
+// keep WAV_PREALLOC_BYTES allocated in front of the write position
+static void prealloc(wav_writer *w, off_t end){
+    while (end > w->alloc_end){
+        if (fallocate(fileno(w->file), FALLOC_FL_KEEP_SIZE, w->alloc_end,
+                    WAV_PREALLOC_BYTES) < 0){
+            DEBUG_PRINTF("fallocate: %s, preallocation off\n", strerror(errno));
+            w->flags &= ~WAV_PREALLOC;
+            return;
+        }
+        w->alloc_end += WAV_PREALLOC_BYTES;
+    }
+}
+
+/* O_DIRECT out of the staging buffer. the whole aligned part goes out,
+ * the rest moves to the front; `all` also writes the unaligned tail
+ * through the page cache, for close */
+static int flush_direct(wav_writer *w, int all){
+    size_t n = w->dfill / WAV_DIRECT_ALIGN * WAV_DIRECT_ALIGN;
+    if (n && pwrite_all(w->dfd, w->dbuf, n, w->dbase) < 0){
+        perror("wav_write: O_DIRECT");
+        return -1;
+    }
+    w->dbase += (off_t)n;
+    w->dfill -= n;
+    memmove(w->dbuf, w->dbuf + n, w->dfill);
+
+    if (all && w->dfill){
+        if (pwrite_all(fileno(w->file), w->dbuf, w->dfill, w->dbase) < 0){
+            perror("wav_write");
+            return -1;
+        }
+        w->dbase += (off_t)w->dfill;
+        w->dfill = 0;
+    }
+    return 0;
+}
+
+static size_t write_direct(wav_writer *w, const void *data, size_t bytes){
+    const unsigned char *p = data;
+    size_t done = 0;
+    while (done < bytes){
+        size_t k = WAV_DIRECT_BUFFER - w->dfill;
+        if (k > bytes - done)
+            k = bytes - done;
+        memcpy(w->dbuf + w->dfill, p + done, k);
+        w->dfill += k;
+        done += k;
+        if (w->dfill == WAV_DIRECT_BUFFER && flush_direct(w, 0) < 0)
+            return done - k;
+    }
+    return done;
+}
+
 size_t wav_write(wav_writer *w, const void *data, size_t bytes) {
-    size_t written = fwrite(data, 1, bytes, w->file);
+    if (w->flags & WAV_PREALLOC)
+        prealloc(w, (off_t)(WAV_HEADER_SIZE + w->data_bytes + bytes));
+
+    size_t written = (w->flags & WAV_DIRECT) ? write_direct(w, data, bytes)
+                                             : fwrite(data, 1, bytes, w->file);
     size_t bytes_per_sample = (size_t)w->bits_per_sample / 8;
 
+    // count bytes, callers may hand over a frame in two pieces
+    w->data_bytes += written;
     if (bytes_per_sample && w->num_channels > 0)
-        w->num_samples += written / (bytes_per_sample * (size_t)w->num_channels);
+        w->num_samples = w->data_bytes / (bytes_per_sample * (size_t)w->num_channels);
 
     return written;
 }
 
-int wav_close(wav_writer *w){
-    unsigned char b[4];
+/* size the file for frames of data up front and count them as written,
+ * so wav_close writes the final header. the data is then filled in with
+ * wav_pwrite in any order, from any thread */
+int wav_reserve(wav_writer *w, size_t frames){
+    size_t bytes = frames * (size_t)w->num_channels * ((size_t)w->bits_per_sample / 8);
+    if (fflush(w->file) != 0){
+        perror("wav_reserve");
+        return -1;
+    }
+    int err = posix_fallocate(fileno(w->file), 0, (off_t)(WAV_HEADER_SIZE + bytes));
+    if (err){
+        fprintf(stderr, "wav_reserve: %s\n", strerror(err));
+        return -1;
+    }
+    w->data_bytes = bytes;
+    w->num_samples = frames;
+    return 0;
+}
+
+/* bytes at data frame `frame`, bypassing the FILE buffer. only inside
+ * the area set up by wav_reserve */
+size_t wav_pwrite(wav_writer *w, const void *data, size_t bytes, size_t frame){
+    size_t frame_bytes = (size_t)w->num_channels * ((size_t)w->bits_per_sample / 8);
+    off_t off = (off_t)WAV_HEADER_SIZE + (off_t)(frame * frame_bytes);
+    if (pwrite_all(fileno(w->file), data, bytes, off) < 0){
+        perror("wav_pwrite");
+        return 0;
+    }
+    return bytes;
+}
 
-    //Subchunk2Size: 32 LE. OFF 49
-    uint32_t subchunk2size = (uint32_t)(w->num_samples * (size_t)w->num_channels * (size_t)w->bits_per_sample / 8u);
-    write_u32_le(b, subchunk2size);
+/* RIFF and data sizes for `data` bytes at data_off. past 4 GiB the file
+ * becomes RF64: the chunk at ds64_off (our JUNK) turns into ds64 with the
+ * 64-bit sizes and the 32-bit fields read 0xFFFFFFFF */
+static int write_sizes(int fd, off_t data_size_off, off_t ds64_off, uint64_t data_off,
+        uint64_t data, uint64_t frames){
+    unsigned char b[WAV_DS64_SIZE];
+    uint64_t riff = data_off - 8 + data + (data & 1);    // chunks are word aligned
 
-    if (fseek(w->file, 40, SEEK_SET) != 0) 
-        return -1;
-    if (fwrite(b, 1, 4, w->file) != 4) 
+    if (riff > UINT32_MAX){
+        if (ds64_off < 0){
+            fprintf(stderr, "wav: over 4 GiB and no room for a ds64 chunk\n");
+            return -1;
+        }
+        memset(b, 0, sizeof b);
+        write_u64_le(b, riff);
+        write_u64_le(b + 8, data);
+        write_u64_le(b + 16, frames);   // table length stays 0
+        if (pwrite_all(fd, RF64_ID, 4, 0) < 0
+                || pwrite_all(fd, DS64_ID, 4, ds64_off) < 0
+                || pwrite_all(fd, b, WAV_DS64_SIZE, ds64_off + 8) < 0)
+            return -1;
+        riff = data = UINT32_MAX;
+    }
+
+    write_u32_le(b, (uint32_t)data);
+    if (pwrite_all(fd, b, 4, data_size_off) < 0)
         return -1;
-    
-    //chunksize: 32 LE. OFF 4
-    uint32_t chunksize = 36u + subchunk2size;
-    write_u32_le(b, chunksize);
+    write_u32_le(b, (uint32_t)riff);
+    return pwrite_all(fd, b, 4, OFF_RIFF_SIZE);
+}
+
+/* make what was written so far durable and readable after a crash: data
+ * out of the buffers, sizes into the header (whole frames only), then
+ * fdatasync. for the writer thread, every few seconds */
+int wav_commit(wav_writer *w){
+    int fd = fileno(w->file);
+    size_t frame_bytes = (size_t)w->num_channels * ((size_t)w->bits_per_sample / 8);
+    uint64_t data;
 
-    if (fseek(w->file, 4, SEEK_SET) != 0) 
+    if (w->flags & WAV_DIRECT){
+        // the unaligned tail stays staged, it is not on disk yet
+        if (flush_direct(w, 0) < 0)
+            return -1;
+        data = w->dbase > WAV_HEADER_SIZE ? (uint64_t)w->dbase - WAV_HEADER_SIZE : 0;
+    } else {
+        if (fflush(w->file) != 0)
+            return -1;
+        data = w->data_bytes;
+    }
+    data = data / frame_bytes * frame_bytes;
+
+    if (write_sizes(fd, OFF_DATA_SIZE, OFF_DS64, WAV_HEADER_SIZE, data, data / frame_bytes) < 0)
         return -1;
-    if (fwrite(b, 1, 4, w->file) != 4) 
+    // block 0 still staged: give it the new sizes or it overwrites them
+    if (w->dbase == 0 && w->dfill >= WAV_HEADER_SIZE
+            && pread(fd, w->dbuf, WAV_HEADER_SIZE, 0) != WAV_HEADER_SIZE)
         return -1;
+    return fdatasync(fd);
+}
 
-    if (fclose(w->file) != 0) 
-        return -1;
+/* final sizes, see write_sizes */
+int wav_close(wav_writer *w){
+    int fd = fileno(w->file);
+    uint64_t data = w->data_bytes;
+    int rc = 0;
+
+    if (w->flags & WAV_DIRECT){
+        if (flush_direct(w, 1) < 0)
+            rc = -1;
+        close(w->dfd);
+        free(w->dbuf);
+    } else if (fflush(w->file) != 0)
+        rc = -1;
+
+    if ((data & 1) && pwrite_all(fd, "", 1, (off_t)(WAV_HEADER_SIZE + data)) < 0)
+        rc = -1;
+    if (write_sizes(fd, OFF_DATA_SIZE, OFF_DS64, WAV_HEADER_SIZE, data, w->num_samples) < 0)
+        rc = -1;
+    // drop preallocated extents past the end
+    if ((w->flags & WAV_PREALLOC) && w->alloc_end
+            && ftruncate(fd, (off_t)(WAV_HEADER_SIZE + data + (data & 1))) < 0)
+        rc = -1;
+
+    if (fclose(w->file) != 0)
+        rc = -1;
 
     free(w);
+    return rc;
+}
+
+static uint32_t read_u32_le(const unsigned char *p){
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t read_u64_le(const unsigned char *p){
+    return (uint64_t)read_u32_le(p) | ((uint64_t)read_u32_le(p + 4) << 32);
+}
+
+static uint16_t read_u16_le(const unsigned char *p){
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+// first two bytes of the KSDATAFORMAT_SUBTYPE_* GUID carry the format tag
+#define FMT_EXTENSIBLE_SUBFORMAT_OFF (24)
+
+static int parse_fmt(wav_reader *r, const unsigned char *fmt, uint32_t size){
+    if (size < 16)
+        return -1;
+
+    r->audio_format = read_u16_le(fmt);
+    r->num_channels = read_u16_le(fmt + 2);
+    r->sample_rate = (int)read_u32_le(fmt + 4);
+    r->block_align = read_u16_le(fmt + 12);
+    r->bits_per_sample = read_u16_le(fmt + 14);
+
+    if (r->audio_format == WAVE_FORMAT_EXTENSIBLE){
+        if (size < FMT_EXTENSIBLE_SUBFORMAT_OFF + 2)
+            return -1;
+        r->audio_format = read_u16_le(fmt + FMT_EXTENSIBLE_SUBFORMAT_OFF);
+    }
+    return 0;
+}
+
+static int format_supported(const wav_reader *r){
+    if (r->num_channels < 1 || r->block_align != (size_t)r->num_channels * r->bits_per_sample / 8)
+        return 0;
+    if (r->audio_format == WAVE_FORMAT_IEEE_FLOAT)
+        return r->bits_per_sample == 32;
+    if (r->audio_format == WAVE_FORMAT_PCM)
+        return r->bits_per_sample == 16 || r->bits_per_sample == 24 || r->bits_per_sample == 32;
     return 0;
 }
+
+wav_reader *wav_reader_open(const char *path){
+    wav_reader *r = calloc(1, sizeof(wav_reader));
+    if (!r)
+        goto criterro;
+    r->fd = -1;
+
+    r->fd = open(path, O_RDONLY);
+    if (r->fd < 0)
+        goto criterro;
+
+    struct stat st;
+    if (fstat(r->fd, &st) < 0)
+        goto criterro;
+    r->map_size = (size_t)st.st_size;
+    if (r->map_size < 12){
+        fprintf(stderr, "wav_reader_open: %s: not a RIFF/WAVE file\n", path);
+        goto err;
+    }
+
+    r->map = mmap(NULL, r->map_size, PROT_READ, MAP_SHARED, r->fd, 0);
+    if (r->map == MAP_FAILED){
+        r->map = NULL;
+        goto criterro;
+    }
+
+    const unsigned char *p = r->map;
+    const unsigned char *end = r->map + r->map_size;
+    int is_rf64 = memcmp(p, RF64_ID, 4) == 0 || memcmp(p, BW64_ID, 4) == 0;
+    if ((memcmp(p, CHUNK_ID, 4) != 0 && !is_rf64) || memcmp(p + 8, FORMAT, 4) != 0){
+        fprintf(stderr, "wav_reader_open: %s: not a RIFF/WAVE file\n", path);
+        goto err;
+    }
+    p += 12;
+
+    int have_fmt = 0;
+    uint64_t ds64_data = 0;     // RF64: real size of the data chunk
+    while (!r->data){
+        if (end - p < 8){
+            fprintf(stderr, "wav_reader_open: %s: no data chunk\n", path);
+            goto err;
+        }
+        uint32_t size = read_u32_le(p + 4);
+        const unsigned char *body = p + 8;
+        size_t left = (size_t)(end - body);
+
+        if (is_rf64 && memcmp(p, DS64_ID, 4) == 0){
+            if (size < 24 || size > left){
+                fprintf(stderr, "wav_reader_open: %s: bad ds64 chunk\n", path);
+                goto err;
+            }
+            ds64_data = read_u64_le(body + 8);
+        } else if (memcmp(p, SUBCHUNK1_ID, 4) == 0){
+            if (size > left || parse_fmt(r, body, size) < 0){
+                fprintf(stderr, "wav_reader_open: %s: bad fmt chunk\n", path);
+                goto err;
+            }
+            have_fmt = 1;
+        } else if (memcmp(p, SUBCHUNK2_ID, 4) == 0){
+            if (!have_fmt){
+                fprintf(stderr, "wav_reader_open: %s: data before fmt\n", path);
+                goto err;
+            }
+            uint64_t bytes = size;
+            if (is_rf64 && size == UINT32_MAX)
+                bytes = ds64_data;
+            // unfinished recordings leave 0 or a stale size, trust the file
+            if (bytes == 0 || bytes > left)
+                bytes = left;
+            r->data = body;
+            r->data_bytes = (size_t)bytes;
+            break;
+        }
+
+        // chunks are word aligned
+        size_t skip = (size_t)size + (size & 1);
+        if (skip > left)
+            skip = left;
+        p = body + skip;
+    }
+
+    if (!format_supported(r)){
+        fprintf(stderr, "wav_reader_open: %s: unsupported format %d/%d bit\n",
+                path, r->audio_format, r->bits_per_sample);
+        goto err;
+    }
+
+    r->num_frames = r->data_bytes / r->block_align;
+    madvise((void *)r->map, r->map_size, MADV_SEQUENTIAL);
+    return r;
+
+criterro:
+    perror("wav_reader_open");
+err:
+    wav_reader_close(r);
+    return NULL;
+}
+
+/* zero-copy view of interleaved float data, NULL for integer PCM */
+const SAMPLE *wav_reader_float_data(const wav_reader *r){
+    if (r->audio_format != WAVE_FORMAT_IEEE_FLOAT)
+        return NULL;
+    if ((uintptr_t)r->data % _Alignof(SAMPLE) != 0)
+        return NULL;
+    return (const SAMPLE *)r->data;
+}
+
+static void convert_block(const wav_reader *r, const unsigned char *src,
+        SAMPLE *dst, size_t n)
+{
+    switch (r->bits_per_sample){
+    case 16:
+        for (size_t i = 0; i < n; i++, src += 2)
+            dst[i] = (SAMPLE)(int16_t)read_u16_le(src) * (1.0f / 32768.0f);
+        break;
+    case 24:
+        for (size_t i = 0; i < n; i++, src += 3){
+            int32_t v = (int32_t)((uint32_t)src[0] << 8 | (uint32_t)src[1] << 16
+                                  | (uint32_t)src[2] << 24) >> 8;
+            dst[i] = (SAMPLE)v * (1.0f / 8388608.0f);
+        }
+        break;
+    case 32:
+        if (r->audio_format == WAVE_FORMAT_IEEE_FLOAT){
+            memcpy(dst, src, n * sizeof(SAMPLE));
+            break;
+        }
+        for (size_t i = 0; i < n; i++, src += 4)
+            dst[i] = (SAMPLE)(int32_t)read_u32_le(src) * (1.0f / 2147483648.0f);
+        break;
+    }
+}
+
+/* streaming iterator. *out points into the mapping for aligned float data,
+ * otherwise to scratch (max_frames * channels samples) holding converted
+ * frames. returns frames in the block, 0 at the end */
+size_t wav_reader_next_block(wav_reader *r, SAMPLE *scratch, size_t max_frames,
+        const SAMPLE **out)
+{
+    size_t frames = r->num_frames - r->pos;
+    if (frames > max_frames)
+        frames = max_frames;
+    if (frames == 0)
+        return 0;
+
+    const unsigned char *src = r->data + r->pos * r->block_align;
+    const SAMPLE *view = wav_reader_float_data(r);
+    if (view){
+        *out = view + r->pos * (size_t)r->num_channels;
+    } else {
+        convert_block(r, src, scratch, frames * (size_t)r->num_channels);
+        *out = scratch;
+    }
+
+    r->pos += frames;
+    return frames;
+}
+
+size_t wav_reader_read(wav_reader *r, SAMPLE *dst, size_t frames){
+    frames = wav_reader_read_at(r, r->pos, dst, frames);
+    r->pos += frames;
+    return frames;
+}
+
+/* positional read, leaves r->pos alone: any number of threads can read
+ * different parts of one mapping */
+size_t wav_reader_read_at(const wav_reader *r, size_t frame, SAMPLE *dst, size_t frames){
+    if (frame >= r->num_frames)
+        return 0;
+    if (frames > r->num_frames - frame)
+        frames = r->num_frames - frame;
+
+    convert_block(r, r->data + frame * r->block_align, dst,
+            frames * (size_t)r->num_channels);
+    return frames;
+}
+
+void wav_reader_seek(wav_reader *r, size_t frame){
+    r->pos = frame < r->num_frames ? frame : r->num_frames;
+}
+
+int wav_reader_close(wav_reader *r){
+    if (!r)
+        return 0;
+
+    int rc = 0;
+    if (r->map && munmap((void *)r->map, r->map_size) != 0)
+        rc = -1;
+    if (r->fd >= 0 && close(r->fd) != 0)
+        rc = -1;
+    free(r);
+    return rc;
+}
+
+#define REPAIR_SCAN_BYTES (1u << 20)
+
+/* fix the sizes of a file whose writer died before wav_close: the data
+ * chunk runs to the end of the file, cut to whole frames. promotes to
+ * RF64 when a JUNK chunk right after WAVE leaves room for ds64 */
+int wav_repair(const char *path, size_t *frames, size_t *old_frames){
+    int fd = open(path, O_RDWR);
+    if (fd < 0){
+        perror(path);
+        return -1;
+    }
+
+    int rc = -1;
+    struct stat st;
+    unsigned char *head = malloc(REPAIR_SCAN_BYTES);
+    if (!head || fstat(fd, &st) < 0){
+        perror(path);
+        goto out;
+    }
+    ssize_t n = pread(fd, head, REPAIR_SCAN_BYTES, 0);
+    int is_rf64 = n >= 12 && (memcmp(head, RF64_ID, 4) == 0 || memcmp(head, BW64_ID, 4) == 0);
+    if (n < 12 || (memcmp(head, CHUNK_ID, 4) != 0 && !is_rf64)
+            || memcmp(head + 8, FORMAT, 4) != 0){
+        fprintf(stderr, "%s: not a RIFF/WAVE file\n", path);
+        goto out;
+    }
+
+    off_t ds64_off = -1;
+    size_t block_align = 0;
+    uint64_t old_data = 0;
+    size_t pos = 12;
+    for (;;){
+        if (pos + 8 > (size_t)n){
+            fprintf(stderr, "%s: no data chunk\n", path);
+            goto out;
+        }
+        const unsigned char *p = head + pos;
+        uint32_t size = read_u32_le(p + 4);
+        if (pos == 12 && (memcmp(p, DS64_ID, 4) == 0
+                    || (memcmp(p, JUNK_ID, 4) == 0 && size >= WAV_DS64_SIZE)))
+            ds64_off = (off_t)pos;
+        if (memcmp(p, SUBCHUNK1_ID, 4) == 0 && pos + 8 + 16 <= (size_t)n)
+            block_align = read_u16_le(p + 8 + 12);
+        if (memcmp(p, SUBCHUNK2_ID, 4) == 0){
+            old_data = size;
+            if (is_rf64 && size == UINT32_MAX && ds64_off > 0)
+                old_data = read_u64_le(head + ds64_off + 16);
+            break;
+        }
+        pos += 8 + (size_t)size + (size & 1);
+    }
+    if (!block_align){
+        fprintf(stderr, "%s: no fmt chunk before data\n", path);
+        goto out;
+    }
+
+    uint64_t data_off = pos + 8;
+    uint64_t data = (uint64_t)st.st_size > data_off ? (uint64_t)st.st_size - data_off : 0;
+    data = data / block_align * block_align;
+    *old_frames = (size_t)(old_data / block_align);
+    *frames = (size_t)(data / block_align);
+
+    // a torn last frame goes, a pad byte is added if the size is odd
+    if (ftruncate(fd, (off_t)(data_off + data)) < 0
+            || ((data & 1) && pwrite_all(fd, "", 1, (off_t)(data_off + data)) < 0)
+            || write_sizes(fd, (off_t)pos + 4, ds64_off, data_off, data, data / block_align) < 0
+            || fsync(fd) < 0){
+        perror(path);
+        goto out;
+    }
+    rc = 0;
+out:
+    free(head);
+    close(fd);
+    return rc;
+}
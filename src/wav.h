@@ -3,8 +3,22 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <sys/types.h>
 
-#define WAV_HEADER_SIZE (44)
+#include "audio_types.h"
+
+/* RIFF/WAVE, JUNK (room for ds64), fmt, data. the JUNK chunk becomes
+ * ds64 and RIFF becomes RF64 when the data outgrows 32-bit sizes */
+#define WAV_HEADER_SIZE (80)
+#define WAV_DS64_SIZE (28)
+
+#define WAV_PREALLOC_BYTES (64u << 20)  // extent size for WAV_PREALLOC
+#define WAV_DIRECT_ALIGN (4096)
+#define WAV_DIRECT_BUFFER (1u << 20)    // staging buffer for WAV_DIRECT
+
+// wav_open_ex flags
+#define WAV_PREALLOC (1 << 0)   // fallocate ahead of the data, file size unchanged
+#define WAV_DIRECT   (1 << 1)   // O_DIRECT: whole aligned blocks, no page cache
 
 #define WAVE_FORMAT_PCM       1
 #define WAVE_FORMAT_IEEE_FLOAT  3
@@ -15,14 +29,54 @@
 typedef struct wav_writer{
     FILE *file;
     size_t num_samples;
+    size_t data_bytes;
     int num_channels;
     int bits_per_sample;
     int sample_rate;
+    int flags;
+    off_t alloc_end;        // WAV_PREALLOC: allocated up to here
+    int dfd;                // WAV_DIRECT: O_DIRECT descriptor, else -1
+    unsigned char *dbuf;    // staged file bytes [dbase, dbase + dfill)
+    size_t dfill;
+    off_t dbase;
 }wav_writer;
 
 wav_writer *wav_open(const char *path, int audio_format, 
         int sample_rate, int channels, int bits_per_sample);
+wav_writer *wav_open_ex(const char *path, int audio_format,
+        int sample_rate, int channels, int bits_per_sample, int flags);
 size_t wav_write(wav_writer *w, const void *data, size_t bytes);
+int wav_commit(wav_writer *w);
+int wav_reserve(wav_writer *w, size_t frames);
+size_t wav_pwrite(wav_writer *w, const void *data, size_t bytes, size_t frame);
 int wav_close(wav_writer *w);
 
+/* memory-mapped reader. the file is never copied to the heap: float32
+ * data is exposed directly, integer PCM is converted block by block */
+typedef struct wav_reader{
+    int fd;
+    const unsigned char *map;
+    size_t map_size;
+    int audio_format;     // PCM or IEEE_FLOAT, EXTENSIBLE is resolved
+    int num_channels;
+    int sample_rate;
+    int bits_per_sample;
+    size_t block_align;
+    const unsigned char *data;
+    size_t data_bytes;
+    size_t num_frames;
+    size_t pos;           // frames already consumed
+}wav_reader;
+
+wav_reader *wav_reader_open(const char *path);
+const SAMPLE *wav_reader_float_data(const wav_reader *r);
+size_t wav_reader_next_block(wav_reader *r, SAMPLE *scratch, size_t max_frames,
+        const SAMPLE **out);
+size_t wav_reader_read(wav_reader *r, SAMPLE *dst, size_t frames);
+size_t wav_reader_read_at(const wav_reader *r, size_t frame, SAMPLE *dst, size_t frames);
+void wav_reader_seek(wav_reader *r, size_t frame);
+int wav_reader_close(wav_reader *r);
+
+int wav_repair(const char *path, size_t *frames, size_t *old_frames);
+
 #endif
\ No newline at end of file